@@ -1,12 +1,39 @@
 #include "customMarkdownHighlighter.h"
 #include "editorsettingsoptions.h"
 
+#include <QElapsedTimer>
+#include <QScrollBar>
+#include <QTextEdit>
+
+namespace {
+// In documents at least this long, blocks away from the viewport are
+// highlighted progressively instead of all at once
+constexpr int LARGE_DOCUMENT_SIZE = 64 * 1024;
+// Blocks around the viewport that are always highlighted right away
+constexpr int VISIBLE_BLOCK_MARGIN = 50;
+// Time given to deferred highlighting per event loop iteration
+constexpr int DEFERRED_HIGHLIGHT_SLICE_MS = 8;
+
+bool isHighlightPending(const QTextBlock &block)
+{
+    auto data = dynamic_cast<MarkdownBlockData *>(block.userData());
+    return data != nullptr && data->isHighlightPending;
+}
+} // namespace
+
 CustomMarkdownHighlighter::CustomMarkdownHighlighter(QTextDocument *parent, HighlightingOptions highlightingOptions)
-    : MarkdownHighlighter(parent, highlightingOptions)
+    : MarkdownHighlighter(parent, highlightingOptions), m_textEdit(nullptr), m_firstVisibleBlock(0), m_lastVisibleBlock(0), m_isHighlightingDeferred(false)
 {
     setListsColor(QColor(35, 131, 226)); // accent color
 
     _formats[static_cast<HighlighterState>(HighlighterState::HorizontalRuler)].clearBackground();
+
+    m_visibleHighlightTimer.setSingleShot(true);
+    m_visibleHighlightTimer.setInterval(0);
+    connect(&m_visibleHighlightTimer, &QTimer::timeout, this, [this]() { highlightVisibleBlocks(); });
+    m_deferredHighlightTimer.setSingleShot(true);
+    m_deferredHighlightTimer.setInterval(0);
+    connect(&m_deferredHighlightTimer, &QTimer::timeout, this, [this]() { highlightDeferredBlocks(); });
 }
 
 void CustomMarkdownHighlighter::setHeaderColors(QColor color)
@@ -65,3 +92,121 @@ void CustomMarkdownHighlighter::setTheme(Theme::Value theme, QColor textColor, q
         break;
     }
 }
+
+/*!
+ * \brief CustomMarkdownHighlighter::setTextEdit
+ * Editor whose viewport decides which blocks of a large document are
+ * highlighted first
+ * \param textEdit
+ */
+void CustomMarkdownHighlighter::setTextEdit(QTextEdit *textEdit)
+{
+    m_textEdit = textEdit;
+    auto scrollBar = m_textEdit->verticalScrollBar();
+    connect(scrollBar, &QScrollBar::valueChanged, &m_visibleHighlightTimer, qOverload<>(&QTimer::start));
+    connect(scrollBar, &QScrollBar::rangeChanged, &m_visibleHighlightTimer, qOverload<>(&QTimer::start));
+    m_visibleHighlightTimer.start();
+}
+
+/*!
+ * \brief CustomMarkdownHighlighter::highlightBlock
+ * Blocks of a large document that are far from the viewport are only
+ * marked as pending here, and highlighted later by highlightVisibleBlocks()
+ * once they scroll into view, or by highlightDeferredBlocks() in the
+ * background. Their state is left untouched so QSyntaxHighlighter doesn't
+ * carry on to the following blocks.
+ * \param text
+ */
+void CustomMarkdownHighlighter::highlightBlock(const QString &text)
+{
+    auto block = currentBlock();
+    auto data = dynamic_cast<MarkdownBlockData *>(currentBlockUserData());
+    if (isDeferrable(block)) {
+        if (data == nullptr) {
+            data = new MarkdownBlockData;
+            setCurrentBlockUserData(data);
+        }
+        data->isHighlightPending = true;
+        if (m_deferredCursor.isNull() || m_deferredCursor.document() != document() || block.position() < m_deferredCursor.position()) {
+            m_deferredCursor = QTextCursor(block);
+            m_deferredCursor.setKeepPositionOnInsert(true);
+        }
+        if (!m_deferredHighlightTimer.isActive()) {
+            m_deferredHighlightTimer.start();
+        }
+        return;
+    }
+    if (data != nullptr) {
+        data->isHighlightPending = false;
+    }
+    MarkdownHighlighter::highlightBlock(text);
+}
+
+bool CustomMarkdownHighlighter::isDeferrable(const QTextBlock &block) const
+{
+    if (m_isHighlightingDeferred || document()->characterCount() < LARGE_DOCUMENT_SIZE) {
+        return false;
+    }
+    int blockNumber = block.blockNumber();
+    return blockNumber < m_firstVisibleBlock - VISIBLE_BLOCK_MARGIN || blockNumber > m_lastVisibleBlock + VISIBLE_BLOCK_MARGIN;
+}
+
+void CustomMarkdownHighlighter::updateVisibleBlockRange()
+{
+    if (m_textEdit == nullptr || m_textEdit->document() != document()) {
+        return;
+    }
+    auto viewport = m_textEdit->viewport();
+    m_firstVisibleBlock = m_textEdit->cursorForPosition(QPoint(0, 0)).blockNumber();
+    m_lastVisibleBlock = m_textEdit->cursorForPosition(QPoint(viewport->width() - 1, viewport->height() - 1)).blockNumber();
+}
+
+/*!
+ * \brief CustomMarkdownHighlighter::highlightVisibleBlocks
+ * Highlight the pending blocks that are now in or near the viewport
+ */
+void CustomMarkdownHighlighter::highlightVisibleBlocks()
+{
+    if (document() == nullptr) {
+        return;
+    }
+    updateVisibleBlockRange();
+    auto block = document()->findBlockByNumber(std::max(0, m_firstVisibleBlock - VISIBLE_BLOCK_MARGIN));
+    int lastBlockNumber = m_lastVisibleBlock + VISIBLE_BLOCK_MARGIN;
+    for (int blockNumber = block.blockNumber(); block.isValid() && blockNumber <= lastBlockNumber; ++blockNumber) {
+        if (isHighlightPending(block)) {
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+}
+
+/*!
+ * \brief CustomMarkdownHighlighter::highlightDeferredBlocks
+ * Highlight pending blocks in document order for one time slice, so block
+ * states flow down correctly, and reschedule until none are left
+ */
+void CustomMarkdownHighlighter::highlightDeferredBlocks()
+{
+    if (document() == nullptr || m_deferredCursor.isNull() || m_deferredCursor.document() != document()) {
+        m_deferredCursor = QTextCursor();
+        return;
+    }
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+    m_isHighlightingDeferred = true;
+    auto block = m_deferredCursor.block();
+    while (block.isValid() && elapsedTimer.elapsed() < DEFERRED_HIGHLIGHT_SLICE_MS) {
+        if (isHighlightPending(block)) {
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+    m_isHighlightingDeferred = false;
+    if (block.isValid()) {
+        m_deferredCursor.setPosition(block.position());
+        m_deferredHighlightTimer.start();
+    } else {
+        m_deferredCursor = QTextCursor();
+    }
+}
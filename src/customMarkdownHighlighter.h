@@ -3,6 +3,36 @@
 #include "3rdParty/qmarkdowntextedit/markdownhighlighter.h"
 #include "editorsettingsoptions.h"
 
+#include <QTextBlockUserData>
+#include <QTextCursor>
+#include <QTimer>
+
+class QTextEdit;
+
+/*!
+ * \brief The MarkdownBlockData class
+ * Per block state kept between edits: whether the block still waits for
+ * its highlight, and what the kanban task parser found in it. The task
+ * state is reset by the editor when the block's text changes.
+ */
+class MarkdownBlockData : public QTextBlockUserData
+{
+public:
+    enum class TaskLineType : std::uint8_t {
+        Unparsed,
+        Empty,
+        Text,
+        Header,
+        Task,
+    };
+
+    bool isHighlightPending = false;
+    TaskLineType taskLineType = TaskLineType::Unparsed;
+    bool isTaskChecked = false;
+    // Column title of a header, text of a task
+    QString taskLineText;
+};
+
 class CustomMarkdownHighlighter : public MarkdownHighlighter
 {
 public:
@@ -14,4 +44,22 @@ public:
     void setListsColor(QColor color);
 
     void setTheme(Theme::Value theme, QColor textColor, qreal fontSize);
+    void setTextEdit(QTextEdit *textEdit);
+
+protected:
+    void highlightBlock(const QString &text) override;
+
+private:
+    bool isDeferrable(const QTextBlock &block) const;
+    void updateVisibleBlockRange();
+    void highlightVisibleBlocks();
+    void highlightDeferredBlocks();
+
+    QTextEdit *m_textEdit;
+    QTimer m_visibleHighlightTimer;
+    QTimer m_deferredHighlightTimer;
+    QTextCursor m_deferredCursor;
+    int m_firstVisibleBlock;
+    int m_lastVisibleBlock;
+    bool m_isHighlightingDeferred;
 };
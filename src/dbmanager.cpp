@@ -1,22 +1,317 @@
 #include "dbmanager.h"
+#include "markdowntext.h"
+#include "notearchive.h"
+#include "noteexport.h"
 #include <QtSql/QSqlQuery>
 #include <QTimeZone>
 #include <QDateTime>
 #include <QDebug>
+#include <QDataStream>
+#include <QTimer>
 #include <QSqlError>
 #include <QtConcurrent>
 #include <QSqlRecord>
 #include <QSet>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QTextStream>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 #include <algorithm>
+#ifdef USE_SYSTEM_SQLITE
+#  include <QSqlDriver>
+#  include <sqlite3.h>
+#endif
 
 #define DEFAULT_DATABASE_NAME "default_database"
 #define OUTSIDE_DATABASE_NAME "outside_database"
+#define BACKUP_DATABASE_NAME "backup_database"
+
+namespace {
+// The folder hierarchy is indexed as intervals over the materialized absolute_path.
+// Every node below a folder has an absolute_path starting with "<folder path>/".
+// Since '0' directly follows '/' in the character table, all of them sort strictly
+// between "<folder path>/" and "<folder path>0" under the BINARY collation, so any
+// subtree is one contiguous range of node_table_absolute_path_index. Subtree
+// membership, counts and deletes are therefore index range scans, unlike the
+// case-insensitive LIKE prefix matches which SQLite can't serve from an index.
+QString subtreeLowerBound(const QString &folderPath)
+{
+    return folderPath + PATH_SEPARATOR;
+}
+
+QString subtreeUpperBound(const QString &folderPath)
+{
+    return folderPath + QChar(PATH_SEPARATOR + 1);
+}
+
+// Notes at least this long are saved as deltas appended to note_edit_log
+// instead of rewriting the whole content column on every autosave.
+constexpr int NOTE_EDIT_LOG_MIN_CONTENT_SIZE = 32 * 1024;
+// A note's deltas are folded back into node_table once there are this many
+// of them, or once they add up to half the size of the content.
+constexpr int NOTE_EDIT_LOG_MAX_ENTRIES = 256;
+
+// Revisions are taken when a note is closed, or at most this often while it
+// is being edited. Each one is stored as a qCompress()ed snapshot of the
+// content, or as a compressed delta against the last snapshot. A note keeps
+// up to NOTE_REVISION_MAX_SNAPSHOTS snapshots with up to
+// NOTE_REVISION_MAX_DELTAS deltas each, older ones are dropped.
+constexpr qint64 NOTE_REVISION_INTERVAL = 10 * 60 * 1000;
+constexpr int NOTE_REVISION_MAX_DELTAS = 32;
+constexpr int NOTE_REVISION_MAX_SNAPSHOTS = 8;
+
+// Note contents at least this long are stored qCompress()ed in node_table,
+// with content_compressed set. Compressed contents come back from QSQLITE as
+// a QByteArray instead of a QString, which is what the read paths go by.
+constexpr int NOTE_CONTENT_COMPRESSION_THRESHOLD = 64 * 1024;
+// Number of notes the background pass re-encodes per event loop iteration
+constexpr int NOTE_CONTENT_RECOMPRESSION_BATCH_SIZE = 16;
+
+// note_search indexes the trigrams of note contents, so a search matches
+// the notes containing the keyword whether or not their content is
+// compressed. Shorter keywords have no trigram to look up.
+constexpr int NOTE_SEARCH_MIN_KEYWORD_LENGTH = 3;
+
+// The tasks of saved notes are indexed in note_task this long after the first
+// save that changed them, so autosaves while typing don't rewrite a note's
+// task rows each time. Queries on the index flush it first.
+constexpr int NOTE_TASK_INDEX_DELAY = 2000;
+
+// Plain text files are imported this many at a time: a batch is read on the
+// thread pool while the previous one is inserted in its own transaction.
+constexpr int PLAIN_TEXT_IMPORT_BATCH_SIZE = 256;
+
+struct PlainTextFile
+{
+    QString fileName;
+    QString content;
+    QString title;
+    QDateTime lastModified;
+    QByteArray contentHash;
+    bool isRead;
+};
+
+PlainTextFile readPlainTextFile(const QString &fileName)
+{
+    PlainTextFile plainTextFile{ fileName, QString(), QString(), QDateTime(), QByteArray(), false };
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return plainTextFile;
+    }
+    QTextStream in(&file);
+    plainTextFile.content = in.readAll();
+    plainTextFile.title = plainTextFile.content.section('\n', 0, 0, QString::SectionSkipEmpty);
+    plainTextFile.lastModified = QFileInfo(file).lastModified();
+    plainTextFile.contentHash = QCryptographicHash::hash(plainTextFile.content.toUtf8(), QCryptographicHash::Sha1);
+    plainTextFile.isRead = true;
+    return plainTextFile;
+}
+
+// Notes are exported this many at a time: a batch is written on the thread
+// pool while the next one is read.
+constexpr int EXPORT_BATCH_SIZE = 256;
+
+struct ExportedFile
+{
+    QString filePath;
+    QString content;
+};
+
+bool writeExportedFile(const ExportedFile &exportedFile)
+{
+    QFile file(exportedFile.filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    return file.write(exportedFile.content.toUtf8()) != -1;
+}
+
+/*!
+ * Delete a database file along with the write-ahead log and shared memory
+ * files SQLite keeps next to it in WAL mode, so that a stale log can't be
+ * applied to the file copied in its place
+ */
+void removeDatabaseFiles(const QString &path)
+{
+    QFile::remove(path);
+    QFile::remove(path + QStringLiteral("-wal"));
+    QFile::remove(path + QStringLiteral("-shm"));
+}
+
+#ifdef USE_SYSTEM_SQLITE
+// Pages copied by each step of an online backup. Requests queued to the
+// database thread are handled between two steps.
+constexpr int BACKUP_STEP_PAGE_COUNT = 256;
+// Wait before retrying a step while the database is locked, in ms
+constexpr int BACKUP_BUSY_DELAY = 100;
+#else
+/*!
+ * Write a copy of the database at databasePath to fileName with VACUUM INTO.
+ * It runs on a connection of its own, off the database thread, so requests
+ * queued there are handled while the copy is written.
+ */
+bool vacuumDatabaseInto(const QString &databasePath, const QString &fileName)
+{
+    bool status = false;
+    {
+        auto db = QSqlDatabase::addDatabase("QSQLITE", BACKUP_DATABASE_NAME);
+        db.setDatabaseName(databasePath);
+        if (db.open()) {
+            QSqlQuery query(db);
+            if (!query.prepare(R"(VACUUM INTO :file_name;)")) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            query.bindValue(QStringLiteral(":file_name"), fileName);
+            status = query.exec();
+            if (!status) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << db.lastError();
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(BACKUP_DATABASE_NAME);
+    return status;
+}
+#endif
+constexpr int MSECS_PER_HOUR = 60 * 60 * 1000;
+// Scheduled backups are named after this prefix and their date, so they
+// sort oldest first
+auto constexpr SCHEDULED_BACKUP_PREFIX = "notes-backup-";
+
+// A notes archive starts with an index entry holding the tags and folders,
+// then has, for each batch of notes, an entry with their metadata followed
+// by one entry per note with its content.
+auto constexpr NOTE_ARCHIVE_VERSION = 1;
+auto constexpr NOTE_ARCHIVE_INDEX_NAME = "notes.json";
+auto constexpr NOTE_ARCHIVE_METADATA_PREFIX = "metadata/";
+auto constexpr NOTE_ARCHIVE_NOTES_DIRECTORY = "Notes";
+
+struct ArchivedFile
+{
+    QString name;
+    QByteArray data;
+    QDateTime modificationDate;
+};
+
+NoteArchiveEntry compressArchivedFile(const ArchivedFile &archivedFile)
+{
+    return NoteArchiveWriter::compressEntry(archivedFile.name, archivedFile.data, archivedFile.modificationDate);
+}
+
+/*!
+ * The .txt and .md files below a directory, sorted. Each subdirectory of the
+ * top one is walked on its own thread.
+ */
+QStringList listPlainTextFiles(const QString &directoryPath)
+{
+    static const QStringList nameFilters = { QStringLiteral("*.txt"), QStringLiteral("*.md") };
+    QDir directory(directoryPath);
+    QStringList fileNames;
+    const auto topLevelFiles = directory.entryInfoList(nameFilters, QDir::Files);
+    for (const auto &fileInfo : topLevelFiles) {
+        fileNames.append(fileInfo.absoluteFilePath());
+    }
+    QStringList subdirectories;
+    const auto subdirectoryInfos = directory.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const auto &fileInfo : subdirectoryInfos) {
+        subdirectories.append(fileInfo.absoluteFilePath());
+    }
+    const auto subdirectoryFiles = QtConcurrent::blockingMapped(subdirectories, [](const QString &subdirectory) {
+        QStringList files;
+        QDirIterator it(subdirectory, nameFilters, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            files.append(it.next());
+        }
+        return files;
+    });
+    for (const auto &files : subdirectoryFiles) {
+        fileNames.append(files);
+    }
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+/*!
+ * FTS5 query matching the keyword as a substring: a phrase of its trigrams
+ */
+QString noteSearchPhrase(const QString &keyword)
+{
+    QString phrase = keyword;
+    phrase.replace(QLatin1Char('"'), QStringLiteral("\"\""));
+    return QStringLiteral("\"%1\"").arg(phrase);
+}
+
+bool isCompressedContent(const QVariant &value)
+{
+    return value.userType() == QMetaType::QByteArray;
+}
+
+QString decodeNoteContent(const QVariant &value)
+{
+    if (isCompressedContent(value)) {
+        return QString::fromUtf8(qUncompress(value.toByteArray()));
+    }
+    return value.toString();
+}
+
+QByteArray encodeRevisionDelta(const QString &base, const QString &content)
+{
+    int maxCommon = std::min(base.size(), content.size());
+    int prefix = 0;
+    while (prefix < maxCommon && base.at(prefix) == content.at(prefix)) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < maxCommon - prefix && base.at(base.size() - 1 - suffix) == content.at(content.size() - 1 - suffix)) {
+        ++suffix;
+    }
+    QByteArray delta;
+    QDataStream out(&delta, QIODevice::WriteOnly);
+    out << static_cast<qint32>(prefix) << static_cast<qint32>(base.size() - prefix - suffix)
+        << content.mid(prefix, content.size() - prefix - suffix);
+    return qCompress(delta);
+}
+
+QString applyRevisionDelta(const QString &base, const QByteArray &data)
+{
+    auto delta = qUncompress(data);
+    QDataStream in(delta);
+    qint32 position = 0;
+    qint32 removedLength = 0;
+    QString insertedText;
+    in >> position >> removedLength >> insertedText;
+    if (in.status() != QDataStream::Ok || position < 0 || removedLength < 0 || position + removedLength > base.size()) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Corrupted revision";
+        return base;
+    }
+    QString content = base;
+    content.replace(position, removedLength, insertedText);
+    return content;
+}
+} // namespace
 
 /*!
  * \brief DBManager::DBManager
  * \param parent
  */
-DBManager::DBManager(QObject *parent) : QObject(parent)
+DBManager::DBManager(QObject *parent)
+    : QObject(parent),
+      m_hasLastTree(false),
+      m_isContentCompressionEnabled(false),
+      m_hasNoteSearchIndex(false),
+      m_isImportCanceled(false),
+      m_isExportCanceled(false),
+      m_backup(nullptr),
+      m_backupWatcher(nullptr),
+      m_backupTimer(nullptr),
+      m_keptBackupCount(0)
 {
     qRegisterMetaType<QList<NodeData *>>("QList<NodeData*>");
     qRegisterMetaType<QVector<NodeData>>("QVector<NodeData>");
@@ -24,6 +319,8 @@ DBManager::DBManager(QObject *parent) : QObject(parent)
     qRegisterMetaType<QSet<int>>("QSet<int>");
     qRegisterMetaType<ListViewInfo>("ListViewInfo");
     qRegisterMetaType<FolderListType>("DBManager::FolderListType");
+    qRegisterMetaType<QVector<NoteRevision>>("QVector<NoteRevision>");
+    qRegisterMetaType<QVector<NoteTask>>("QVector<NoteTask>");
 }
 
 /*!
@@ -40,12 +337,237 @@ void DBManager::open(const QString &path, bool doCreate)
         qDebug() << "Error: connection with database fail";
     } else {
         qDebug() << "Database: connection ok";
+        // A backup copying the database from its own connection holds a read
+        // transaction for as long as it runs. In WAL mode that never blocks
+        // the notes saved here meanwhile.
+        QSqlQuery query(m_db);
+        if (!query.exec(R"(PRAGMA journal_mode = WAL;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
     }
 
+    m_noteEditLogs.clear();
+    m_pendingNoteTasks.clear();
     if (doCreate) {
         createTables();
     }
+    createIndexes();
+    createNoteEditLogTable();
+    createContentCompressedColumn();
+    createNoteRevisionTable();
+    compactAllNoteEditLogs();
+    if (createNoteTaskTable()) {
+        indexAllNoteTasks();
+    }
+    if (createNoteSearchTable()) {
+        indexAllNoteSearch();
+    }
+    createImportedFileTable();
     recalculateChildNotesCount();
+    QTimer::singleShot(0, this, &DBManager::recompressNoteContents);
+}
+
+/*!
+ * \brief DBManager::createIndexes
+ * Indexes are created separately from the tables so databases created
+ * by older versions get them the next time they are opened.
+ */
+void DBManager::createIndexes()
+{
+    QSqlQuery query(m_db);
+    QString absolutePathIndex = R"(CREATE INDEX IF NOT EXISTS "node_table_absolute_path_index" ON "node_table" ("absolute_path");)";
+    if (!query.exec(absolutePathIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString parentIdIndex = R"(CREATE INDEX IF NOT EXISTS "node_table_parent_id_index" ON "node_table" ("parent_id", "node_type");)";
+    if (!query.exec(parentIdIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::createContentCompressedColumn
+ * Add the content_compressed flag to databases created by older versions
+ */
+void DBManager::createContentCompressedColumn()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec(R"(PRAGMA table_info("node_table");)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    while (query.next()) {
+        if (query.value(1).toString() == QStringLiteral("content_compressed")) {
+            return;
+        }
+    }
+    query.clear();
+    if (!query.exec(R"(ALTER TABLE "node_table" ADD COLUMN "content_compressed" INTEGER NOT NULL DEFAULT 0;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::createNoteEditLogTable
+ * note_edit_log holds the edits of large notes that haven't been compacted
+ * into node_table yet, one row per save. Each row replaces removed_length
+ * characters at position with inserted_text and carries the title,
+ * modification date and scrollbar position the save left the note with.
+ */
+void DBManager::createNoteEditLogTable()
+{
+    QSqlQuery query(m_db);
+    QString noteEditLog = R"(CREATE TABLE IF NOT EXISTS "note_edit_log" ()"
+                          R"(    "id"	INTEGER PRIMARY KEY,)"
+                          R"(    "node_id"	INTEGER NOT NULL,)"
+                          R"(    "position"	INTEGER NOT NULL,)"
+                          R"(    "removed_length"	INTEGER NOT NULL,)"
+                          R"(    "inserted_text"	TEXT NOT NULL,)"
+                          R"(    "title"	TEXT,)"
+                          R"(    "modification_date"	INTEGER NOT NULL,)"
+                          R"(    "scrollbar_position"	INTEGER NOT NULL)"
+                          R"();)";
+    if (!query.exec(noteEditLog)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString nodeIdIndex = R"(CREATE INDEX IF NOT EXISTS "note_edit_log_node_id_index" ON "note_edit_log" ("node_id");)";
+    if (!query.exec(nodeIdIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::createNoteRevisionTable
+ * note_revision holds the history of notes. A row with a base_id of -1 is a
+ * snapshot of the content, any other row is a delta against the snapshot
+ * base_id refers to.
+ */
+void DBManager::createNoteRevisionTable()
+{
+    QSqlQuery query(m_db);
+    QString noteRevision = R"(CREATE TABLE IF NOT EXISTS "note_revision" ()"
+                           R"(    "id"	INTEGER PRIMARY KEY,)"
+                           R"(    "node_id"	INTEGER NOT NULL,)"
+                           R"(    "base_id"	INTEGER NOT NULL,)"
+                           R"(    "creation_date"	INTEGER NOT NULL,)"
+                           R"(    "title"	TEXT,)"
+                           R"(    "data"	BLOB NOT NULL)"
+                           R"();)";
+    if (!query.exec(noteRevision)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString nodeIdIndex = R"(CREATE INDEX IF NOT EXISTS "note_revision_node_id_index" ON "note_revision" ("node_id", "id");)";
+    if (!query.exec(nodeIdIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::createNoteTaskTable
+ * note_task indexes the tasks of every note, one row per "- [ ]" or "- [x]"
+ * line, so the tasks of the whole library can be queried without reading
+ * any note content.
+ * \return true if the table didn't exist yet and has to be filled
+ */
+bool DBManager::createNoteTaskTable()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec(R"(SELECT name FROM sqlite_master WHERE type='table' AND name='note_task';)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    bool isTableExisting = query.next();
+    query.clear();
+    QString noteTask = R"(CREATE TABLE IF NOT EXISTS "note_task" ()"
+                       R"(    "node_id"	INTEGER NOT NULL,)"
+                       R"(    "line"	INTEGER NOT NULL,)"
+                       R"(    "column_title"	TEXT,)"
+                       R"(    "is_checked"	INTEGER NOT NULL,)"
+                       R"(    "task_text"	TEXT)"
+                       R"();)";
+    if (!query.exec(noteTask)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString nodeIdIndex = R"(CREATE INDEX IF NOT EXISTS "note_task_node_id_index" ON "note_task" ("node_id", "line");)";
+    if (!query.exec(nodeIdIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString isCheckedIndex = R"(CREATE INDEX IF NOT EXISTS "note_task_is_checked_index" ON "note_task" ("is_checked", "node_id");)";
+    if (!query.exec(isCheckedIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return !isTableExisting;
+}
+
+/*!
+ * \brief DBManager::createNoteSearchTable
+ * note_search is a contentless FTS5 table: it only holds the index of the
+ * note contents, which stay in node_table, compressed or not. Without FTS5
+ * or its trigram tokenizer, searches fall back to matching in node_table.
+ * \return true if the table was just created and has to be filled
+ */
+bool DBManager::createNoteSearchTable()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec(R"(SELECT name FROM sqlite_master WHERE type='table' AND name='note_search';)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    bool isTableExisting = query.next();
+    query.clear();
+    m_hasNoteSearchIndex = query.exec(R"(CREATE VIRTUAL TABLE IF NOT EXISTS "note_search" USING fts5("content", content='', tokenize='trigram');)");
+    if (!m_hasNoteSearchIndex) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return m_hasNoteSearchIndex && !isTableExisting;
+}
+
+/*!
+ * \brief DBManager::createImportedFileTable
+ * imported_file keeps the path and a hash of the content of each file of a
+ * directory imported as a note, so importing the directory again skips the
+ * files that didn't change and updates the notes of those that did. Paths
+ * start with the name of the imported directory. Rows recorded before paths
+ * were kept have an empty one and are matched by hash.
+ */
+void DBManager::createImportedFileTable()
+{
+    QSqlQuery query(m_db);
+    QString importedFile = R"(CREATE TABLE IF NOT EXISTS "imported_file" ()"
+                           R"(    "node_id"	INTEGER NOT NULL,)"
+                           R"(    "content_hash"	BLOB NOT NULL,)"
+                           R"(    "file_path"	TEXT NOT NULL DEFAULT '')"
+                           R"();)";
+    if (!query.exec(importedFile)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    if (!query.exec(R"(PRAGMA table_info("imported_file");)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    bool hasFilePath = false;
+    while (query.next()) {
+        if (query.value(1).toString() == QStringLiteral("file_path")) {
+            hasFilePath = true;
+        }
+    }
+    query.clear();
+    if (!hasFilePath && !query.exec(R"(ALTER TABLE "imported_file" ADD COLUMN "file_path" TEXT NOT NULL DEFAULT '';)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString nodeIdIndex = R"(CREATE INDEX IF NOT EXISTS "imported_file_node_id_index" ON "imported_file" ("node_id");)";
+    if (!query.exec(nodeIdIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    QString filePathIndex = R"(CREATE INDEX IF NOT EXISTS "imported_file_file_path_index" ON "imported_file" ("file_path");)";
+    if (!query.exec(filePathIndex)) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
 }
 
 /*!
@@ -66,6 +588,7 @@ void DBManager::createTables()
                         R"(    "modification_date"	INTEGER NOT NULL DEFAULT 0,)"
                         R"(    "deletion_date"	INTEGER NOT NULL DEFAULT 0,)"
                         R"(    "content"	TEXT,)"
+                        R"(    "content_compressed"	INTEGER NOT NULL DEFAULT 0,)"
                         R"(    "node_type"	INTEGER NOT NULL,)"
                         R"(    "parent_id"	INTEGER NOT NULL,)"
                         R"(    "relative_position"	INTEGER NOT NULL,)"
@@ -195,7 +718,6 @@ QVector<NodeData> DBManager::getAllFolders()
                        R"("creation_date",)"
                        R"("modification_date",)"
                        R"("deletion_date",)"
-                       R"("content",)"
                        R"("node_type",)"
                        R"("parent_id",)"
                        R"("relative_position",)"
@@ -216,15 +738,11 @@ QVector<NodeData> DBManager::getAllFolders()
             node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
             node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
             node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-            node.setContent(query.value(5).toString());
-            node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-            node.setParentId(query.value(7).toInt());
-            node.setRelativePosition(query.value(8).toInt());
-            node.setAbsolutePath(query.value(9).toString());
-            node.setChildNotesCount(query.value(10).toInt());
-            if (node.nodeType() == NodeData::Type::Note) {
-                node.setTagIds(getAllTagForNote(node.id()));
-            }
+            node.setNodeType(static_cast<NodeData::Type>(query.value(5).toInt()));
+            node.setParentId(query.value(6).toInt());
+            node.setRelativePosition(query.value(7).toInt());
+            node.setAbsolutePath(query.value(8).toString());
+            node.setChildNotesCount(query.value(9).toInt());
             nodeList.append(node);
         }
     } else {
@@ -321,8 +839,8 @@ int DBManager::addNode(const NodeData &node)
     absolutePath += PATH_SEPARATOR + QString::number(nodeId);
     QString queryStr =
             R"(INSERT INTO "node_table")"
-            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count"))"
-            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count);)";
+            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "content_compressed", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count"))"
+            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :content_compressed, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count);)";
 
     if (!query.prepare(queryStr)) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
@@ -336,7 +854,7 @@ int DBManager::addNode(const NodeData &node)
     } else {
         query.bindValue(":deletion_date", node.deletionDateTime().toMSecsSinceEpoch());
     }
-    query.bindValue(":content", content);
+    bindNoteContent(query, content);
     query.bindValue(":node_type", static_cast<int>(node.nodeType()));
     query.bindValue(":parent_id", node.parentId());
     query.bindValue(":relative_position", relationalPosition);
@@ -361,6 +879,8 @@ int DBManager::addNode(const NodeData &node)
     if (node.nodeType() == NodeData::Type::Note) {
         increaseChildNotesCountFolder(node.parentId());
         increaseChildNotesCountFolder(ROOT_FOLDER_ID);
+        queueNoteTasksUpdate(nodeId, node.content());
+        indexNoteSearch(nodeId, content);
     }
     return nodeId;
 }
@@ -382,8 +902,8 @@ int DBManager::addNodePreComputed(const NodeData &node)
     int nodeId = node.id();
     QString queryStr =
             R"(INSERT INTO "node_table" )"
-            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count") )"
-            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count);)";
+            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "content_compressed", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count") )"
+            R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, :content, :content_compressed, :node_type, :parent_id, :relative_position, :scrollbar_position, :absolute_path, :is_pinned_note, :relative_position_an, :child_notes_count);)";
 
     if (!query.prepare(queryStr)) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
@@ -397,7 +917,7 @@ int DBManager::addNodePreComputed(const NodeData &node)
     } else {
         query.bindValue(":deletion_date", node.deletionDateTime().toMSecsSinceEpoch());
     }
-    query.bindValue(":content", content);
+    bindNoteContent(query, content);
     query.bindValue(":node_type", static_cast<int>(node.nodeType()));
     query.bindValue(":parent_id", node.parentId());
     query.bindValue(":relative_position", relationalPosition);
@@ -414,6 +934,10 @@ int DBManager::addNodePreComputed(const NodeData &node)
 
     query.finish();
 
+    if (node.nodeType() == NodeData::Type::Note && status) {
+        queueNoteTasksUpdate(nodeId, node.content());
+        indexNoteSearch(nodeId, content);
+    }
     return nodeId;
 }
 
@@ -600,140 +1124,103 @@ void DBManager::recalculateChildNotesCountAllNotes()
 }
 
 void DBManager::increaseChildNotesCountTag(int tagId)
+{
+    changeChildNotesCountTag(tagId, 1);
+}
+
+void DBManager::decreaseChildNotesCountTag(int tagId)
+{
+    changeChildNotesCountTag(tagId, -1);
+}
+
+void DBManager::increaseChildNotesCountFolder(int folderId)
+{
+    changeChildNotesCountFolder(folderId, 1);
+}
+
+void DBManager::decreaseChildNotesCountFolder(int folderId)
+{
+    changeChildNotesCountFolder(folderId, -1);
+}
+
+void DBManager::changeChildNotesCountTag(int tagId, int delta)
 {
     QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT child_notes_count FROM "tag_table" WHERE id=:id)")) {
+    if (!query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = max(child_notes_count + :delta, 0) "
+                                      "WHERE id = :id"))) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(QStringLiteral(":id"), tagId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-    } else {
+    query.bindValue(QStringLiteral(":delta"), delta);
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         return;
     }
     query.clear();
-    childNotesCount += 1;
-
-    if (!query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = :child_notes_count "
-                                      "WHERE id = :id"))) {
+    if (!query.prepare(R"(SELECT child_notes_count FROM "tag_table" WHERE id=:id)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(QStringLiteral(":id"), tagId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
+    int childNotesCount = 0;
+    if (query.exec() && query.next()) {
+        childNotesCount = query.value(0).toInt();
+    } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
     }
     emit childNotesCountUpdatedTag(tagId, childNotesCount);
 }
 
-void DBManager::decreaseChildNotesCountTag(int tagId)
+void DBManager::changeChildNotesCountFolder(int folderId, int delta)
 {
     QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT child_notes_count FROM "tag_table" WHERE id=:id)")) {
+    if (!query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = max(child_notes_count + :delta, 0) "
+                                      "WHERE id = :id"))) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    query.bindValue(QStringLiteral(":id"), tagId);
-    bool status = query.exec();
-    int childNoteCount = 0;
-    if (status) {
-        query.next();
-        childNoteCount = query.value(0).toInt();
-    } else {
+    query.bindValue(QStringLiteral(":id"), folderId);
+    query.bindValue(QStringLiteral(":delta"), delta);
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         return;
     }
     query.clear();
-    childNoteCount -= 1;
-    childNoteCount = std::max(childNoteCount, 0);
-
-    if (!query.prepare(QStringLiteral("UPDATE tag_table SET child_notes_count = :child_notes_count "
-                                      "WHERE id = :id"))) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(QStringLiteral(":id"), tagId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNoteCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    emit childNotesCountUpdatedTag(tagId, childNoteCount);
-}
-
-void DBManager::increaseChildNotesCountFolder(int folderId)
-{
-    QSqlQuery query(m_db);
     if (!query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(QStringLiteral(":id"), folderId);
-    bool status = query.exec();
     int childNotesCount = 0;
     QString absPath;
-    if (status) {
-        query.next();
+    if (query.exec() && query.next()) {
         childNotesCount = query.value(0).toInt();
         absPath = query.value(1).toString();
     } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         return;
     }
-    query.clear();
-    childNotesCount += 1;
+    emit childNotesCountUpdatedFolder(folderId, absPath, childNotesCount);
+}
 
-    if (!query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
-                                      "WHERE id = :id"))) {
+int DBManager::countNotesInSubtree(const QString &folderPath)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT count(*) FROM node_table )"
+                       R"(WHERE absolute_path > :lower_bound AND absolute_path < :upper_bound AND node_type = :node_type;)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    query.bindValue(QStringLiteral(":id"), folderId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
+    query.bindValue(QStringLiteral(":lower_bound"), subtreeLowerBound(folderPath));
+    query.bindValue(QStringLiteral(":upper_bound"), subtreeUpperBound(folderPath));
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    int count = 0;
+    if (query.exec() && query.next()) {
+        count = query.value(0).toInt();
+    } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    emit childNotesCountUpdatedFolder(folderId, absPath, childNotesCount);
+    return count;
 }
 
-void DBManager::decreaseChildNotesCountFolder(int folderId)
-{
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT child_notes_count, absolute_path  FROM "node_table" WHERE id=:id)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(QStringLiteral(":id"), folderId);
-    bool status = query.exec();
-    int childNotesCount = 0;
-    QString absPath;
-    if (status) {
-        query.next();
-        childNotesCount = query.value(0).toInt();
-        absPath = query.value(1).toString();
-    } else {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        return;
-    }
-    query.clear();
-    childNotesCount -= 1;
-    childNotesCount = std::max(childNotesCount, 0);
-
-    if (!query.prepare(QStringLiteral("UPDATE node_table SET child_notes_count = :child_notes_count "
-                                      "WHERE id = :id"))) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(QStringLiteral(":id"), folderId);
-    query.bindValue(QStringLiteral(":child_notes_count"), childNotesCount);
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    emit childNotesCountUpdatedFolder(folderId, absPath, childNotesCount);
-}
-
-int DBManager::addTag(const TagData &tag)
+int DBManager::addTag(const TagData &tag)
 {
     QSqlQuery query(m_db);
 
@@ -891,6 +1378,7 @@ void DBManager::changeTagColor(int id, const QString &newColor)
 void DBManager::removeNote(const NodeData &note)
 {
     if (note.parentId() == TRASH_FOLDER_ID) {
+        removeNoteSearch(note.id());
         QSqlQuery query(m_db);
         if (!query.prepare(R"(DELETE FROM "node_table" )"
                            R"(WHERE id = (:id) AND node_type = (:node_type);)")) {
@@ -910,6 +1398,18 @@ void DBManager::removeNote(const NodeData &note)
         if (!query.exec()) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
+        discardNoteEditLog(note.id());
+        removeNoteRevisions(note.id());
+        m_pendingNoteTasks.remove(note.id());
+        removeNoteTasks(note.id());
+        query.clear();
+        if (!query.prepare(R"(DELETE FROM "imported_file" WHERE node_id = :node_id;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":node_id"), note.id());
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
         if (note.nodeType() == NodeData::Type::Note) {
             decreaseChildNotesCountFolder(TRASH_FOLDER_ID);
         }
@@ -962,14 +1462,23 @@ bool DBManager::updateNoteContent(const NodeData &note)
     content.replace(QChar('\x0'), emptyStr);
     QString fullTitle = note.fullTitle();
     fullTitle.replace(QChar('\x0'), emptyStr);
+    queueNoteTasksUpdate(id, content);
+
+    if (content.size() >= NOTE_EDIT_LOG_MIN_CONTENT_SIZE
+        && appendNoteEdit(id, content, fullTitle, epochTimeDateModified, note.scrollBarPosition())) {
+        return true;
+    }
+    // The full write below supersedes whatever is still in the edit log
+    discardNoteEditLog(id);
+    removeNoteSearch(id);
 
     if (!query.prepare(QStringLiteral("UPDATE node_table SET modification_date = :modification_date, content = :content, "
-                                      "title = :title, scrollbar_position = :scrollbar_position WHERE id = :id AND node_type "
+                                      "content_compressed = :content_compressed, title = :title, scrollbar_position = :scrollbar_position WHERE id = :id AND node_type "
                                       "= :node_type;"))) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(QStringLiteral(":modification_date"), epochTimeDateModified);
-    query.bindValue(QStringLiteral(":content"), content);
+    bindNoteContent(query, content);
     query.bindValue(QStringLiteral(":title"), fullTitle);
     query.bindValue(QStringLiteral(":id"), id);
     query.bindValue(QStringLiteral(":scrollbar_position"), note.scrollBarPosition());
@@ -977,233 +1486,1109 @@ bool DBManager::updateNoteContent(const NodeData &note)
     if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    return (query.numRowsAffected() == 1);
+    bool isUpdated = query.numRowsAffected() == 1;
+    if (isUpdated) {
+        indexNoteSearch(id, content);
+    }
+    return isUpdated;
 }
 
-QList<NodeData> DBManager::readOldNBK(const QString &fileName)
+/*!
+ * \brief DBManager::appendNoteEdit
+ * Save a note as the difference with what was last saved for it: the common
+ * prefix and suffix are kept and only the changed span in between is
+ * appended to note_edit_log. Notes stop being logged as soon as the user
+ * saves another one, and are compacted once their log grows too long.
+ * \return false if the note couldn't be found, for a full write instead
+ */
+bool DBManager::appendNoteEdit(int noteId, const QString &content, const QString &title, qint64 modificationDate,
+                               int scrollBarPosition)
 {
-    QList<NodeData> noteList;
-    {
-        QFile file(fileName);
-        file.open(QIODevice::ReadOnly);
-        QDataStream in(&file);
-        in.setVersion(QDataStream::Qt_5_6);
-
-        try {
-            in >> noteList;
-        } catch (...) {
-            // Any exception deserializing will result in an empty note list and  the user will be
-            // notified
+    // Only the note being edited is kept in the log
+    const auto loggedIds = m_noteEditLogs.keys();
+    for (int loggedId : loggedIds) {
+        if (loggedId != noteId) {
+            compactNoteEditLog(loggedId);
         }
-        file.close();
     }
-    if (noteList.isEmpty()) {
-        QFile file(fileName);
-        file.open(QIODevice::ReadOnly);
-        QDataStream in(&file);
-        in.setVersion(QDataStream::Qt_5_6);
 
-        QList<NodeData *> nl;
-        try {
-            in >> nl;
-        } catch (...) {
-            // Any exception deserializing will result in an empty note list and  the user will be
-            // notified
-        }
-        if (!nl.isEmpty()) {
-            for (const auto &n : std::as_const(nl)) {
-                noteList.append(*n);
-            }
+    auto it = m_noteEditLogs.find(noteId);
+    if (it == m_noteEditLogs.end()) {
+        NoteEditLog log;
+        if (!loadNoteEditLog(noteId, log)) {
+            return false;
         }
-        qDeleteAll(nl);
-        file.close();
+        it = m_noteEditLogs.insert(noteId, log);
     }
-    return noteList;
-}
+    auto &log = it.value();
 
-int DBManager::nextAvailablePosition(int parentId, NodeData::Type nodeType)
-{
-    QSqlQuery query(m_db);
-    int relationalPosition = 0;
-    if (parentId != -1) {
-        if (!query.prepare(R"(SELECT relative_position FROM "node_table" )"
-                           R"(WHERE parent_id = :parent_id AND node_type = :node_type;)")) {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        query.bindValue(":parent_id", parentId);
-        query.bindValue(":node_type", static_cast<int>(nodeType));
-        bool status = query.exec();
-        if (status) {
-            while (query.next()) {
-                if (relationalPosition <= query.value(0).toInt()) {
-                    relationalPosition = query.value(0).toInt() + 1;
-                }
-            }
-        } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        query.finish();
+    const QString &previous = log.content;
+    int maxCommon = std::min(previous.size(), content.size());
+    int prefix = 0;
+    while (prefix < maxCommon && previous.at(prefix) == content.at(prefix)) {
+        ++prefix;
     }
-    return relationalPosition;
-}
+    int suffix = 0;
+    while (suffix < maxCommon - prefix && previous.at(previous.size() - 1 - suffix) == content.at(content.size() - 1 - suffix)) {
+        ++suffix;
+    }
+    int removedLength = previous.size() - prefix - suffix;
+    QString insertedText = content.mid(prefix, content.size() - prefix - suffix);
 
-NodePath DBManager::getNodeAbsolutePath(int nodeId)
-{
     QSqlQuery query(m_db);
-    if (!query.prepare("SELECT absolute_path FROM node_table WHERE id = :id")) {
+    if (!query.prepare(R"(INSERT INTO "note_edit_log" )"
+                       R"(("node_id", "position", "removed_length", "inserted_text", "title", "modification_date", "scrollbar_position") )"
+                       R"(VALUES (:node_id, :position, :removed_length, :inserted_text, :title, :modification_date, :scrollbar_position);)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    query.bindValue(":id", nodeId);
-    bool status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << query.isValid();
-    }
-    query.last();
-    auto absolutePath = query.value(0).toString();
-    return absolutePath;
-}
-
-NodeData DBManager::getNode(int nodeId)
-{
-    QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT)"
-                       R"("id",)"
-                       R"("title",)"
-                       R"("creation_date",)"
-                       R"("modification_date",)"
-                       R"("deletion_date",)"
-                       R"("content",)"
-                       R"("node_type",)"
-                       R"("parent_id",)"
-                       R"("relative_position",)"
-                       R"("scrollbar_position",)"
-                       R"("absolute_path", )"
-                       R"("is_pinned_note", )"
-                       R"("relative_position_an", )"
-                       R"("child_notes_count" )"
-                       R"(FROM node_table WHERE id=:id LIMIT 1;)")) {
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    query.bindValue(QStringLiteral(":position"), prefix);
+    query.bindValue(QStringLiteral(":removed_length"), removedLength);
+    query.bindValue(QStringLiteral(":inserted_text"), insertedText);
+    query.bindValue(QStringLiteral(":title"), title);
+    query.bindValue(QStringLiteral(":modification_date"), modificationDate);
+    query.bindValue(QStringLiteral(":scrollbar_position"), scrollBarPosition);
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        m_noteEditLogs.erase(it);
+        return false;
     }
-    query.bindValue(":id", nodeId);
-    bool status = query.exec();
-    if (status) {
-        query.next();
-        NodeData node;
-        node.setId(query.value(0).toInt());
-        node.setFullTitle(query.value(1).toString());
-        node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
-        node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
-        node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-        node.setContent(query.value(5).toString());
-        node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
-        node.setParentId(query.value(7).toInt());
-        node.setRelativePosition(query.value(8).toInt());
-        node.setScrollBarPosition(query.value(9).toInt());
-        node.setAbsolutePath(query.value(10).toString());
-        node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
-        node.setRelativePosAN(query.value(13).toInt());
-        node.setRelativePosAN(query.value(14).toInt());
-        if (node.nodeType() == NodeData::Type::Note) {
-            node.setTagIds(getAllTagForNote(node.id()));
-            QSqlQuery query2(m_db);
-            if (!query2.prepare(R"(SELECT)"
-                                R"("title" )"
-                                R"(FROM node_table WHERE id=:id LIMIT 1;)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-            }
-            query2.bindValue(":id", node.parentId());
-            if (query2.exec()) {
-                query2.next();
-                node.setParentName(query2.value(0).toString());
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << query2.lastError();
-            }
-        }
-        return node;
+
+    log.content = content;
+    log.title = title;
+    log.modificationDate = modificationDate;
+    log.scrollBarPosition = scrollBarPosition;
+    ++log.entryCount;
+    log.loggedSize += insertedText.size();
+    if (log.entryCount >= NOTE_EDIT_LOG_MAX_ENTRIES || log.loggedSize * 2 >= log.content.size()) {
+        compactNoteEditLog(noteId);
     }
-    qDebug() << "Can't find node with id" << nodeId << ": " << query.lastError();
-    return NodeData();
+    return true;
 }
 
-void DBManager::moveFolderToTrash(const NodeData &node)
+/*!
+ * \brief DBManager::loadNoteEditLog
+ * Rebuild a note from its node_table row followed by its logged edits
+ * \param noteId
+ * \param log
+ * \return false if there is no such note
+ */
+bool DBManager::loadNoteEditLog(int noteId, NoteEditLog &log)
 {
     QSqlQuery query(m_db);
-    QString parentPath = node.absolutePath() + PATH_SEPARATOR;
-    if (!query.prepare(R"(SELECT id FROM "node_table" )"
-                       R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type);)")) {
+    if (!query.prepare(R"(SELECT "content", "title", "modification_date", "scrollbar_position" )"
+                       R"(FROM node_table WHERE id = :id AND node_type = :node_type;)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    query.bindValue(QStringLiteral(":path_expr"), parentPath);
+    query.bindValue(QStringLiteral(":id"), noteId);
     query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
-    bool status = query.exec();
-    QSet<int> childIds;
-    if (status) {
-        while (query.next()) {
-            childIds.insert(query.value(0).toInt());
-        }
-    } else {
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return false;
+    }
+    if (!query.next()) {
+        return false;
     }
+    log.content = decodeNoteContent(query.value(0));
+    log.title = query.value(1).toString();
+    log.modificationDate = query.value(2).toLongLong();
+    log.scrollBarPosition = query.value(3).toInt();
+    log.entryCount = 0;
+    log.loggedSize = 0;
     query.clear();
-    auto trashFolder = getNode(TRASH_FOLDER_ID);
-    for (const auto &id : childIds) {
-        moveNode(id, trashFolder);
+
+    if (!query.prepare(R"(SELECT "position", "removed_length", "inserted_text", "title", "modification_date", "scrollbar_position" )"
+                       R"(FROM "note_edit_log" WHERE node_id = :node_id ORDER BY id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    if (!query.prepare(R"(DELETE FROM "node_table" )"
-                       R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type);)")) {
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return true;
     }
-    query.bindValue(QStringLiteral(":path_expr"), parentPath);
-    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Folder));
-    status = query.exec();
-    if (!status) {
+    while (query.next()) {
+        int position = std::min(query.value(0).toInt(), static_cast<int>(log.content.size()));
+        QString insertedText = query.value(2).toString();
+        log.content.replace(position, query.value(1).toInt(), insertedText);
+        log.title = query.value(3).toString();
+        log.modificationDate = query.value(4).toLongLong();
+        log.scrollBarPosition = query.value(5).toInt();
+        ++log.entryCount;
+        log.loggedSize += insertedText.size();
+    }
+    return true;
+}
+
+/*!
+ * \brief DBManager::compactNoteEditLog
+ * Write the current state of a logged note into node_table and drop its log
+ * \param noteId
+ */
+void DBManager::compactNoteEditLog(int noteId)
+{
+    auto it = m_noteEditLogs.constFind(noteId);
+    if (it == m_noteEditLogs.constEnd()) {
+        return;
+    }
+    const auto &log = it.value();
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    removeNoteSearch(noteId);
+    QSqlQuery query(m_db);
+    if (!query.prepare(QStringLiteral("UPDATE node_table SET modification_date = :modification_date, content = :content, "
+                                      "content_compressed = :content_compressed, title = :title, scrollbar_position = :scrollbar_position WHERE id = :id AND node_type "
+                                      "= :node_type;"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":modification_date"), log.modificationDate);
+    bindNoteContent(query, log.content);
+    query.bindValue(QStringLiteral(":title"), log.title);
+    query.bindValue(QStringLiteral(":scrollbar_position"), log.scrollBarPosition);
+    query.bindValue(QStringLiteral(":id"), noteId);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    if (query.numRowsAffected() == 1) {
+        indexNoteSearch(noteId, log.content);
+    }
     query.clear();
-    if (!query.prepare(R"(DELETE FROM "node_table" )"
-                       R"(WHERE absolute_path like (:path_expr) AND node_type = (:node_type);)")) {
+    if (!query.prepare(R"(DELETE FROM "note_edit_log" WHERE node_id = :node_id;)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    query.bindValue(QStringLiteral(":path_expr"), node.absolutePath());
-    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Folder));
-    status = query.exec();
-    if (!status) {
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    if (!query.exec()) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    m_noteEditLogs.erase(it);
 }
 
-FolderListType DBManager::getFolderList()
+/*!
+ * \brief DBManager::compactAllNoteEditLogs
+ * Fold every pending edit into node_table, including the ones a previous
+ * session left behind. Called before anything that reads content in SQL
+ * or hands the database file to something else.
+ */
+void DBManager::compactAllNoteEditLogs()
 {
-    QMap<int, QString> result;
     QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT "id", "title" FROM node_table WHERE id > 0 AND node_type = :node_type;)")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-    }
-    query.bindValue(":node_type", static_cast<int>(NodeData::Type::Folder));
-    bool status = query.exec();
-    if (status) {
+    QVector<int> leftoverIds;
+    if (query.exec(R"(SELECT DISTINCT "node_id" FROM "note_edit_log";)")) {
         while (query.next()) {
-            result[query.value(0).toInt()] = query.value(1).toString();
+            int noteId = query.value(0).toInt();
+            if (!m_noteEditLogs.contains(noteId)) {
+                leftoverIds.append(noteId);
+            }
         }
     } else {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
-    return result;
+    for (int noteId : std::as_const(leftoverIds)) {
+        // The log of a note that no longer exists just gets deleted
+        NoteEditLog log{};
+        loadNoteEditLog(noteId, log);
+        m_noteEditLogs.insert(noteId, log);
+    }
+    const auto loggedIds = m_noteEditLogs.keys();
+    for (int noteId : loggedIds) {
+        compactNoteEditLog(noteId);
+    }
 }
 
-void DBManager::moveNode(int nodeId, const NodeData &target)
+/*!
+ * \brief DBManager::discardNoteEditLog
+ * Drop the pending edits of a note that was deleted or fully rewritten
+ * \param noteId
+ */
+void DBManager::discardNoteEditLog(int noteId)
 {
-    if (target.nodeType() != NodeData::Type::Folder) {
-        qDebug() << "moveNode target is not folder" << target.id();
+    if (!m_noteEditLogs.remove(noteId)) {
         return;
     }
     QSqlQuery query(m_db);
-    auto node = getNode(nodeId);
+    if (!query.prepare(R"(DELETE FROM "note_edit_log" WHERE node_id = :node_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
 
-    QString newAbsolutePath = QStringLiteral("%1%2%3").arg(target.absolutePath(), PATH_SEPARATOR).arg(nodeId);
-    if (target.id() == TRASH_FOLDER_ID) {
-        qint64 deletionTime = QDateTime::currentMSecsSinceEpoch();
-        if (!query.prepare(QStringLiteral("UPDATE node_table SET parent_id = :parent_id, absolute_path = :absolute_path, "
+/*!
+ * \brief DBManager::applyPendingNoteEdits
+ * Bring a note read from node_table up to date with its uncompacted edits
+ * \param note
+ */
+void DBManager::applyPendingNoteEdits(NodeData &note) const
+{
+    auto it = m_noteEditLogs.constFind(note.id());
+    if (it == m_noteEditLogs.constEnd() || note.nodeType() != NodeData::Type::Note) {
+        return;
+    }
+    note.setContent(it->content);
+    note.setFullTitle(it->title);
+    note.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(it->modificationDate));
+    note.setScrollBarPosition(it->scrollBarPosition);
+}
+
+/*!
+ * \brief DBManager::bindNoteContent
+ * Bind :content and :content_compressed, compressing the content if it is
+ * large enough and compression is enabled
+ */
+void DBManager::bindNoteContent(QSqlQuery &query, const QString &content) const
+{
+    bool isCompressed = m_isContentCompressionEnabled && content.size() >= NOTE_CONTENT_COMPRESSION_THRESHOLD;
+    if (isCompressed) {
+        query.bindValue(QStringLiteral(":content"), qCompress(content.toUtf8()));
+    } else {
+        query.bindValue(QStringLiteral(":content"), content);
+    }
+    query.bindValue(QStringLiteral(":content_compressed"), isCompressed ? 1 : 0);
+}
+
+/*!
+ * \brief DBManager::setContentCompressionEnabled
+ * \param isEnabled
+ */
+void DBManager::setContentCompressionEnabled(bool isEnabled)
+{
+    if (m_isContentCompressionEnabled == isEnabled) {
+        return;
+    }
+    m_isContentCompressionEnabled = isEnabled;
+    QTimer::singleShot(0, this, &DBManager::recompressNoteContents);
+}
+
+/*!
+ * \brief DBManager::recompressNoteContents
+ * Background pass bringing stored contents in line with the compression
+ * setting: large notes saved before compression existed or while it was
+ * off get compressed, and everything is decompressed once it's turned
+ * off. Works in small batches, rescheduling itself so that requests
+ * queued on the database thread in the meantime aren't held up.
+ */
+void DBManager::recompressNoteContents()
+{
+    QSqlQuery query(m_db);
+    if (m_isContentCompressionEnabled) {
+        if (!query.prepare(R"(SELECT "id", "content" FROM node_table WHERE node_type = :node_type )"
+                           R"(AND content_compressed = 0 AND length(content) >= :threshold LIMIT :limit;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":threshold"), NOTE_CONTENT_COMPRESSION_THRESHOLD);
+    } else {
+        if (!query.prepare(R"(SELECT "id", "content" FROM node_table WHERE node_type = :node_type )"
+                           R"(AND content_compressed = 1 LIMIT :limit;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    query.bindValue(QStringLiteral(":limit"), NOTE_CONTENT_RECOMPRESSION_BATCH_SIZE);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    QVector<QPair<int, QString>> batch;
+    while (query.next()) {
+        batch.append(qMakePair(query.value(0).toInt(), decodeNoteContent(query.value(1))));
+    }
+    query.clear();
+    if (batch.isEmpty()) {
+        return;
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    if (!query.prepare(R"(UPDATE node_table SET content = :content, content_compressed = :content_compressed WHERE id = :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    for (const auto &note : std::as_const(batch)) {
+        bindNoteContent(query, note.second);
+        query.bindValue(QStringLiteral(":id"), note.first);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    if (batch.size() == NOTE_CONTENT_RECOMPRESSION_BATCH_SIZE) {
+        QTimer::singleShot(0, this, &DBManager::recompressNoteContents);
+    }
+}
+
+/*!
+ * \brief DBManager::addNoteRevision
+ * Record the current content of a note in its history, unless it didn't
+ * change since the last revision, or that one is too recent and isForced
+ * is false
+ * \param note
+ * \param isForced
+ */
+void DBManager::addNoteRevision(const NodeData &note, bool isForced)
+{
+    if (note.id() == INVALID_NODE_ID || note.nodeType() != NodeData::Type::Note || note.isTempNote()) {
+        return;
+    }
+    qint64 revisionDate = note.lastModificationdateTime().toMSecsSinceEpoch();
+    const QString &content = note.content();
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "id", "base_id", "creation_date" FROM "note_revision" )"
+                       R"(WHERE node_id = :node_id ORDER BY id DESC LIMIT 1;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), note.id());
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    int snapshotId = INVALID_NODE_ID;
+    if (query.next()) {
+        int latestId = query.value(0).toInt();
+        int latestBaseId = query.value(1).toInt();
+        if (!isForced && revisionDate - query.value(2).toLongLong() < NOTE_REVISION_INTERVAL) {
+            return;
+        }
+        if (getNoteRevisionContent(latestId) == content) {
+            return;
+        }
+        snapshotId = latestBaseId == INVALID_NODE_ID ? latestId : latestBaseId;
+    }
+    query.clear();
+
+    // Store a delta while it stays well below the size of a new snapshot
+    QByteArray snapshotData = qCompress(content.toUtf8());
+    QByteArray data;
+    int baseId = INVALID_NODE_ID;
+    if (snapshotId != INVALID_NODE_ID) {
+        if (!query.prepare(R"(SELECT count(*) FROM "note_revision" WHERE base_id = :base_id;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":base_id"), snapshotId);
+        if (query.exec() && query.next() && query.value(0).toInt() < NOTE_REVISION_MAX_DELTAS) {
+            auto delta = encodeRevisionDelta(getNoteRevisionContent(snapshotId), content);
+            if (delta.size() * 2 < snapshotData.size()) {
+                data = delta;
+                baseId = snapshotId;
+            }
+        }
+        query.clear();
+    }
+    if (baseId == INVALID_NODE_ID) {
+        data = snapshotData;
+    }
+
+    if (!query.prepare(R"(INSERT INTO "note_revision" ("node_id", "base_id", "creation_date", "title", "data") )"
+                       R"(VALUES (:node_id, :base_id, :creation_date, :title, :data);)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), note.id());
+    query.bindValue(QStringLiteral(":base_id"), baseId);
+    query.bindValue(QStringLiteral(":creation_date"), revisionDate);
+    query.bindValue(QStringLiteral(":title"), note.fullTitle());
+    query.bindValue(QStringLiteral(":data"), data);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    query.clear();
+    if (baseId != INVALID_NODE_ID) {
+        return;
+    }
+
+    // A new snapshot was added, drop the snapshots beyond the retention
+    // limit along with their deltas, which all come before the oldest
+    // snapshot that's kept
+    if (!query.prepare(R"(SELECT "id" FROM "note_revision" WHERE node_id = :node_id AND base_id = :base_id )"
+                       R"(ORDER BY id DESC LIMIT 1 OFFSET :offset;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), note.id());
+    query.bindValue(QStringLiteral(":base_id"), INVALID_NODE_ID);
+    query.bindValue(QStringLiteral(":offset"), NOTE_REVISION_MAX_SNAPSHOTS - 1);
+    if (!query.exec() || !query.next()) {
+        return;
+    }
+    int oldestKeptId = query.value(0).toInt();
+    query.clear();
+    if (!query.prepare(R"(DELETE FROM "note_revision" WHERE node_id = :node_id AND id < :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), note.id());
+    query.bindValue(QStringLiteral(":id"), oldestKeptId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::removeNoteRevisions
+ * \param noteId
+ */
+void DBManager::removeNoteRevisions(int noteId)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(DELETE FROM "note_revision" WHERE node_id = :node_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::queueNoteTasksUpdate
+ * Schedule the task rows of a note to be rebuilt from its saved content
+ * \param noteId
+ * \param content
+ */
+void DBManager::queueNoteTasksUpdate(int noteId, const QString &content)
+{
+    if (m_pendingNoteTasks.isEmpty()) {
+        QTimer::singleShot(NOTE_TASK_INDEX_DELAY, this, &DBManager::updateNoteTaskIndex);
+    }
+    m_pendingNoteTasks.insert(noteId, content);
+}
+
+/*!
+ * \brief DBManager::updateNoteTaskIndex
+ * Index the tasks of the notes saved since the last update, in one transaction
+ */
+void DBManager::updateNoteTaskIndex()
+{
+    if (m_pendingNoteTasks.isEmpty()) {
+        return;
+    }
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    for (auto it = m_pendingNoteTasks.constBegin(); it != m_pendingNoteTasks.constEnd(); ++it) {
+        indexNoteTasks(it.key(), it.value());
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    m_pendingNoteTasks.clear();
+}
+
+/*!
+ * \brief DBManager::indexNoteTasks
+ * Replace the task rows of a note with the tasks found in content
+ * \param noteId
+ * \param content
+ */
+void DBManager::indexNoteTasks(int noteId, const QString &content)
+{
+    removeNoteTasks(noteId);
+    const auto tasks = MarkdownText::tasks(content);
+    if (tasks.isEmpty()) {
+        return;
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(INSERT INTO "note_task" ("node_id", "line", "column_title", "is_checked", "task_text") )"
+                       R"(VALUES (:node_id, :line, :column_title, :is_checked, :task_text);)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    for (const auto &task : tasks) {
+        query.bindValue(QStringLiteral(":node_id"), noteId);
+        query.bindValue(QStringLiteral(":line"), task.line);
+        query.bindValue(QStringLiteral(":column_title"), task.column);
+        query.bindValue(QStringLiteral(":is_checked"), task.isChecked ? 1 : 0);
+        query.bindValue(QStringLiteral(":task_text"), task.text);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+    }
+}
+
+/*!
+ * \brief DBManager::indexAllNoteTasks
+ * Fill note_task from the content of every note with an id of at least
+ * firstNodeId, for databases created before the task index existed and for
+ * notes imported in bulk
+ * \param firstNodeId
+ */
+void DBManager::indexAllNoteTasks(int firstNodeId)
+{
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.prepare(R"(SELECT "id", "content" FROM node_table WHERE node_type = :node_type AND id >= :first_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    query.bindValue(QStringLiteral(":first_id"), firstNodeId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    while (query.next()) {
+        indexNoteTasks(query.value(0).toInt(), decodeNoteContent(query.value(1)));
+    }
+    query.finish();
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::removeNoteTasks
+ * \param noteId
+ */
+void DBManager::removeNoteTasks(int noteId)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(DELETE FROM "note_task" WHERE node_id = :node_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::indexNoteSearch
+ * Add the content of a note to note_search. It must be what node_table
+ * holds for the note, removeNoteSearch() reads it back from there.
+ * \param noteId
+ * \param content
+ */
+void DBManager::indexNoteSearch(int noteId, const QString &content)
+{
+    if (!m_hasNoteSearchIndex) {
+        return;
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(INSERT INTO "note_search" ("rowid", "content") VALUES (:node_id, :content);)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    query.bindValue(QStringLiteral(":content"), content);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::removeNoteSearch
+ * Remove a note from note_search before its content in node_table changes
+ * or goes away: a contentless table needs the indexed text to delete it
+ * \param noteId
+ */
+void DBManager::removeNoteSearch(int noteId)
+{
+    if (!m_hasNoteSearchIndex) {
+        return;
+    }
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "content" FROM node_table WHERE id = :id AND node_type = :node_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), noteId);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (!query.exec() || !query.next()) {
+        return;
+    }
+    QString content = decodeNoteContent(query.value(0));
+    query.clear();
+    if (!query.prepare(R"(INSERT INTO "note_search" ("note_search", "rowid", "content") VALUES ('delete', :node_id, :content);)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    query.bindValue(QStringLiteral(":content"), content);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::indexAllNoteSearch
+ * Fill note_search from the content of every note with an id of at least
+ * firstNodeId, for databases created before the search index existed and
+ * for notes imported in bulk
+ * \param firstNodeId
+ */
+void DBManager::indexAllNoteSearch(int firstNodeId)
+{
+    if (!m_hasNoteSearchIndex) {
+        return;
+    }
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.prepare(R"(SELECT "id", "content" FROM node_table WHERE node_type = :node_type AND id >= :first_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    query.bindValue(QStringLiteral(":first_id"), firstNodeId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return;
+    }
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    while (query.next()) {
+        indexNoteSearch(query.value(0).toInt(), decodeNoteContent(query.value(1)));
+    }
+    query.finish();
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+}
+
+/*!
+ * \brief DBManager::readNoteTasks
+ * Execute a query selecting node_id, title, line, column_title, is_checked
+ * and task_text, and collect its rows
+ * \param query
+ * \return
+ */
+QVector<NoteTask> DBManager::readNoteTasks(QSqlQuery &query)
+{
+    QVector<NoteTask> tasks;
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return tasks;
+    }
+    while (query.next()) {
+        NoteTask task;
+        task.noteId = query.value(0).toInt();
+        task.noteTitle = query.value(1).toString();
+        task.line = query.value(2).toInt();
+        task.column = query.value(3).toString();
+        task.isChecked = query.value(4).toInt() != 0;
+        task.text = query.value(5).toString();
+        tasks.append(task);
+    }
+    return tasks;
+}
+
+/*!
+ * \brief DBManager::getOpenTasks
+ * Unchecked tasks of every note outside of the trash, most recently
+ * modified notes first
+ * \return
+ */
+QVector<NoteTask> DBManager::getOpenTasks()
+{
+    updateNoteTaskIndex();
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT t.node_id, n.title, t.line, t.column_title, t.is_checked, t.task_text )"
+                       R"(FROM note_task t JOIN node_table n ON n.id = t.node_id )"
+                       R"(WHERE t.is_checked = 0 AND n.parent_id != :trash_id )"
+                       R"(ORDER BY n.modification_date DESC, t.node_id, t.line;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":trash_id"), TRASH_FOLDER_ID);
+    return readNoteTasks(query);
+}
+
+/*!
+ * \brief DBManager::getTasksByTag
+ * Tasks of the notes with a tag, outside of the trash
+ * \param tagId
+ * \param isOpenOnly leave out the checked tasks
+ * \return
+ */
+QVector<NoteTask> DBManager::getTasksByTag(int tagId, bool isOpenOnly)
+{
+    updateNoteTaskIndex();
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT t.node_id, n.title, t.line, t.column_title, t.is_checked, t.task_text )"
+                       R"(FROM tag_relationship r JOIN note_task t ON t.node_id = r.node_id JOIN node_table n ON n.id = t.node_id )"
+                       R"(WHERE r.tag_id = :tag_id AND t.is_checked <= :max_checked AND n.parent_id != :trash_id )"
+                       R"(ORDER BY n.modification_date DESC, t.node_id, t.line;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":tag_id"), tagId);
+    query.bindValue(QStringLiteral(":max_checked"), isOpenOnly ? 0 : 1);
+    query.bindValue(QStringLiteral(":trash_id"), TRASH_FOLDER_ID);
+    return readNoteTasks(query);
+}
+
+/*!
+ * \brief DBManager::getTasksInFolder
+ * Tasks of the notes in a folder and its subfolders
+ * \param folderId
+ * \param isOpenOnly leave out the checked tasks
+ * \return
+ */
+QVector<NoteTask> DBManager::getTasksInFolder(int folderId, bool isOpenOnly)
+{
+    updateNoteTaskIndex();
+    QString folderPath = getNodeAbsolutePath(folderId).path();
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT t.node_id, n.title, t.line, t.column_title, t.is_checked, t.task_text )"
+                       R"(FROM node_table n JOIN note_task t ON t.node_id = n.id )"
+                       R"(WHERE n.absolute_path > :lower_bound AND n.absolute_path < :upper_bound AND n.node_type = :node_type )"
+                       R"(AND t.is_checked <= :max_checked )"
+                       R"(ORDER BY n.modification_date DESC, t.node_id, t.line;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":lower_bound"), subtreeLowerBound(folderPath));
+    query.bindValue(QStringLiteral(":upper_bound"), subtreeUpperBound(folderPath));
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    query.bindValue(QStringLiteral(":max_checked"), isOpenOnly ? 0 : 1);
+    return readNoteTasks(query);
+}
+
+/*!
+ * \brief DBManager::onTaskBoardRequested
+ * Send the open tasks of the whole library, for the global task board
+ */
+void DBManager::onTaskBoardRequested()
+{
+    emit taskBoardReceived(getOpenTasks());
+}
+
+/*!
+ * \brief DBManager::onTaskBoardInFolderRequested
+ * Send the open tasks of the notes in a folder and its subfolders
+ * \param folderId
+ */
+void DBManager::onTaskBoardInFolderRequested(int folderId)
+{
+    emit taskBoardReceived(getTasksInFolder(folderId));
+}
+
+/*!
+ * \brief DBManager::onTaskBoardInTagRequested
+ * Send the open tasks of the notes with a tag
+ * \param tagId
+ */
+void DBManager::onTaskBoardInTagRequested(int tagId)
+{
+    emit taskBoardReceived(getTasksByTag(tagId));
+}
+
+/*!
+ * \brief DBManager::getNoteRevisions
+ * History of a note, newest first. The content of a revision is read
+ * separately with getNoteRevisionContent()
+ * \param noteId
+ * \return
+ */
+QVector<NoteRevision> DBManager::getNoteRevisions(int noteId)
+{
+    QVector<NoteRevision> revisions;
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "id", "base_id", "creation_date", "title" FROM "note_revision" )"
+                       R"(WHERE node_id = :node_id ORDER BY id DESC;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_id"), noteId);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return revisions;
+    }
+    while (query.next()) {
+        NoteRevision revision;
+        revision.id = query.value(0).toInt();
+        revision.noteId = noteId;
+        revision.isSnapshot = query.value(1).toInt() == INVALID_NODE_ID;
+        revision.creationDateTime = QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong());
+        revision.title = query.value(3).toString();
+        revisions.append(revision);
+    }
+    return revisions;
+}
+
+/*!
+ * \brief DBManager::getNoteRevisionContent
+ * \param revisionId
+ * \return
+ */
+QString DBManager::getNoteRevisionContent(int revisionId)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "base_id", "data" FROM "note_revision" WHERE id = :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), revisionId);
+    if (!query.exec() || !query.next()) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Can't find revision" << revisionId << query.lastError();
+        return QString();
+    }
+    int baseId = query.value(0).toInt();
+    auto data = query.value(1).toByteArray();
+    if (baseId == INVALID_NODE_ID) {
+        return QString::fromUtf8(qUncompress(data));
+    }
+    return applyRevisionDelta(getNoteRevisionContent(baseId), data);
+}
+
+QList<NodeData> DBManager::readOldNBK(const QString &fileName)
+{
+    QList<NodeData> noteList;
+    {
+        QFile file(fileName);
+        file.open(QIODevice::ReadOnly);
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_6);
+
+        try {
+            in >> noteList;
+        } catch (...) {
+            // Any exception deserializing will result in an empty note list and  the user will be
+            // notified
+        }
+        file.close();
+    }
+    if (noteList.isEmpty()) {
+        QFile file(fileName);
+        file.open(QIODevice::ReadOnly);
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_5_6);
+
+        QList<NodeData *> nl;
+        try {
+            in >> nl;
+        } catch (...) {
+            // Any exception deserializing will result in an empty note list and  the user will be
+            // notified
+        }
+        if (!nl.isEmpty()) {
+            for (const auto &n : std::as_const(nl)) {
+                noteList.append(*n);
+            }
+        }
+        qDeleteAll(nl);
+        file.close();
+    }
+    return noteList;
+}
+
+int DBManager::nextAvailablePosition(int parentId, NodeData::Type nodeType)
+{
+    QSqlQuery query(m_db);
+    int relationalPosition = 0;
+    if (parentId != -1) {
+        if (!query.prepare(R"(SELECT relative_position FROM "node_table" )"
+                           R"(WHERE parent_id = :parent_id AND node_type = :node_type;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(":parent_id", parentId);
+        query.bindValue(":node_type", static_cast<int>(nodeType));
+        bool status = query.exec();
+        if (status) {
+            while (query.next()) {
+                if (relationalPosition <= query.value(0).toInt()) {
+                    relationalPosition = query.value(0).toInt() + 1;
+                }
+            }
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.finish();
+    }
+    return relationalPosition;
+}
+
+NodePath DBManager::getNodeAbsolutePath(int nodeId)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare("SELECT absolute_path FROM node_table WHERE id = :id")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":id", nodeId);
+    bool status = query.exec();
+    if (!status) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError() << query.isValid();
+    }
+    query.last();
+    auto absolutePath = query.value(0).toString();
+    return absolutePath;
+}
+
+NodeData DBManager::getNode(int nodeId)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT)"
+                       R"("id",)"
+                       R"("title",)"
+                       R"("creation_date",)"
+                       R"("modification_date",)"
+                       R"("deletion_date",)"
+                       R"("content",)"
+                       R"("node_type",)"
+                       R"("parent_id",)"
+                       R"("relative_position",)"
+                       R"("scrollbar_position",)"
+                       R"("absolute_path", )"
+                       R"("is_pinned_note", )"
+                       R"("relative_position_an", )"
+                       R"("child_notes_count" )"
+                       R"(FROM node_table WHERE id=:id LIMIT 1;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":id", nodeId);
+    bool status = query.exec();
+    if (status) {
+        query.next();
+        NodeData node;
+        node.setId(query.value(0).toInt());
+        node.setFullTitle(query.value(1).toString());
+        node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
+        node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+        node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
+        node.setContent(decodeNoteContent(query.value(5)));
+        node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
+        node.setParentId(query.value(7).toInt());
+        node.setRelativePosition(query.value(8).toInt());
+        node.setScrollBarPosition(query.value(9).toInt());
+        node.setAbsolutePath(query.value(10).toString());
+        node.setIsPinnedNote(static_cast<bool>(query.value(11).toInt()));
+        node.setRelativePosAN(query.value(13).toInt());
+        node.setRelativePosAN(query.value(14).toInt());
+        if (node.nodeType() == NodeData::Type::Note) {
+            node.setTagIds(getAllTagForNote(node.id()));
+            QSqlQuery query2(m_db);
+            if (!query2.prepare(R"(SELECT)"
+                                R"("title" )"
+                                R"(FROM node_table WHERE id=:id LIMIT 1;)")) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            query2.bindValue(":id", node.parentId());
+            if (query2.exec()) {
+                query2.next();
+                node.setParentName(query2.value(0).toString());
+            } else {
+                qDebug() << __FUNCTION__ << __LINE__ << query2.lastError();
+            }
+            applyPendingNoteEdits(node);
+        }
+        return node;
+    }
+    qDebug() << "Can't find node with id" << nodeId << ": " << query.lastError();
+    return NodeData();
+}
+
+void DBManager::moveFolderToTrash(const NodeData &node)
+{
+    const QString lowerBound = subtreeLowerBound(node.absolutePath());
+    const QString upperBound = subtreeUpperBound(node.absolutePath());
+    QSqlQuery query(m_db);
+
+    // Collect how many notes of each tag are about to leave, before they move
+    QMap<int, int> tagNotesCount;
+    if (!query.prepare(R"(SELECT tag_id, count(*) FROM tag_relationship WHERE node_id IN )"
+                       R"((SELECT id FROM node_table WHERE absolute_path > :lower_bound AND absolute_path < :upper_bound AND node_type = :node_type) )"
+                       R"(GROUP BY tag_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":lower_bound"), lowerBound);
+    query.bindValue(QStringLiteral(":upper_bound"), upperBound);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (query.exec()) {
+        while (query.next()) {
+            tagNotesCount[query.value(0).toInt()] = query.value(1).toInt();
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    int notesCount = countNotesInSubtree(node.absolutePath());
+
+    // As in moveNode(), the caller commits when it already opened a transaction
+    bool isTransactionStarted = m_db.transaction();
+    if (!isTransactionStarted) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    if (!query.prepare(QStringLiteral("UPDATE node_table SET parent_id = :parent_id, absolute_path = :trash_path || :separator || id, "
+                                      "is_pinned_note = :is_pinned_note, deletion_date = :deletion_date "
+                                      "WHERE absolute_path > :lower_bound AND absolute_path < :upper_bound AND node_type = :node_type;"))) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(TRASH_FOLDER_ID));
+    query.bindValue(QStringLiteral(":trash_path"), NodePath::getTrashFolderPath());
+    query.bindValue(QStringLiteral(":separator"), QString(PATH_SEPARATOR));
+    query.bindValue(QStringLiteral(":is_pinned_note"), false);
+    query.bindValue(QStringLiteral(":deletion_date"), QDateTime::currentMSecsSinceEpoch());
+    query.bindValue(QStringLiteral(":lower_bound"), lowerBound);
+    query.bindValue(QStringLiteral(":upper_bound"), upperBound);
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    if (!query.prepare(R"(DELETE FROM "node_table" )"
+                       R"(WHERE ((absolute_path > :lower_bound AND absolute_path < :upper_bound) OR id = :id) AND node_type = :node_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":lower_bound"), lowerBound);
+    query.bindValue(QStringLiteral(":upper_bound"), upperBound);
+    query.bindValue(QStringLiteral(":id"), node.id());
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Folder));
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    if (isTransactionStarted && !m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+
+    if (notesCount > 0) {
+        changeChildNotesCountFolder(TRASH_FOLDER_ID, notesCount);
+        changeChildNotesCountFolder(ROOT_FOLDER_ID, -notesCount);
+    }
+    for (auto it = tagNotesCount.constBegin(); it != tagNotesCount.constEnd(); ++it) {
+        changeChildNotesCountTag(it.key(), -it.value());
+    }
+}
+
+FolderListType DBManager::getFolderList()
+{
+    QMap<int, QString> result;
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "id", "title" FROM node_table WHERE id > 0 AND node_type = :node_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":node_type", static_cast<int>(NodeData::Type::Folder));
+    bool status = query.exec();
+    if (status) {
+        while (query.next()) {
+            result[query.value(0).toInt()] = query.value(1).toString();
+        }
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    return result;
+}
+
+void DBManager::moveNode(int nodeId, const NodeData &target)
+{
+    if (target.nodeType() != NodeData::Type::Folder) {
+        qDebug() << "moveNode target is not folder" << target.id();
+        return;
+    }
+    QSqlQuery query(m_db);
+    auto node = getNode(nodeId);
+
+    // Moving a folder touches the folder row and all of its descendants, which
+    // must happen atomically. The transaction may fail to start if the caller
+    // already opened one, in which case the caller is responsible for committing.
+    bool isTransactionStarted = false;
+    if (node.nodeType() == NodeData::Type::Folder) {
+        isTransactionStarted = m_db.transaction();
+        if (!isTransactionStarted) {
+            qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        }
+    }
+
+    QString newAbsolutePath = QStringLiteral("%1%2%3").arg(target.absolutePath(), PATH_SEPARATOR).arg(nodeId);
+    if (target.id() == TRASH_FOLDER_ID) {
+        qint64 deletionTime = QDateTime::currentMSecsSinceEpoch();
+        if (!query.prepare(QStringLiteral("UPDATE node_table SET parent_id = :parent_id, absolute_path = :absolute_path, "
                                           "is_pinned_note = :is_pinned_note, deletion_date = :deletion_date "
                                           "WHERE id = :id;"))) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
@@ -1228,50 +2613,38 @@ void DBManager::moveNode(int nodeId, const NodeData &target)
     }
 
     if (node.nodeType() == NodeData::Type::Folder) {
+        // Relocate the whole subtree with a single statement: every descendant keeps
+        // the part of its path below the moved folder and gets the new folder path
+        // as its prefix.
         const QString &oldAbsolutePath = node.absolutePath();
-        QMap<int, QString> children;
         query.clear();
-        if (!query.prepare(R"(SELECT id, absolute_path FROM "node_table" )"
-                           R"(WHERE absolute_path like (:path_expr) || '%';)")) {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        query.bindValue(QStringLiteral(":path_expr"), oldAbsolutePath);
-        if (query.exec()) {
-            while (query.next()) {
-                if (query.value(0).toInt() != node.id()) {
-                    children[query.value(0).toInt()] = query.value(1).toString();
-                }
+        if (target.id() == TRASH_FOLDER_ID) {
+            if (!query.prepare(QStringLiteral("UPDATE node_table SET absolute_path = :absolute_path || substr(absolute_path, :old_path_length + 1), "
+                                              "is_pinned_note = :is_pinned_note, deletion_date = :deletion_date "
+                                              "WHERE absolute_path > :lower_bound AND absolute_path < :upper_bound;"))) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
             }
+            query.bindValue(QStringLiteral(":is_pinned_note"), false);
+            query.bindValue(QStringLiteral(":deletion_date"), QDateTime::currentMSecsSinceEpoch());
         } else {
-            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-        }
-        for (const auto id : children.keys()) {
-            QString oldP = children[id];
-            QString newP = oldP.replace(oldP.indexOf(oldAbsolutePath), oldAbsolutePath.size(), newAbsolutePath);
-            if (target.id() == TRASH_FOLDER_ID) {
-                qint64 deletionTime = QDateTime::currentMSecsSinceEpoch();
-                if (!query.prepare(QStringLiteral("UPDATE node_table SET absolute_path = :absolute_path, is_pinned_note = "
-                                                  ":is_pinned_note, deletion_date = :deletion_date "
-                                                  "WHERE id = :id;"))) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                query.bindValue(QStringLiteral(":absolute_path"), newP);
-                query.bindValue(QStringLiteral(":id"), id);
-                query.bindValue(QStringLiteral(":is_pinned_note"), false);
-                query.bindValue(QStringLiteral(":deletion_date"), deletionTime);
-            } else {
-                if (!query.prepare(QStringLiteral("UPDATE node_table SET absolute_path = :absolute_path "
-                                                  "WHERE id = :id;"))) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                query.bindValue(QStringLiteral(":absolute_path"), newP);
-                query.bindValue(QStringLiteral(":id"), id);
-            }
-            if (!query.exec()) {
+            if (!query.prepare(QStringLiteral("UPDATE node_table SET absolute_path = :absolute_path || substr(absolute_path, :old_path_length + 1) "
+                                              "WHERE absolute_path > :lower_bound AND absolute_path < :upper_bound;"))) {
                 qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
             }
         }
-        recalculateChildNotesCount();
+        query.bindValue(QStringLiteral(":absolute_path"), newAbsolutePath);
+        query.bindValue(QStringLiteral(":old_path_length"), oldAbsolutePath.size());
+        query.bindValue(QStringLiteral(":lower_bound"), subtreeLowerBound(oldAbsolutePath));
+        query.bindValue(QStringLiteral(":upper_bound"), subtreeUpperBound(oldAbsolutePath));
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        if (isTransactionStarted && !m_db.commit()) {
+            qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        }
+        // Folder counts only include direct child notes and the "All Notes" count only
+        // excludes notes placed directly in the trash, so relocating a subtree leaves
+        // every count as it was and there is nothing to recalculate.
     } else {
         decreaseChildNotesCountFolder(node.parentId());
         if (node.parentId() != TRASH_FOLDER_ID && target.id() == TRASH_FOLDER_ID) {
@@ -1293,10 +2666,16 @@ void DBManager::moveNode(int nodeId, const NodeData &target)
 
 void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
 {
+    // content is matched in SQL, so it has to be up to date in node_table
+    compactAllNoteEditLogs();
+    bool isSearchIndexed = m_hasNoteSearchIndex && keyword.size() >= NOTE_SEARCH_MIN_KEYWORD_LENGTH;
+    QString searchCondition = isSearchIndexed ? QStringLiteral(R"(AND id IN (SELECT rowid FROM note_search WHERE note_search MATCH (:search_expr));)")
+                                              : QStringLiteral(R"(AND (content_compressed = 1 OR content like  '%' || (:search_expr) || '%');)");
+    QString searchExpr = isSearchIndexed ? noteSearchPhrase(keyword) : keyword;
     QVector<NodeData> nodeList;
     QSqlQuery query(m_db);
     if (!inf.isInTag && inf.parentFolderId == ROOT_FOLDER_ID) {
-        if (!query.prepare(R"(SELECT )"
+        if (!query.prepare(QString(R"(SELECT )"
                            R"("id",)"
                            R"("title",)"
                            R"("creation_date",)"
@@ -1312,13 +2691,13 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
                            R"("relative_position_an", )"
                            R"("child_notes_count" )"
                            R"(FROM node_table )"
-                           R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id) )"
-                           R"(AND content like  '%' || (:search_expr) || '%';)")) {
+                           R"(WHERE node_type = (:node_type) AND parent_id != (:parent_id) )")
+                           + searchCondition)) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
         query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(TRASH_FOLDER_ID));
-        query.bindValue(QStringLiteral(":search_expr"), keyword);
+        query.bindValue(QStringLiteral(":search_expr"), searchExpr);
 
         bool status = query.exec();
         if (status) {
@@ -1329,7 +2708,11 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
                 node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                node.setContent(decodeNoteContent(query.value(5)));
+                // without the search index, compressed contents can't be matched in SQL
+                if (!isSearchIndexed && isCompressedContent(query.value(5)) && !node.content().contains(keyword, Qt::CaseInsensitive)) {
+                    continue;
+                }
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
@@ -1347,7 +2730,7 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
     } else if (!inf.isInTag) {
-        if (!query.prepare(R"(SELECT )"
+        if (!query.prepare(QString(R"(SELECT )"
                            R"("id",)"
                            R"("title",)"
                            R"("creation_date",)"
@@ -1363,13 +2746,13 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
                            R"("relative_position_an", )"
                            R"("child_notes_count" )"
                            R"(FROM node_table )"
-                           R"(WHERE node_type = (:node_type) AND parent_id == (:parent_id) )"
-                           R"(AND content like  '%' || (:search_expr) || '%';)")) {
+                           R"(WHERE node_type = (:node_type) AND parent_id == (:parent_id) )")
+                           + searchCondition)) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
         query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
         query.bindValue(QStringLiteral(":parent_id"), static_cast<int>(inf.parentFolderId));
-        query.bindValue(QStringLiteral(":search_expr"), keyword);
+        query.bindValue(QStringLiteral(":search_expr"), searchExpr);
 
         bool status = query.exec();
         if (status) {
@@ -1380,7 +2763,11 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
                 node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                node.setContent(decodeNoteContent(query.value(5)));
+                // without the search index, compressed contents can't be matched in SQL
+                if (!isSearchIndexed && isCompressedContent(query.value(5)) && !node.content().contains(keyword, Qt::CaseInsensitive)) {
+                    continue;
+                }
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
@@ -1419,6 +2806,21 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
             emit notesListReceived(nodeList, inf);
             return;
         }
+        if (isSearchIndexed) {
+            QSet<int> nd;
+            if (!query.prepare(R"(SELECT rowid FROM note_search WHERE note_search MATCH (:search_expr);)")) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            query.bindValue(QStringLiteral(":search_expr"), searchExpr);
+            if (query.exec()) {
+                while (query.next()) {
+                    nd.insert(query.value(0).toInt());
+                }
+            } else {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            nds.append(nd);
+        }
         QSet<int> noteIds;
         int ndsId = 0;
         for (int i = 1; i < nds.size(); ++i) {
@@ -1442,7 +2844,8 @@ void DBManager::searchForNotes(const QString &keyword, const ListViewInfo &inf)
         }
         for (const auto &id : noteIds) {
             NodeData node = getNode(id);
-            if (node.id() != INVALID_NODE_ID && node.nodeType() == NodeData::Type::Note && node.content().contains(keyword)) {
+            if (node.id() != INVALID_NODE_ID && node.nodeType() == NodeData::Type::Note
+                && (isSearchIndexed || node.content().contains(keyword, Qt::CaseInsensitive))) {
                 nodeList.append(node);
             } else {
                 qDebug() << __FUNCTION__ << "Note with id" << id << "is not valid";
@@ -1577,9 +2980,94 @@ void DBManager::onNodeTagTreeRequested()
     NodeTagTreeData d;
     d.nodeTreeData = getAllFolders();
     d.tagTreeData = getAllTagInfo();
+    m_lastTreeFolders.clear();
+    for (const auto &folder : std::as_const(d.nodeTreeData)) {
+        m_lastTreeFolders[folder.id()] = folder;
+    }
+    m_lastTreeTags.clear();
+    for (const auto &tag : std::as_const(d.tagTreeData)) {
+        m_lastTreeTags[tag.id()] = tag;
+    }
+    m_hasLastTree = true;
     emit nodesTagTreeReceived(d);
 }
 
+/*!
+ * \brief DBManager::emitNodeTagTreeChanges
+ * Compare the folders and tags in the database with the tree that was last
+ * sent and only emit what changed, so bulk operations update the tree in place
+ * instead of rebuilding it. Counts are not compared here: every caller
+ * recalculates them first, which already emits a signal per folder and tag.
+ */
+void DBManager::emitNodeTagTreeChanges()
+{
+    if (!m_hasLastTree) {
+        onNodeTagTreeRequested();
+        return;
+    }
+    auto folders = getAllFolders();
+    auto tags = getAllTagInfo();
+
+    QHash<int, NodeData> folderMap;
+    folderMap.reserve(folders.size());
+    QVector<NodeData> addedFolders;
+    for (const auto &folder : std::as_const(folders)) {
+        folderMap[folder.id()] = folder;
+        if (!m_lastTreeFolders.contains(folder.id())) {
+            addedFolders.append(folder);
+        }
+    }
+    // parents have to exist in the tree before their children are added
+    std::stable_sort(addedFolders.begin(), addedFolders.end(), [](const NodeData &a, const NodeData &b) {
+        return a.absolutePath().count(PATH_SEPARATOR) < b.absolutePath().count(PATH_SEPARATOR);
+    });
+    for (const auto &folder : std::as_const(addedFolders)) {
+        emit folderAdded(folder);
+    }
+    for (const auto &folder : std::as_const(folders)) {
+        auto last = m_lastTreeFolders.constFind(folder.id());
+        if (last == m_lastTreeFolders.constEnd()) {
+            continue;
+        }
+        if (last->parentId() != folder.parentId()) {
+            emit folderMoved(folder.id(), folder.parentId());
+        }
+        if (last->fullTitle() != folder.fullTitle()) {
+            emit folderRenamed(folder.id(), folder.fullTitle());
+        }
+    }
+    for (auto it = m_lastTreeFolders.constBegin(); it != m_lastTreeFolders.constEnd(); ++it) {
+        if (!folderMap.contains(it.key())) {
+            emit folderRemoved(it.key());
+        }
+    }
+
+    QHash<int, TagData> tagMap;
+    tagMap.reserve(tags.size());
+    for (const auto &tag : std::as_const(tags)) {
+        tagMap[tag.id()] = tag;
+        auto last = m_lastTreeTags.constFind(tag.id());
+        if (last == m_lastTreeTags.constEnd()) {
+            emit tagAdded(tag);
+            continue;
+        }
+        if (last->name() != tag.name()) {
+            emit tagRenamed(tag.id(), tag.name());
+        }
+        if (last->color() != tag.color()) {
+            emit tagColorChanged(tag.id(), tag.color());
+        }
+    }
+    for (auto it = m_lastTreeTags.constBegin(); it != m_lastTreeTags.constEnd(); ++it) {
+        if (!tagMap.contains(it.key())) {
+            emit tagRemoved(it.key());
+        }
+    }
+
+    m_lastTreeFolders = folderMap;
+    m_lastTreeTags = tagMap;
+}
+
 /*!
  * \brief DBManager::onNotesListRequested
  */
@@ -1619,7 +3107,7 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
                 node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                node.setContent(decodeNoteContent(query.value(5)));
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
@@ -1631,6 +3119,7 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setTagIds(getAllTagForNote(node.id()));
                 auto p = getNode(node.parentId());
                 node.setParentName(p.fullTitle());
+                applyPendingNoteEdits(node);
                 nodeList.append(node);
             }
         } else {
@@ -1667,7 +3156,7 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
                 node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                node.setContent(decodeNoteContent(query.value(5)));
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
@@ -1677,13 +3166,14 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setRelativePosAN(query.value(13).toInt());
                 node.setChildNotesCount(query.value(14).toInt());
                 node.setTagIds(getAllTagForNote(node.id()));
+                applyPendingNoteEdits(node);
                 nodeList.append(node);
             }
         } else {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
     } else {
-        auto parentPath = getNodeAbsolutePath(parentID).path() + PATH_SEPARATOR;
+        auto parentPath = getNodeAbsolutePath(parentID).path();
         if (!query.prepare(R"(SELECT )"
                            R"("id",)"
                            R"("title",)"
@@ -1700,10 +3190,11 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                            R"("relative_position_an", )"
                            R"("child_notes_count" )"
                            R"(FROM node_table )"
-                           R"(WHERE absolute_path like (:path_expr) || '%' AND node_type = (:node_type);)")) {
+                           R"(WHERE absolute_path > (:lower_bound) AND absolute_path < (:upper_bound) AND node_type = (:node_type);)")) {
             qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
         }
-        query.bindValue(QStringLiteral(":path_expr"), parentPath);
+        query.bindValue(QStringLiteral(":lower_bound"), subtreeLowerBound(parentPath));
+        query.bindValue(QStringLiteral(":upper_bound"), subtreeUpperBound(parentPath));
         query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
 
         bool status = query.exec();
@@ -1715,7 +3206,7 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
                 node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
                 node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
-                node.setContent(query.value(5).toString());
+                node.setContent(decodeNoteContent(query.value(5)));
                 node.setNodeType(static_cast<NodeData::Type>(query.value(6).toInt()));
                 node.setParentId(query.value(7).toInt());
                 node.setRelativePosition(query.value(8).toInt());
@@ -1725,6 +3216,7 @@ void DBManager::onNotesListInFolderRequested(int parentID, bool isRecursive, boo
                 node.setRelativePosAN(query.value(13).toInt());
                 node.setChildNotesCount(query.value(14).toInt());
                 node.setTagIds(getAllTagForNote(node.id()));
+                applyPendingNoteEdits(node);
                 nodeList.append(node);
             }
         } else {
@@ -1823,19 +3315,70 @@ void DBManager::onOpenDBManagerRequested(const QString &path, bool doCreate)
  * \brief DBManager::onCreateUpdateRequested
  * \param note
  */
-void DBManager::onCreateUpdateRequestedNoteContent(const NodeData &note)
+void DBManager::onCreateUpdateRequestedNoteContent(const NodeData &note)
+{
+    if (note.nodeType() != NodeData::Type::Note) {
+        qDebug() << "Wrong node type";
+        return;
+    }
+    bool exists = isNodeExist(note);
+
+    if (exists) {
+        updateNoteContent(note);
+    } else {
+        addNode(note);
+    }
+    addNoteRevision(note, false);
+}
+
+/*!
+ * \brief DBManager::onNoteEditClosed
+ * \param note
+ */
+void DBManager::onNoteEditClosed(const NodeData &note)
+{
+    if (isNodeExist(note)) {
+        addNoteRevision(note, true);
+    }
+}
+
+/*!
+ * \brief DBManager::onNoteRevisionsRequested
+ * \param noteId
+ */
+void DBManager::onNoteRevisionsRequested(int noteId)
+{
+    emit noteRevisionsReceived(noteId, getNoteRevisions(noteId));
+}
+
+/*!
+ * \brief DBManager::restoreNoteRevision
+ * Bring a note back to one of its revisions. What the note contained
+ * before is recorded as a revision first, so restoring can be undone
+ * \param revisionId
+ */
+void DBManager::restoreNoteRevision(int revisionId)
 {
-    if (note.nodeType() != NodeData::Type::Note) {
-        qDebug() << "Wrong node type";
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "node_id", "title" FROM "note_revision" WHERE id = :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":id"), revisionId);
+    if (!query.exec() || !query.next()) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Can't find revision" << revisionId << query.lastError();
         return;
     }
-    bool exists = isNodeExist(note);
-
-    if (exists) {
-        updateNoteContent(note);
-    } else {
-        addNode(note);
+    auto note = getNode(query.value(0).toInt());
+    QString title = query.value(1).toString();
+    if (note.id() == INVALID_NODE_ID || note.nodeType() != NodeData::Type::Note) {
+        return;
     }
+    addNoteRevision(note, true);
+    note.setContent(getNoteRevisionContent(revisionId));
+    note.setFullTitle(title);
+    note.setLastModificationDateTime(QDateTime::currentDateTime());
+    updateNoteContent(note);
+    emit noteRevisionRestored(note);
 }
 
 /*!
@@ -1852,306 +3395,8 @@ void DBManager::onImportNotesRequested(const QString &fileName)
     auto const magicHeader = file.read(16);
     file.close();
     if (QString::fromUtf8(magicHeader).startsWith(QStringLiteral("SQLite format 3"))) {
-        qDebug() << __FUNCTION__;
-        auto outsideDatabase = QSqlDatabase::addDatabase("QSQLITE", OUTSIDE_DATABASE_NAME);
-        outsideDatabase.setDatabaseName(fileName);
-        if (!outsideDatabase.open()) {
-            qDebug() << __FUNCTION__ << "Error: connection with database fail";
-            return;
-        }
-        qDebug() << __FUNCTION__ << "Database: connection ok";
-
-        QMap<int, int> folderIdMap;
-        QMap<int, int> noteIdMap;
-        QMap<int, int> tagIdMap;
-        {
-            QVector<TagData> tagList;
-            QSqlQuery outQuery(outsideDatabase);
-            if (!outQuery.prepare(R"(SELECT "id","name","color","relative_position","child_notes_count" FROM tag_table;)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-            bool status = outQuery.exec();
-            if (status) {
-                while (outQuery.next()) {
-                    TagData tag;
-                    tag.setId(outQuery.value(0).toInt());
-                    tag.setName(outQuery.value(1).toString());
-                    tag.setColor(outQuery.value(2).toString());
-                    tag.setRelativePosition(outQuery.value(3).toInt());
-                    tag.setChildNotesCount(outQuery.value(4).toInt());
-                    tagList.append(tag);
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-            outQuery.finish();
-            std::sort(tagList.begin(), tagList.end(), [](auto const &a, auto const &b) { return a.relativePosition() < b.relativePosition(); });
-            for (const auto &tag : std::as_const(tagList)) {
-                QSqlQuery query(m_db);
-                if (!query.prepare(R"(SELECT "id" FROM tag_table WHERE name = :name AND color = :color;)")) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                query.bindValue(QStringLiteral(":name"), tag.name());
-                query.bindValue(QStringLiteral(":color"), tag.color());
-                QVector<int> ids;
-                if (query.exec()) {
-                    while (query.next()) {
-                        ids.append(query.value(0).toInt());
-                    }
-                } else {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                query.finish();
-                if (ids.isEmpty()) {
-                    ids.append(addTag(tag));
-                }
-                tagIdMap[tag.id()] = ids[0];
-            }
-        }
-        {
-            folderIdMap[ROOT_FOLDER_ID] = ROOT_FOLDER_ID;
-            folderIdMap[TRASH_FOLDER_ID] = TRASH_FOLDER_ID;
-            folderIdMap[DEFAULT_NOTES_FOLDER_ID] = DEFAULT_NOTES_FOLDER_ID;
-            QSqlQuery outQuery(outsideDatabase);
-            if (!outQuery.prepare(R"(SELECT)"
-                                  R"("id",)"
-                                  R"("title",)"
-                                  R"("creation_date",)"
-                                  R"("modification_date",)"
-                                  R"("deletion_date",)"
-                                  R"("content",)"
-                                  R"("node_type",)"
-                                  R"("parent_id",)"
-                                  R"("relative_position",)"
-                                  R"("absolute_path" )"
-                                  R"(FROM node_table WHERE node_type=:node_type;)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-            outQuery.bindValue(":node_type", static_cast<int>(NodeData::Type::Folder));
-            bool status = outQuery.exec();
-            QMap<int, NodeData> nodeList;
-            if (status) {
-                while (outQuery.next()) {
-                    NodeData node;
-                    node.setId(outQuery.value(0).toInt());
-                    node.setFullTitle(outQuery.value(1).toString());
-                    node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(2).toLongLong()));
-                    node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(3).toLongLong()));
-                    node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(4).toLongLong()));
-                    node.setContent(outQuery.value(5).toString());
-                    node.setNodeType(static_cast<NodeData::Type>(outQuery.value(6).toInt()));
-                    node.setParentId(outQuery.value(7).toInt());
-                    node.setRelativePosition(outQuery.value(8).toInt());
-                    node.setAbsolutePath(outQuery.value(9).toString());
-                    nodeList[node.id()] = node;
-                }
-                auto matchFolderFunc = [&](int id, const auto &matchFolderFunctor) {
-                    if (!nodeList.contains(id)) {
-                        qDebug() << __FUNCTION__ << __LINE__ << "node not found";
-                        return;
-                    }
-                    if (folderIdMap.contains(id)) {
-                        return;
-                    }
-                    auto node = nodeList[id];
-                    if (folderIdMap.contains(node.parentId())) {
-                        QSqlQuery query(m_db);
-                        if (!query.prepare(R"(SELECT "id" FROM node_table WHERE title = :title AND node_type = :node_type AND parent_id = :parent_id;)")) {
-                            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                        }
-                        query.bindValue(QStringLiteral(":title"), node.fullTitle());
-                        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Folder));
-                        query.bindValue(QStringLiteral(":parent_id"), folderIdMap[node.parentId()]);
-                        QVector<int> ids;
-                        if (query.exec()) {
-                            while (query.next()) {
-                                ids.append(query.value(0).toInt());
-                            }
-                        } else {
-                            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                        }
-                        query.finish();
-                        if (!ids.isEmpty()) {
-                            folderIdMap[id] = ids[0];
-                        } else {
-                            node.setParentId(folderIdMap[node.parentId()]);
-                            int newId = addNode(node);
-                            folderIdMap[id] = newId;
-                        }
-                    } else {
-                        auto prL = NodePath(node.absolutePath()).separate();
-                        for (const auto &pr : std::as_const(prL)) {
-                            matchFolderFunctor(pr.toInt(), matchFolderFunctor);
-                        }
-                    }
-                };
-
-                Folder *rootFolder = nullptr;
-                QHash<int, Folder> needImportFolderMap;
-                for (const auto &node : std::as_const(nodeList)) {
-                    Folder f;
-                    f.id = node.id();
-                    f.parentId = node.parentId();
-                    needImportFolderMap[node.id()] = f;
-                    if (f.id == ROOT_FOLDER_ID) {
-                        rootFolder = &needImportFolderMap[node.id()];
-                    }
-                }
-                if (rootFolder != nullptr) {
-                    for (const auto &folder : std::as_const(needImportFolderMap)) {
-                        if (folder.id != ROOT_FOLDER_ID) {
-                            needImportFolderMap[folder.parentId].children.push_back(&needImportFolderMap[folder.id]);
-                        }
-                    }
-                    auto sortChildFunc = [&](Folder *f) {
-                        std::sort(f->children.begin(), f->children.end(), [&](Folder const *f1, Folder const *f2) {
-                            return nodeList[f1->id].relativePosition() < nodeList[f2->id].relativePosition();
-                        });
-                    };
-                    auto sortFunc = [&](Folder *f, const auto &sf) -> void {
-                        sortChildFunc(f);
-                        for (auto *c : f->children) {
-                            sf(c, sf);
-                        }
-                    };
-                    sortFunc(rootFolder, sortFunc);
-                    auto matchFunc = [&](Folder *f, const auto &mf) -> void {
-                        matchFolderFunc(f->id, matchFolderFunc);
-                        for (auto *c : f->children) {
-                            mf(c, mf);
-                        }
-                    };
-                    matchFunc(rootFolder, matchFunc);
-                } else {
-                    qDebug() << __FUNCTION__ << "Error while keeping folder position";
-                    for (const auto &node : std::as_const(nodeList)) {
-                        matchFolderFunc(node.id(), matchFolderFunc);
-                    }
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-        }
-        {
-            QSqlQuery outQuery(outsideDatabase);
-            if (!outQuery.prepare(R"(SELECT)"
-                                  R"("id",)"
-                                  R"("title",)"
-                                  R"("creation_date",)"
-                                  R"("modification_date",)"
-                                  R"("deletion_date",)"
-                                  R"("content",)"
-                                  R"("node_type",)"
-                                  R"("parent_id",)"
-                                  R"("relative_position",)"
-                                  R"("scrollbar_position",)"
-                                  R"("absolute_path", )"
-                                  R"("is_pinned_note", )"
-                                  R"("relative_position_an" )"
-                                  R"(FROM node_table WHERE node_type=:node_type;)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-
-            outQuery.bindValue(":node_type", static_cast<int>(NodeData::Type::Note));
-            bool status = outQuery.exec();
-
-            QMap<int, std::pair<NodeData, int>> parents;
-            for (const auto &id : std::as_const(folderIdMap)) {
-                if (parents.contains(id)) {
-                    continue;
-                }
-                auto node = getNode(id);
-                auto rel = nextAvailablePosition(id, NodeData::Type::Note);
-                parents[id] = std::make_pair(node, rel);
-            }
-            if (status) {
-                QVector<NodeData> nodeList;
-                while (outQuery.next()) {
-                    NodeData node;
-                    node.setId(outQuery.value(0).toInt());
-                    node.setFullTitle(outQuery.value(1).toString());
-                    node.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(2).toLongLong()));
-                    node.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(3).toLongLong()));
-                    node.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(outQuery.value(4).toLongLong()));
-                    node.setContent(outQuery.value(5).toString());
-                    node.setNodeType(static_cast<NodeData::Type>(outQuery.value(6).toInt()));
-                    node.setParentId(outQuery.value(7).toInt());
-                    node.setRelativePosition(outQuery.value(8).toInt());
-                    node.setScrollBarPosition(outQuery.value(9).toInt());
-                    node.setAbsolutePath(outQuery.value(10).toString());
-                    node.setIsPinnedNote(static_cast<bool>(outQuery.value(11).toInt()));
-                    node.setRelativePosAN(outQuery.value(13).toInt());
-                    node.setChildNotesCount(outQuery.value(14).toInt());
-                    node.setTagIds(getAllTagForNote(node.id()));
-                    nodeList.append(node);
-                }
-                if (!m_db.transaction()) {
-                    qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
-                }
-                auto nodeId = nextAvailableNodeId();
-                for (auto node : std::as_const(nodeList)) {
-                    if (folderIdMap.contains(node.parentId()) && parents.contains(folderIdMap[node.parentId()])) {
-                        auto parentId = folderIdMap[node.parentId()];
-                        auto parent = parents[parentId].first;
-                        auto oldId = node.id();
-                        node.setId(nodeId);
-                        node.setRelativePosition(parents[parentId].second);
-                        node.setAbsolutePath(parent.absolutePath() + PATH_SEPARATOR + QString::number(nodeId));
-                        node.setParentId(parentId);
-                        addNodePreComputed(node);
-                        ++nodeId;
-                        parents[parentId].second = node.relativePosition() + 1;
-                        noteIdMap[oldId] = node.id();
-                    } else {
-                        qDebug() << __FUNCTION__ << __LINE__ << "can't find parent for note";
-                    }
-                }
-                QSqlQuery query(m_db);
-                if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                query.bindValue(":value", nodeId + 1);
-                if (!query.exec()) {
-                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
-                }
-                if (!m_db.commit()) {
-                    qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-        }
-        {
-            QSqlQuery outQuery(outsideDatabase);
-            if (!outQuery.prepare(R"(SELECT "tag_id", "node_id" FROM tag_relationship)")) {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-            bool status = outQuery.exec();
-            if (status) {
-                QVector<std::pair<int, int>> tagRela;
-                while (outQuery.next()) {
-                    tagRela.append(std::make_pair(outQuery.value(0).toInt(), outQuery.value(1).toInt()));
-                }
-                if (!m_db.transaction()) {
-                    qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
-                }
-                for (const auto &rel : std::as_const(tagRela)) {
-                    if (tagIdMap.contains(rel.first) && noteIdMap.contains(rel.second)) {
-                        addNoteToTag(noteIdMap[rel.second], tagIdMap[rel.first]);
-                    } else {
-                        qDebug() << __FUNCTION__ << __LINE__ << "tag relationship is not valid";
-                    }
-                }
-                if (!m_db.commit()) {
-                    qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
-                }
-            } else {
-                qDebug() << __FUNCTION__ << __LINE__ << outQuery.lastError();
-            }
-        }
-        {
-            outsideDatabase.close();
-            outsideDatabase = QSqlDatabase::database();
+        if (!importNotesFromDatabase(fileName)) {
+            emit showErrorMessage(tr("Invalid file"), "Please select a valid notes export file");
         }
     } else {
         auto noteList = readOldNBK(fileName);
@@ -2191,7 +3436,347 @@ void DBManager::onImportNotesRequested(const QString &fileName)
         }
     }
     recalculateChildNotesCount();
-    onNodeTagTreeRequested();
+    emitNodeTagTreeChanges();
+}
+
+/*!
+ * \brief DBManager::getFoldersByTitle
+ * Ids of all folders by parent id and title, the lowest id first among
+ * siblings with the same title, and their absolute paths
+ * \param folderIds
+ * \param folderPaths
+ */
+void DBManager::getFoldersByTitle(QHash<QPair<int, QString>, int> &folderIds, QHash<int, QString> &folderPaths)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(SELECT "id", "parent_id", "title", "absolute_path" FROM main.node_table WHERE node_type = :node_type ORDER BY "id";)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Folder));
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    while (query.next()) {
+        int id = query.value(0).toInt();
+        auto key = qMakePair(query.value(1).toInt(), query.value(2).toString());
+        if (!folderIds.contains(key)) {
+            folderIds[key] = id;
+        }
+        folderPaths[id] = query.value(3).toString();
+    }
+}
+
+/*!
+ * \brief DBManager::importNotesFromDatabase
+ * Merge the notes of another database into this one. The archive is
+ * attached to the connection and its rows are copied with INSERT ... SELECT
+ * through temporary tables mapping the old ids to the new ones, so its
+ * content is never loaded in memory. Tags and folders are matched by name
+ * against the existing ones, imported notes are appended to their folders.
+ * Edits still logged in the archive are copied along and compacted into
+ * the imported notes. Everything runs in a single transaction.
+ * \param fileName
+ * \return false if the file couldn't be imported, nothing is changed then
+ */
+bool DBManager::importNotesFromDatabase(const QString &fileName)
+{
+    QSqlQuery query(m_db);
+    if (!query.prepare(R"(ATTACH DATABASE :file_name AS import_db;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(QStringLiteral(":file_name"), fileName);
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        return false;
+    }
+    query.clear();
+
+    bool isImported = true;
+    auto execQuery = [&](QSqlQuery &q, const QString &queryStr = QString()) {
+        if (isImported && !(queryStr.isEmpty() ? q.exec() : q.exec(queryStr))) {
+            qDebug() << __FUNCTION__ << __LINE__ << q.lastError();
+            isImported = false;
+        }
+        return isImported;
+    };
+
+    // Archives from older versions don't have the content_compressed column
+    bool hasCompressedContent = false;
+    if (execQuery(query, R"(PRAGMA import_db.table_info("node_table");)")) {
+        while (query.next()) {
+            if (query.value(1).toString() == QStringLiteral("content_compressed")) {
+                hasCompressedContent = true;
+            }
+        }
+    }
+    query.clear();
+    // nor note_edit_log, which a backup taken while a large note was being
+    // edited still has rows in
+    bool hasNoteEditLog = false;
+    if (execQuery(query, R"(SELECT count(*) FROM import_db.sqlite_master WHERE type = 'table' AND name = 'note_edit_log';)") && query.next()) {
+        hasNoteEditLog = query.value(0).toInt() > 0;
+    }
+    query.clear();
+
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    execQuery(query, R"(CREATE TEMP TABLE "import_tag_map" ("old_id" INTEGER PRIMARY KEY, "new_id" INTEGER NOT NULL);)");
+    execQuery(query, R"(CREATE TEMP TABLE "import_folder_map" ("old_id" INTEGER PRIMARY KEY, "new_id" INTEGER NOT NULL);)");
+    execQuery(query, R"(CREATE TEMP TABLE "import_note_map" ("seq" INTEGER PRIMARY KEY, "old_id" INTEGER NOT NULL, "parent_id" INTEGER NOT NULL);)");
+    execQuery(query,
+              R"(CREATE TEMP TABLE "import_note_parent" ()"
+              R"("folder_id" INTEGER PRIMARY KEY, "absolute_path" TEXT NOT NULL, "next_note_position" INTEGER NOT NULL, "first_seq" INTEGER);)");
+
+    // Tags, matched by name and color
+    if (isImported) {
+        QHash<QPair<QString, QString>, int> existingTags;
+        int nextTagPosition = 0;
+        execQuery(query, R"(SELECT "id", "name", "color", "relative_position" FROM main.tag_table ORDER BY "id";)");
+        while (query.next()) {
+            auto key = qMakePair(query.value(1).toString(), query.value(2).toString());
+            if (!existingTags.contains(key)) {
+                existingTags[key] = query.value(0).toInt();
+            }
+            nextTagPosition = std::max(nextTagPosition, query.value(3).toInt() + 1);
+        }
+        query.clear();
+        int nextTagId = nextAvailableTagId();
+        int firstTagId = nextTagId;
+
+        QSqlQuery insertTag(m_db);
+        QSqlQuery insertTagMap(m_db);
+        if (!insertTag.prepare(R"(INSERT INTO main.tag_table ("id", "name", "color", "relative_position", "child_notes_count") )"
+                               R"(VALUES (:id, :name, :color, :relative_position, 0);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << insertTag.lastError();
+        }
+        if (!insertTagMap.prepare(R"(INSERT INTO temp.import_tag_map ("old_id", "new_id") VALUES (:old_id, :new_id);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << insertTagMap.lastError();
+        }
+        execQuery(query, R"(SELECT "id", "name", "color" FROM import_db.tag_table ORDER BY "relative_position";)");
+        while (isImported && query.next()) {
+            auto key = qMakePair(query.value(1).toString(), query.value(2).toString());
+            auto it = existingTags.find(key);
+            if (it == existingTags.end()) {
+                insertTag.bindValue(QStringLiteral(":id"), nextTagId);
+                insertTag.bindValue(QStringLiteral(":name"), key.first);
+                insertTag.bindValue(QStringLiteral(":color"), key.second);
+                insertTag.bindValue(QStringLiteral(":relative_position"), nextTagPosition++);
+                execQuery(insertTag);
+                it = existingTags.insert(key, nextTagId++);
+            }
+            insertTagMap.bindValue(QStringLiteral(":old_id"), query.value(0).toInt());
+            insertTagMap.bindValue(QStringLiteral(":new_id"), it.value());
+            execQuery(insertTagMap);
+        }
+        query.clear();
+        if (nextTagId != firstTagId) {
+            if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_tag_id';)")) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            query.bindValue(QStringLiteral(":value"), nextTagId);
+            execQuery(query);
+        }
+    }
+
+    // Folders, matched by title under the same parent, parents first
+    int nextNodeId = nextAvailableNodeId();
+    if (isImported) {
+        QHash<QPair<int, QString>, int> existingFolders;
+        QHash<int, QString> folderPaths;
+        getFoldersByTitle(existingFolders, folderPaths);
+
+        QVector<NodeData> folders;
+        if (!query.prepare(R"(SELECT "id", "title", "creation_date", "modification_date", "deletion_date", "parent_id", "relative_position", "absolute_path" )"
+                           R"(FROM import_db.node_table WHERE node_type = :node_type;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Folder));
+        execQuery(query);
+        while (query.next()) {
+            NodeData folder;
+            folder.setId(query.value(0).toInt());
+            folder.setFullTitle(query.value(1).toString());
+            folder.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(2).toLongLong()));
+            folder.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(query.value(3).toLongLong()));
+            folder.setDeletionDateTime(QDateTime::fromMSecsSinceEpoch(query.value(4).toLongLong()));
+            folder.setParentId(query.value(5).toInt());
+            folder.setRelativePosition(query.value(6).toInt());
+            folder.setAbsolutePath(query.value(7).toString());
+            folders.append(folder);
+        }
+        query.clear();
+        std::sort(folders.begin(), folders.end(), [](const NodeData &a, const NodeData &b) {
+            auto depthA = a.absolutePath().count(PATH_SEPARATOR);
+            auto depthB = b.absolutePath().count(PATH_SEPARATOR);
+            return depthA != depthB ? depthA < depthB : a.relativePosition() < b.relativePosition();
+        });
+
+        QHash<int, int> folderIdMap;
+        folderIdMap[ROOT_FOLDER_ID] = ROOT_FOLDER_ID;
+        folderIdMap[TRASH_FOLDER_ID] = TRASH_FOLDER_ID;
+        folderIdMap[DEFAULT_NOTES_FOLDER_ID] = DEFAULT_NOTES_FOLDER_ID;
+        QHash<int, int> nextFolderPositions;
+        QSqlQuery insertFolder(m_db);
+        if (!insertFolder.prepare(
+                    R"(INSERT INTO main.node_table )"
+                    R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "content_compressed", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count") )"
+                    R"(VALUES (:id, :title, :creation_date, :modification_date, :deletion_date, '', 0, :node_type, :parent_id, :relative_position, 0, :absolute_path, 0, 0, 0);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << insertFolder.lastError();
+        }
+        for (const auto &folder : std::as_const(folders)) {
+            if (!isImported) {
+                break;
+            }
+            if (folderIdMap.contains(folder.id())) {
+                continue;
+            }
+            if (!folderIdMap.contains(folder.parentId())) {
+                qDebug() << __FUNCTION__ << __LINE__ << "can't find parent for folder";
+                continue;
+            }
+            int parentId = folderIdMap[folder.parentId()];
+            auto key = qMakePair(parentId, folder.fullTitle());
+            auto it = existingFolders.find(key);
+            if (it != existingFolders.end()) {
+                folderIdMap[folder.id()] = it.value();
+                continue;
+            }
+            auto position = nextFolderPositions.find(parentId);
+            if (position == nextFolderPositions.end()) {
+                position = nextFolderPositions.insert(parentId, nextAvailablePosition(parentId, NodeData::Type::Folder));
+            }
+            int id = nextNodeId++;
+            QString absolutePath = folderPaths[parentId] + PATH_SEPARATOR + QString::number(id);
+            insertFolder.bindValue(QStringLiteral(":id"), id);
+            insertFolder.bindValue(QStringLiteral(":title"), folder.fullTitle());
+            insertFolder.bindValue(QStringLiteral(":creation_date"), folder.creationDateTime().toMSecsSinceEpoch());
+            insertFolder.bindValue(QStringLiteral(":modification_date"), folder.lastModificationdateTime().toMSecsSinceEpoch());
+            insertFolder.bindValue(QStringLiteral(":deletion_date"), folder.deletionDateTime().toMSecsSinceEpoch());
+            insertFolder.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Folder));
+            insertFolder.bindValue(QStringLiteral(":parent_id"), parentId);
+            insertFolder.bindValue(QStringLiteral(":relative_position"), position.value()++);
+            insertFolder.bindValue(QStringLiteral(":absolute_path"), absolutePath);
+            execQuery(insertFolder);
+            existingFolders[key] = id;
+            folderPaths[id] = absolutePath;
+            folderIdMap[folder.id()] = id;
+        }
+
+        QSqlQuery insertFolderMap(m_db);
+        if (!insertFolderMap.prepare(R"(INSERT INTO temp.import_folder_map ("old_id", "new_id") VALUES (:old_id, :new_id);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << insertFolderMap.lastError();
+        }
+        for (auto it = folderIdMap.constBegin(); isImported && it != folderIdMap.constEnd(); ++it) {
+            insertFolderMap.bindValue(QStringLiteral(":old_id"), it.key());
+            insertFolderMap.bindValue(QStringLiteral(":new_id"), it.value());
+            execQuery(insertFolderMap);
+        }
+    }
+
+    // Notes, appended to their folders in their original order
+    int firstNoteId = nextNodeId;
+    if (isImported) {
+        if (!query.prepare(R"(INSERT INTO temp.import_note_map ("old_id", "parent_id") )"
+                           R"(SELECT o.id, m.new_id FROM import_db.node_table o JOIN temp.import_folder_map m ON m.old_id = o.parent_id )"
+                           R"(WHERE o.node_type = :node_type ORDER BY m.new_id, o.relative_position, o.id;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+        execQuery(query);
+        query.clear();
+        execQuery(query, R"(CREATE INDEX temp.import_note_map_old_id_index ON "import_note_map" ("old_id");)");
+        execQuery(query, R"(CREATE INDEX temp.import_note_map_parent_id_index ON "import_note_map" ("parent_id", "seq");)");
+
+        if (!query.prepare(R"(INSERT INTO temp.import_note_parent ("folder_id", "absolute_path", "next_note_position", "first_seq") )"
+                           R"(SELECT f.id, f.absolute_path, )"
+                           R"((SELECT ifnull(max(c.relative_position) + 1, 0) FROM main.node_table c WHERE c.parent_id = f.id AND c.node_type = :node_type), )"
+                           R"((SELECT min(m.seq) FROM temp.import_note_map m WHERE m.parent_id = f.id) )"
+                           R"(FROM main.node_table f WHERE f.id IN (SELECT DISTINCT parent_id FROM temp.import_note_map);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":node_type"), static_cast<int>(NodeData::Type::Note));
+        execQuery(query);
+        query.clear();
+
+        if (!query.prepare(
+                    QStringLiteral(
+                            R"(INSERT INTO main.node_table )"
+                            R"(("id", "title", "creation_date", "modification_date", "deletion_date", "content", "content_compressed", "node_type", "parent_id", "relative_position", "scrollbar_position", "absolute_path", "is_pinned_note", "relative_position_an", "child_notes_count") )"
+                            R"(SELECT :first_id + m.seq - 1, o.title, o.creation_date, o.modification_date, o.deletion_date, o.content, %1, o.node_type, m.parent_id, )"
+                            R"(p.next_note_position + m.seq - p.first_seq, o.scrollbar_position, p.absolute_path || :separator || (:first_id + m.seq - 1), )"
+                            R"(o.is_pinned_note, o.relative_position_an, 0 )"
+                            R"(FROM temp.import_note_map m JOIN import_db.node_table o ON o.id = m.old_id JOIN temp.import_note_parent p ON p.folder_id = m.parent_id;)")
+                            .arg(hasCompressedContent ? QStringLiteral("o.content_compressed") : QStringLiteral("0")))) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":first_id"), firstNoteId);
+        query.bindValue(QStringLiteral(":separator"), QString(PATH_SEPARATOR));
+        execQuery(query);
+        query.clear();
+
+        // Pending edits follow their notes, they are compacted once committed
+        if (hasNoteEditLog) {
+            if (!query.prepare(R"(INSERT INTO main.note_edit_log )"
+                               R"(("node_id", "position", "removed_length", "inserted_text", "title", "modification_date", "scrollbar_position") )"
+                               R"(SELECT :first_id + m.seq - 1, l.position, l.removed_length, l.inserted_text, l.title, l.modification_date, l.scrollbar_position )"
+                               R"(FROM import_db.note_edit_log l JOIN temp.import_note_map m ON m.old_id = l.node_id ORDER BY l.id;)")) {
+                qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+            }
+            query.bindValue(QStringLiteral(":first_id"), firstNoteId);
+            execQuery(query);
+            query.clear();
+        }
+
+        if (!query.prepare(R"(INSERT OR IGNORE INTO main.tag_relationship ("node_id", "tag_id") )"
+                           R"(SELECT :first_id + m.seq - 1, t.new_id FROM import_db.tag_relationship r )"
+                           R"(JOIN temp.import_note_map m ON m.old_id = r.node_id JOIN temp.import_tag_map t ON t.old_id = r.tag_id;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":first_id"), firstNoteId);
+        execQuery(query);
+        query.clear();
+
+        if (execQuery(query, R"(SELECT count(*) FROM temp.import_note_map;)") && query.next()) {
+            nextNodeId += query.value(0).toInt();
+        }
+        query.clear();
+        if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(QStringLiteral(":value"), nextNodeId);
+        execQuery(query);
+        query.clear();
+    }
+
+    bool isMapDropped = query.exec(R"(DROP TABLE IF EXISTS temp.import_tag_map;)") && query.exec(R"(DROP TABLE IF EXISTS temp.import_folder_map;)")
+            && query.exec(R"(DROP TABLE IF EXISTS temp.import_note_map;)") && query.exec(R"(DROP TABLE IF EXISTS temp.import_note_parent;)");
+    if (!isMapDropped) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.clear();
+    if (isImported) {
+        if (!m_db.commit()) {
+            qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+            isImported = false;
+        }
+    } else if (!m_db.rollback()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    if (!query.exec(R"(DETACH DATABASE import_db;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    if (isImported) {
+        // The search index is filled from the imported content first, so
+        // compacting can replace the entries of the notes with pending edits
+        indexAllNoteSearch(firstNoteId);
+        if (hasNoteEditLog) {
+            compactAllNoteEditLogs();
+        }
+        indexAllNoteTasks(firstNoteId);
+        QTimer::singleShot(0, this, &DBManager::recompressNoteContents);
+    }
+    return isImported;
 }
 
 /*!
@@ -2207,13 +3792,14 @@ void DBManager::onRestoreNotesRequested(const QString &fileName)
     }
     auto const magicHeader = file.read(16);
     file.close();
+    cancelBackups();
     if (QString::fromUtf8(magicHeader).startsWith(QStringLiteral("SQLite format 3"))) {
         {
             m_db.close();
             m_db = QSqlDatabase::database();
         }
         QSqlDatabase::removeDatabase(DEFAULT_DATABASE_NAME);
-        QFile::remove(m_dbpath);
+        removeDatabaseFiles(m_dbpath);
         if (!QFile::copy(fileName, m_dbpath)) {
             qDebug() << __FUNCTION__ << "Can't import notes";
         };
@@ -2228,7 +3814,7 @@ void DBManager::onRestoreNotesRequested(const QString &fileName)
                 m_db = QSqlDatabase::database();
             }
             QSqlDatabase::removeDatabase(DEFAULT_DATABASE_NAME);
-            QFile::remove(m_dbpath);
+            removeDatabaseFiles(m_dbpath);
             open(m_dbpath, true);
             auto defaultNoteFolder = getNode(DEFAULT_NOTES_FOLDER_ID);
             int nodeId = nextAvailableNodeId();
@@ -2263,34 +3849,229 @@ void DBManager::onRestoreNotesRequested(const QString &fileName)
         }
     }
     recalculateChildNotesCount();
-    onNodeTagTreeRequested();
+    emitNodeTagTreeChanges();
 }
 
 /*!
  * \brief DBManager::onExportNotesRequested
+ * Back up the database to a file while notes keep being edited. With the
+ * system SQLite, the backup API copies the pages a few at a time from this
+ * thread's event loop, so edits requested meanwhile are handled between two
+ * steps and end up in the backup. Otherwise VACUUM INTO writes it in one
+ * go from another thread, on its own connection, without any progress
+ * reported: requests keep being handled here meanwhile, and since the
+ * database is in WAL mode its read transaction doesn't block them. CMake
+ * picks the system SQLite when Qt's driver uses it. Backups requested while
+ * one is running are queued. backupFinished() is emitted once the file is
+ * complete.
  * \param fileName
  */
 void DBManager::onExportNotesRequested(const QString &fileName)
 {
-    QSqlQuery query(m_db);
-    if (!query.prepare("BEGIN IMMEDIATE;")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    m_pendingBackupFileNames.append(fileName);
+    if (m_backupFileName.isEmpty()) {
+        startNextBackup();
     }
-    bool status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+}
+
+/*!
+ * \brief DBManager::startNextBackup
+ * The backup is written next to its destination and only renamed over it
+ * once complete, so a failed backup never replaces a good one
+ */
+void DBManager::startNextBackup()
+{
+    if (m_pendingBackupFileNames.isEmpty()) {
+        return;
     }
-    QFile::remove(fileName);
-    if (!QFile::copy(m_dbpath, fileName)) {
-        qDebug() << __FUNCTION__ << "Can't export notes";
-    };
+    m_backupFileName = m_pendingBackupFileNames.takeFirst();
+    compactAllNoteEditLogs();
+    QString partFileName = m_backupFileName + QStringLiteral(".part");
+    QFile::remove(partFileName);
+#ifdef USE_SYSTEM_SQLITE
+    auto backupDb = QSqlDatabase::addDatabase("QSQLITE", BACKUP_DATABASE_NAME);
+    backupDb.setDatabaseName(partFileName);
+    if (!backupDb.open()) {
+        qDebug() << __FUNCTION__ << __LINE__ << backupDb.lastError();
+        backupDb = QSqlDatabase();
+        finishBackup(false);
+        return;
+    }
+    auto *source = *static_cast<sqlite3 **>(m_db.driver()->handle().data());
+    auto *destination = *static_cast<sqlite3 **>(backupDb.driver()->handle().data());
+    m_backup = sqlite3_backup_init(destination, "main", source, "main");
+    if (m_backup == nullptr) {
+        qDebug() << __FUNCTION__ << __LINE__ << sqlite3_errmsg(destination);
+        backupDb = QSqlDatabase();
+        finishBackup(false);
+        return;
+    }
+    QTimer::singleShot(0, this, &DBManager::stepBackup);
+#else
+    m_backupWatcher = new QFutureWatcher<bool>(this);
+    connect(m_backupWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        bool status = m_backupWatcher->result();
+        m_backupWatcher->deleteLater();
+        m_backupWatcher = nullptr;
+        finishBackup(status);
+    });
+    m_backupWatcher->setFuture(QtConcurrent::run(vacuumDatabaseInto, m_dbpath, partFileName));
+#endif
+}
 
-    if (!query.prepare("ROLLBACK;")) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+/*!
+ * \brief DBManager::stepBackup
+ * Copy the next pages of the backup in progress
+ */
+void DBManager::stepBackup()
+{
+#ifdef USE_SYSTEM_SQLITE
+    if (m_backup == nullptr) {
+        return;
     }
-    status = query.exec();
-    if (!status) {
-        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    int status = sqlite3_backup_step(m_backup, BACKUP_STEP_PAGE_COUNT);
+    int pageCount = sqlite3_backup_pagecount(m_backup);
+    emit backupProgressChanged(m_backupFileName, pageCount - sqlite3_backup_remaining(m_backup), pageCount);
+    if (status == SQLITE_DONE) {
+        finishBackup(true);
+    } else if (status == SQLITE_OK) {
+        QTimer::singleShot(0, this, &DBManager::stepBackup);
+    } else if (status == SQLITE_BUSY || status == SQLITE_LOCKED) {
+        QTimer::singleShot(BACKUP_BUSY_DELAY, this, &DBManager::stepBackup);
+    } else {
+        qDebug() << __FUNCTION__ << __LINE__ << sqlite3_errstr(status);
+        finishBackup(false);
+    }
+#endif
+}
+
+/*!
+ * \brief DBManager::finishBackup
+ * Move the backup in progress to its destination, or discard it, then start
+ * the next one
+ * \param isSuccess
+ */
+void DBManager::finishBackup(bool isSuccess)
+{
+#ifdef USE_SYSTEM_SQLITE
+    if (m_backup != nullptr) {
+        if (sqlite3_backup_finish(m_backup) != SQLITE_OK) {
+            isSuccess = false;
+        }
+        m_backup = nullptr;
+    }
+#endif
+    if (QSqlDatabase::contains(BACKUP_DATABASE_NAME)) {
+        QSqlDatabase::database(BACKUP_DATABASE_NAME, false).close();
+        QSqlDatabase::removeDatabase(BACKUP_DATABASE_NAME);
+    }
+    QString fileName = m_backupFileName;
+    QString partFileName = fileName + QStringLiteral(".part");
+    m_backupFileName.clear();
+    if (isSuccess) {
+        // The previous file is moved aside rather than removed, and only
+        // dropped once the new one took its place
+        QString previousFileName = fileName + QStringLiteral(".old");
+        bool hasPreviousFile = QFile::exists(fileName);
+        if (hasPreviousFile) {
+            QFile::remove(previousFileName);
+            isSuccess = QFile::rename(fileName, previousFileName);
+        }
+        if (isSuccess) {
+            isSuccess = QFile::rename(partFileName, fileName);
+            if (hasPreviousFile && !isSuccess) {
+                QFile::rename(previousFileName, fileName);
+            }
+        }
+        if (hasPreviousFile && isSuccess) {
+            QFile::remove(previousFileName);
+        }
+    }
+    if (!isSuccess) {
+        qDebug() << __FUNCTION__ << "Can't back up notes to" << fileName;
+        QFile::remove(partFileName);
+    }
+    emit backupFinished(fileName, isSuccess);
+    if (isSuccess && !m_backupDirectory.isEmpty() && QFileInfo(fileName).absolutePath() == QDir(m_backupDirectory).absolutePath()) {
+        rotateBackups();
+    }
+    startNextBackup();
+}
+
+/*!
+ * \brief DBManager::cancelBackups
+ * Stop the backup in progress and drop the queued ones, before the
+ * database is closed
+ */
+void DBManager::cancelBackups()
+{
+    const QStringList pendingFileNames = m_pendingBackupFileNames;
+    m_pendingBackupFileNames.clear();
+    if (m_backupWatcher != nullptr) {
+        m_backupWatcher->waitForFinished();
+        delete m_backupWatcher;
+        m_backupWatcher = nullptr;
+    }
+    if (!m_backupFileName.isEmpty()) {
+        finishBackup(false);
+    }
+    for (const auto &fileName : pendingFileNames) {
+        emit backupFinished(fileName, false);
+    }
+}
+
+/*!
+ * \brief DBManager::setBackupSchedule
+ * Back up the notes to a directory every few hours, keeping only the most
+ * recent backups there. A backup is made right away when the last one is
+ * older than the interval, so backups still happen if the app is never
+ * left open that long.
+ * \param directoryPath
+ * \param intervalHours 0 to stop the scheduled backups
+ * \param keptBackupCount
+ */
+void DBManager::setBackupSchedule(const QString &directoryPath, int intervalHours, int keptBackupCount)
+{
+    if (m_backupTimer == nullptr) {
+        m_backupTimer = new QTimer(this);
+        connect(m_backupTimer, &QTimer::timeout, this, &DBManager::runScheduledBackup);
+    }
+    m_backupTimer->stop();
+    if (intervalHours <= 0 || directoryPath.isEmpty()) {
+        m_backupDirectory.clear();
+        return;
+    }
+    m_backupDirectory = directoryPath;
+    m_keptBackupCount = std::max(keptBackupCount, 1);
+    QDir directory(directoryPath);
+    directory.mkpath(QStringLiteral("."));
+    m_backupTimer->start(intervalHours * MSECS_PER_HOUR);
+
+    const auto backups = directory.entryInfoList({ QStringLiteral("%1*.db").arg(QLatin1String(SCHEDULED_BACKUP_PREFIX)) }, QDir::Files, QDir::Name);
+    if (backups.isEmpty() || backups.last().lastModified().msecsTo(QDateTime::currentDateTime()) >= qint64(intervalHours) * MSECS_PER_HOUR) {
+        runScheduledBackup();
+    }
+}
+
+void DBManager::runScheduledBackup()
+{
+    QString name = QStringLiteral("%1%2.db").arg(QLatin1String(SCHEDULED_BACKUP_PREFIX),
+                                                 QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")));
+    onExportNotesRequested(QDir(m_backupDirectory).filePath(name));
+}
+
+/*!
+ * \brief DBManager::rotateBackups
+ * Delete the oldest scheduled backups beyond the number to keep
+ */
+void DBManager::rotateBackups()
+{
+    QDir directory(m_backupDirectory);
+    const auto backups = directory.entryList({ QStringLiteral("%1*.db").arg(QLatin1String(SCHEDULED_BACKUP_PREFIX)) }, QDir::Files, QDir::Name);
+    for (int i = 0; i < backups.size() - m_keptBackupCount; ++i) {
+        if (!directory.remove(backups[i])) {
+            qDebug() << __FUNCTION__ << __LINE__ << "Can't remove old backup" << backups[i];
+        }
     }
 }
 
@@ -2498,6 +4279,9 @@ void DBManager::onMigrateNotesFrom1_5_0Requested(const QString &fileName)
 
 void DBManager::onChangeDatabasePathRequested(const QString &newPath)
 {
+    cancelBackups();
+    compactAllNoteEditLogs();
+    updateNoteTaskIndex();
     {
         if (!m_db.commit()) {
             qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
@@ -2509,8 +4293,25 @@ void DBManager::onChangeDatabasePathRequested(const QString &newPath)
     open(newPath, false);
 }
 
-void DBManager::addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime>> &fileDatas)
+/*!
+ * \brief DBManager::cancelImport
+ * Stop the plain text import in progress after its current batch. Can be
+ * called from any thread.
+ */
+void DBManager::cancelImport()
+{
+    m_isImportCanceled = true;
+}
+
+/*!
+ * \brief DBManager::onImportPlainTextFilesRequested
+ * Import text files as notes of a new "Imported Notes" folder
+ * \param fileNames
+ */
+void DBManager::onImportPlainTextFilesRequested(const QStringList &fileNames)
 {
+    m_isImportCanceled = false;
+
     NodeData newFolder;
     newFolder.setNodeType(NodeData::Type::Folder);
     QDateTime currentDate = QDateTime::currentDateTime();
@@ -2522,36 +4323,247 @@ void DBManager::addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime
     int newFolderId = addNode(newFolder);
     if (newFolderId <= 0) {
         qDebug() << "Failed to add 'Imported Notes' folder.";
+        emit importFinished(0, 0, fileNames, false);
         return;
     }
+    importPlainTextFiles(fileNames, {}, newFolderId, QString());
+}
 
-    NodeData createdFolder = getNode(newFolderId);
-    const QString &parentAbsPath = createdFolder.absolutePath();
+/*!
+ * \brief DBManager::onImportPlainTextDirectoryRequested
+ * Import the text files below a directory, keeping its structure: the
+ * directory becomes a top level folder and each subdirectory with text
+ * files in it a subfolder. Folders that already exist with the same title
+ * are reused, and files imported before are skipped if they didn't change
+ * and update their note if they did, so importing the same directory again
+ * only brings in new and changed files.
+ * \param directoryPath
+ */
+void DBManager::onImportPlainTextDirectoryRequested(const QString &directoryPath)
+{
+    m_isImportCanceled = false;
+    QDir directory(directoryPath);
+    const QStringList fileNames = listPlainTextFiles(directory.absolutePath());
+    if (fileNames.isEmpty()) {
+        emit importFinished(0, 0, {}, false);
+        return;
+    }
 
-    int nodeId = nextAvailableNodeId();
-    int notePos = 0;
+    QHash<QPair<int, QString>, int> folderIds;
+    QHash<int, QString> folderPaths;
+    QHash<QString, int> directoryFolderIds;
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    getFoldersByTitle(folderIds, folderPaths);
+    auto folderFor = [&](int parentId, const QString &title) {
+        auto key = qMakePair(parentId, title);
+        auto it = folderIds.find(key);
+        if (it != folderIds.end()) {
+            return it.value();
+        }
+        NodeData folder;
+        folder.setNodeType(NodeData::Type::Folder);
+        QDateTime currentDate = QDateTime::currentDateTime();
+        folder.setCreationDateTime(currentDate);
+        folder.setLastModificationDateTime(currentDate);
+        folder.setFullTitle(title);
+        folder.setParentId(parentId);
+        int folderId = addNode(folder);
+        folderIds.insert(key, folderId);
+        return folderId;
+    };
+    int topFolderId = folderFor(ROOT_FOLDER_ID, directory.dirName());
+    directoryFolderIds[directory.absolutePath()] = topFolderId;
+    for (const auto &fileName : fileNames) {
+        QString directoryPathOfFile = QFileInfo(fileName).absolutePath();
+        if (directoryFolderIds.contains(directoryPathOfFile)) {
+            continue;
+        }
+        int folderId = topFolderId;
+        QString path = directory.absolutePath();
+        const auto titles = directory.relativeFilePath(directoryPathOfFile).split(QLatin1Char('/'), Qt::SkipEmptyParts);
+        for (const auto &title : titles) {
+            path += QLatin1Char('/') + title;
+            auto it = directoryFolderIds.find(path);
+            if (it == directoryFolderIds.end()) {
+                it = directoryFolderIds.insert(path, folderFor(folderId, title));
+            }
+            folderId = it.value();
+        }
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    importPlainTextFiles(fileNames, directoryFolderIds, topFolderId, QFileInfo(directory.absolutePath()).absolutePath());
+}
 
-    for (const auto &noteData : fileDatas) {
-        NodeData note;
-        note.setFullTitle(noteData.first.section('\n', 0, 0, QString::SectionSkipEmpty));
-        note.setContent(noteData.first);
-        note.setId(nodeId++);
-        note.setRelativePosition(notePos++);
-        note.setAbsolutePath(parentAbsPath + PATH_SEPARATOR + QString::number(note.id()));
-        note.setNodeType(NodeData::Type::Note);
-        note.setParentId(newFolderId);
-        note.setCreationDateTime(noteData.second);
-        note.setLastModificationDateTime(noteData.second);
+/*!
+ * \brief DBManager::importPlainTextFiles
+ * Files are read, hashed and their titles extracted on the thread pool, a
+ * batch ahead of the inserts, and each batch is inserted in one
+ * transaction. Batches already inserted are kept when the import is
+ * canceled.
+ * \param fileNames
+ * \param directoryFolderIds folder to import the files of each directory in
+ * \param parentId folder for the files of other directories
+ * \param baseDirectoryPath directory the paths of the files are recorded
+ * relative to in imported_file, files are imported without being recorded
+ * if it's empty
+ */
+void DBManager::importPlainTextFiles(const QStringList &fileNames, const QHash<QString, int> &directoryFolderIds, int parentId,
+                                     const QString &baseDirectoryPath)
+{
+    QStringList failedFileNames;
+    int importedCount = 0;
+    int skippedCount = 0;
+    bool isRecordingFiles = !baseDirectoryPath.isEmpty();
+    QDir baseDirectory(baseDirectoryPath);
+    QHash<QString, QPair<int, QByteArray>> knownFiles;
+    QHash<QByteArray, int> knownLegacyHashes;
+    if (isRecordingFiles) {
+        QSqlQuery query(m_db);
+        if (!query.exec(R"(SELECT "node_id", "content_hash", "file_path" FROM "imported_file";)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        while (query.next()) {
+            QString filePath = query.value(2).toString();
+            if (filePath.isEmpty()) {
+                knownLegacyHashes.insert(query.value(1).toByteArray(), query.value(0).toInt());
+            } else {
+                knownFiles.insert(filePath, qMakePair(query.value(0).toInt(), query.value(1).toByteArray()));
+            }
+        }
+    }
+    QHash<int, QString> parentAbsPaths;
+    QHash<int, int> notePositions;
+
+    int processedCount = 0;
+    emit importProgressChanged(processedCount, fileNames.size());
+    QFuture<PlainTextFile> batch = QtConcurrent::mapped(fileNames.mid(0, PLAIN_TEXT_IMPORT_BATCH_SIZE), readPlainTextFile);
+    while (processedCount < fileNames.size()) {
+        const auto plainTextFiles = batch.results();
+        int nextBatchStart = processedCount + plainTextFiles.size();
+        if (nextBatchStart < fileNames.size() && !m_isImportCanceled) {
+            batch = QtConcurrent::mapped(fileNames.mid(nextBatchStart, PLAIN_TEXT_IMPORT_BATCH_SIZE), readPlainTextFile);
+        }
 
-        addNode(note);
+        if (!m_db.transaction()) {
+            qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        }
+        QSqlQuery query(m_db);
+        if (!query.prepare(R"(INSERT INTO "imported_file" ("node_id", "content_hash", "file_path") VALUES (:node_id, :content_hash, :file_path);)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        QSqlQuery updateQuery(m_db);
+        if (!updateQuery.prepare(R"(UPDATE "imported_file" SET "content_hash" = :content_hash, "file_path" = :file_path WHERE node_id = :node_id;)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << updateQuery.lastError();
+        }
+        int nodeId = nextAvailableNodeId();
+        for (const auto &plainTextFile : plainTextFiles) {
+            if (!plainTextFile.isRead) {
+                failedFileNames.append(plainTextFile.fileName);
+                continue;
+            }
+            QString filePath;
+            if (isRecordingFiles) {
+                filePath = baseDirectory.relativeFilePath(plainTextFile.fileName);
+                auto knownFile = knownFiles.constFind(filePath);
+                int knownNoteId = INVALID_NODE_ID;
+                if (knownFile != knownFiles.constEnd()) {
+                    if (knownFile->second == plainTextFile.contentHash) {
+                        ++skippedCount;
+                        continue;
+                    }
+                    knownNoteId = knownFile->first;
+                } else if (knownLegacyHashes.contains(plainTextFile.contentHash)) {
+                    // Imported before paths were recorded, the row gets this path
+                    knownNoteId = knownLegacyHashes.take(plainTextFile.contentHash);
+                    ++skippedCount;
+                }
+                if (knownNoteId != INVALID_NODE_ID) {
+                    NodeData note = getNode(knownNoteId);
+                    if (knownFile != knownFiles.constEnd() && note.id() != INVALID_NODE_ID && note.nodeType() == NodeData::Type::Note) {
+                        // The file changed since, its note follows, with what it had kept in its history
+                        addNoteRevision(note, true);
+                        note.setFullTitle(plainTextFile.title);
+                        note.setContent(plainTextFile.content);
+                        note.setLastModificationDateTime(plainTextFile.lastModified);
+                        updateNoteContent(note);
+                        emit importedNoteUpdated(note);
+                        ++importedCount;
+                    }
+                    updateQuery.bindValue(QStringLiteral(":content_hash"), plainTextFile.contentHash);
+                    updateQuery.bindValue(QStringLiteral(":file_path"), filePath);
+                    updateQuery.bindValue(QStringLiteral(":node_id"), knownNoteId);
+                    if (!updateQuery.exec()) {
+                        qDebug() << __FUNCTION__ << __LINE__ << updateQuery.lastError();
+                    }
+                    continue;
+                }
+            }
+            int noteParentId = directoryFolderIds.value(QFileInfo(plainTextFile.fileName).absolutePath(), parentId);
+            auto parentAbsPath = parentAbsPaths.find(noteParentId);
+            if (parentAbsPath == parentAbsPaths.end()) {
+                parentAbsPath = parentAbsPaths.insert(noteParentId, getNodeAbsolutePath(noteParentId).path());
+            }
+            auto notePosition = notePositions.find(noteParentId);
+            if (notePosition == notePositions.end()) {
+                notePosition = notePositions.insert(noteParentId, nextAvailablePosition(noteParentId, NodeData::Type::Note));
+            }
+            NodeData note;
+            note.setFullTitle(plainTextFile.title);
+            note.setContent(plainTextFile.content);
+            note.setId(nodeId++);
+            note.setRelativePosition(notePosition.value()++);
+            note.setAbsolutePath(parentAbsPath.value() + PATH_SEPARATOR + QString::number(note.id()));
+            note.setNodeType(NodeData::Type::Note);
+            note.setParentId(noteParentId);
+            note.setCreationDateTime(plainTextFile.lastModified);
+            note.setLastModificationDateTime(plainTextFile.lastModified);
+            addNodePreComputed(note);
+            if (isRecordingFiles) {
+                query.bindValue(QStringLiteral(":node_id"), note.id());
+                query.bindValue(QStringLiteral(":content_hash"), plainTextFile.contentHash);
+                query.bindValue(QStringLiteral(":file_path"), filePath);
+                if (!query.exec()) {
+                    qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+                }
+            }
+            ++importedCount;
+        }
+        if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(":value", nodeId);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        if (!m_db.commit()) {
+            qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        }
+        // Index the batch now, the timer can't fire before the import is done
+        updateNoteTaskIndex();
+
+        processedCount = nextBatchStart;
+        emit importProgressChanged(processedCount, fileNames.size());
+        if (m_isImportCanceled) {
+            break;
+        }
     }
+    batch.cancel();
+    batch.waitForFinished();
 
     recalculateChildNotesCount();
-    onNodeTagTreeRequested();
+    emitNodeTagTreeChanges();
+    emit importFinished(importedCount, skippedCount, failedFileNames, m_isImportCanceled);
 }
 
 void DBManager::exportNotes(const QString &baseExportPath, const QString &extension)
 {
+    m_isExportCanceled = false;
+    compactAllNoteEditLogs();
+
     // Ensure the export directory exists
     QString rootFolderName = QStringLiteral("Notes");
     QString exportPathNew = QStringLiteral("%1%2%3").arg(baseExportPath, QDir::separator(), rootFolderName);
@@ -2564,87 +4576,610 @@ void DBManager::exportNotes(const QString &baseExportPath, const QString &extens
     qDebug() << "Exporting notes to:" << exportPathNew;
     directory.mkpath(exportPathNew);
 
-    // Retrieve all folders first to create the directory structure
-    QVector<NodeData> folders = getAllFolders();
+    // Create the directory of every folder, the export directory is new so
+    // names only have to be unique among themselves
+    ExportNames names;
+    const QHash<int, QString> folderPaths = folderExportPaths(getAllFolders(), names);
+    for (const auto &folderPath : folderPaths) {
+        directory.mkpath(exportPathNew + u'/' + folderPath);
+    }
 
-    // Create directories for each folder
-    QMap<int, QString> folderPaths;
-    for (const NodeData &folder : folders) {
-        QString path = exportPathNew;
-        if (folder.id() != ROOT_FOLDER_ID) { // Skip root folder
-            QStringList folderNames;
-            QString currentPath = folder.absolutePath();
-            QStringList pathParts = currentPath.split(QDir::separator(), Qt::SkipEmptyParts);
-            for (const auto &part : pathParts) {
-                int id = part.toInt();
-                if (id == ROOT_FOLDER_ID)
-                    continue;
-                auto folderTemp = getNode(id);
-                folderNames << folderTemp.fullTitle();
-            }
-            QString relativePath = folderNames.join(QDir::separator());
-            path += QDir::separator() + relativePath;
+    QSqlQuery query(m_db);
+    int totalCount = 0;
+    if (!query.prepare(R"(SELECT count(*) FROM node_table WHERE node_type = :note_type;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
+    if (query.exec() && query.next()) {
+        totalCount = query.value(0).toInt();
+    }
+    query.clear();
+
+    // Retrieve all notes
+    query.setForwardOnly(true);
+    if (!query.prepare(R"(SELECT "id", "title", "content", "parent_id" FROM node_table WHERE node_type = :note_type ORDER BY "id";)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
+
+    if (!query.exec()) {
+        qDebug() << "Failed to retrieve notes for export:" << query.lastError();
+        emit exportFinished(0, {}, false);
+        return;
+    }
 
-            counter = 1;
-            while (directory.exists(path)) {
-                path = QStringLiteral("%1%2%3 %4").arg(exportPathNew, QDir::separator(), relativePath).arg(counter++);
+    // Each batch of notes is written on the thread pool while the next one
+    // is read
+    int processedCount = 0;
+    QStringList failedFilePaths;
+    QVector<ExportedFile> writingFiles;
+    QFuture<bool> writing;
+    auto finishWriting = [&]() {
+        const auto results = writing.results();
+        for (int i = 0; i < results.size(); ++i) {
+            if (!results[i]) {
+                qDebug() << "Failed to export note:" << writingFiles[i].filePath;
+                failedFilePaths.append(writingFiles[i].filePath);
             }
+        }
+        processedCount += writingFiles.size();
+        writingFiles.clear();
+        emit exportProgressChanged(processedCount, totalCount);
+    };
+    emit exportProgressChanged(processedCount, totalCount);
+    bool hasNext = query.next();
+    while (hasNext && !m_isExportCanceled) {
+        QVector<ExportedFile> files;
+        for (; hasNext && files.size() < EXPORT_BATCH_SIZE; hasNext = query.next()) {
+            QString folderPath = folderPaths.value(query.value(3).toInt());
+            QString fileName = names.unique(folderPath, exportFileName(query.value(1).toString()), extension);
+            QString filePath = folderPath.isEmpty() ? exportPathNew + u'/' + fileName : QStringLiteral("%1/%2/%3").arg(exportPathNew, folderPath, fileName);
+            files.append({ filePath, decodeNoteContent(query.value(2)) });
+        }
+        if (!writingFiles.isEmpty()) {
+            finishWriting();
+        }
+        writingFiles = files;
+        writing = QtConcurrent::mapped(writingFiles, writeExportedFile);
+    }
+    if (!writingFiles.isEmpty()) {
+        finishWriting();
+    }
+
+    qDebug() << "Export completed to:" << baseExportPath;
+    emit exportFinished(processedCount - failedFilePaths.size(), failedFilePaths, m_isExportCanceled);
+}
+
+/*!
+ * \brief DBManager::exportNotesIncrementally
+ * Keep a directory in sync with the notes. A manifest in the directory
+ * records the modification date, content hash and file of every note
+ * exported there: notes whose modification date and folder didn't change
+ * since are skipped without reading their content, notes whose content hash
+ * didn't change aren't rewritten, and the files of notes removed or moved
+ * since are deleted. The first export to a directory writes every note,
+ * next to the files already there: only files listed in the manifest are
+ * ever overwritten or deleted.
+ * \param exportPath
+ * \param extension
+ */
+void DBManager::exportNotesIncrementally(const QString &exportPath, const QString &extension)
+{
+    m_isExportCanceled = false;
+    compactAllNoteEditLogs();
+
+    QDir directory(exportPath);
+    directory.mkpath(QStringLiteral("."));
+    QString manifestPath = directory.filePath(QString::fromLatin1(EXPORT_MANIFEST_FILE_NAME));
+    const QHash<int, ExportManifestEntry> manifest = readExportManifest(directory, manifestPath);
+
+    ExportNames names;
+    reserveUnmanagedFiles(directory, manifest, names);
+    const QHash<int, QString> folderPaths = folderExportPaths(getAllFolders(), names);
+
+    struct ChangedNote
+    {
+        int id;
+        QString title;
+        QString folderPath;
+        qint64 modificationDate;
+        QString filePath;
+    };
+    QVector<ChangedNote> changedNotes;
+    QHash<int, ExportManifestEntry> newManifest;
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.prepare(R"(SELECT "id", "title", "parent_id", "modification_date" FROM node_table WHERE node_type = :note_type ORDER BY "id";)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
+    if (!query.exec()) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        emit exportFinished(0, {}, false);
+        return;
+    }
+    // Unchanged notes keep their file name, new and changed ones are named
+    // around them
+    while (query.next()) {
+        int id = query.value(0).toInt();
+        QString folderPath = folderPaths.value(query.value(2).toInt());
+        qint64 modificationDate = query.value(3).toLongLong();
+        auto entry = manifest.constFind(id);
+        if (entry != manifest.constEnd() && entry->modificationDate == modificationDate && entry->filePath.endsWith(extension)
+            && entry->filePath.section(u'/', 0, -2) == folderPath) {
+            names.reserve(folderPath, entry->filePath.section(u'/', -1));
+            newManifest.insert(id, entry.value());
+        } else {
+            changedNotes.append({ id, query.value(1).toString(), folderPath, modificationDate, QString() });
+        }
+    }
+    query.clear();
+    QSet<QString> filePaths;
+    for (auto it = newManifest.constBegin(); it != newManifest.constEnd(); ++it) {
+        filePaths.insert(it->filePath.toCaseFolded());
+    }
+    for (auto &note : changedNotes) {
+        QString fileName = names.unique(note.folderPath, exportFileName(note.title), extension);
+        note.filePath = note.folderPath.isEmpty() ? fileName : note.folderPath + u'/' + fileName;
+        filePaths.insert(note.filePath.toCaseFolded());
+        // Until it is written, the note keeps what it had if its file is still there
+        auto entry = manifest.constFind(note.id);
+        if (entry != manifest.constEnd() && entry->filePath == note.filePath) {
+            newManifest.insert(note.id, entry.value());
+        }
+    }
 
-            QDir().mkpath(path);
+    // Delete the files no note is exported to anymore, and the directories
+    // left empty
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        if (filePaths.contains(it->filePath.toCaseFolded())) {
+            continue;
+        }
+        if (!directory.remove(it->filePath)) {
+            qDebug() << __FUNCTION__ << __LINE__ << "Failed to remove" << it->filePath;
+        }
+        QString folderPath = it->filePath.section(u'/', 0, -2);
+        while (!folderPath.isEmpty() && directory.rmdir(folderPath)) {
+            folderPath = folderPath.section(u'/', 0, -2);
         }
-        folderPaths.insert(folder.id(), path);
     }
 
-    // Retrieve all notes
+    QSqlQuery contentQuery(m_db);
+    if (!contentQuery.prepare(R"(SELECT "content" FROM node_table WHERE id = :id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << contentQuery.lastError();
+    }
+    // Each batch of changed notes is written on the thread pool while the
+    // next one is read
+    int processedCount = 0;
+    int writingProcessedCount = 0;
+    int exportedCount = 0;
+    QStringList failedFilePaths;
+    QSet<QString> createdFolderPaths;
+    QVector<ExportedFile> writingFiles;
+    QVector<QPair<int, ExportManifestEntry>> writingEntries;
+    QFuture<bool> writing;
+    auto finishWriting = [&]() {
+        const auto results = writing.results();
+        for (int i = 0; i < results.size(); ++i) {
+            if (results[i]) {
+                newManifest.insert(writingEntries[i].first, writingEntries[i].second);
+                ++exportedCount;
+            } else {
+                qDebug() << "Failed to export note:" << writingFiles[i].filePath;
+                failedFilePaths.append(writingFiles[i].filePath);
+            }
+        }
+        writingFiles.clear();
+        writingEntries.clear();
+        emit exportProgressChanged(writingProcessedCount, changedNotes.size());
+    };
+    emit exportProgressChanged(processedCount, changedNotes.size());
+    while (processedCount < changedNotes.size() && !m_isExportCanceled) {
+        QVector<ExportedFile> files;
+        QVector<QPair<int, ExportManifestEntry>> entries;
+        for (; processedCount < changedNotes.size() && files.size() < EXPORT_BATCH_SIZE; ++processedCount) {
+            const auto &note = changedNotes[processedCount];
+            contentQuery.bindValue(":id", note.id);
+            if (!contentQuery.exec() || !contentQuery.next()) {
+                qDebug() << __FUNCTION__ << __LINE__ << contentQuery.lastError();
+                continue;
+            }
+            QString content = decodeNoteContent(contentQuery.value(0));
+            contentQuery.finish();
+            ExportManifestEntry entry{ note.modificationDate, QCryptographicHash::hash(content.toUtf8(), QCryptographicHash::Sha1), note.filePath };
+            auto oldEntry = newManifest.constFind(note.id);
+            if (oldEntry != newManifest.constEnd() && oldEntry->contentHash == entry.contentHash) {
+                // Touched but not changed, the file is already up to date
+                newManifest.insert(note.id, entry);
+                continue;
+            }
+            if (!createdFolderPaths.contains(note.folderPath)) {
+                directory.mkpath(note.folderPath.isEmpty() ? QStringLiteral(".") : note.folderPath);
+                createdFolderPaths.insert(note.folderPath);
+            }
+            files.append({ directory.filePath(note.filePath), content });
+            entries.append(qMakePair(note.id, entry));
+        }
+        if (!writingFiles.isEmpty()) {
+            finishWriting();
+        }
+        writingFiles = files;
+        writingEntries = entries;
+        writingProcessedCount = processedCount;
+        writing = QtConcurrent::mapped(writingFiles, writeExportedFile);
+    }
+    if (!writingFiles.isEmpty()) {
+        finishWriting();
+    }
+
+    if (!writeExportManifest(manifestPath, newManifest)) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Failed to write" << manifestPath;
+        failedFilePaths.append(manifestPath);
+    }
+    qDebug() << "Incremental export to" << exportPath << "wrote" << exportedCount << "of" << changedNotes.size() << "changed notes";
+    emit exportFinished(exportedCount, failedFilePaths, m_isExportCanceled);
+}
+
+/*!
+ * \brief DBManager::cancelExport
+ * Stop the export in progress once the batch being written is done. Can be
+ * called from any thread.
+ */
+void DBManager::cancelExport()
+{
+    m_isExportCanceled = true;
+}
+
+/*!
+ * \brief DBManager::exportNotesToArchive
+ * Export all notes to a single zip archive, with their folders, tags and
+ * dates, that onImportArchiveRequested() reads back. Notes are read in
+ * batches, each compressed on the thread pool while the next one is read,
+ * and written to the archive in order, so memory use doesn't grow with the
+ * number of notes. The archive only replaces an existing file once it is
+ * complete.
+ * \param fileName
+ */
+void DBManager::exportNotesToArchive(const QString &fileName)
+{
+    m_isExportCanceled = false;
+    compactAllNoteEditLogs();
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << __FUNCTION__ << __LINE__ << file.errorString();
+        emit exportFinished(0, { fileName }, false);
+        return;
+    }
+    NoteArchiveWriter writer(&file);
+
     QSqlQuery query(m_db);
-    if (!query.prepare(R"(SELECT "id", "title", "content", "parent_id" FROM node_table WHERE node_type = :note_type)")) {
+    int totalCount = 0;
+    if (!query.prepare(R"(SELECT count(*) FROM node_table WHERE node_type = :note_type;)")) {
         qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
     }
     query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
+    if (query.exec() && query.next()) {
+        totalCount = query.value(0).toInt();
+    }
+    query.clear();
+
+    // The index, with folders listed parents first so they can be created
+    // in order on import
+    ExportNames names;
+    QVector<NodeData> folders = getAllFolders();
+    std::sort(folders.begin(), folders.end(), [](const NodeData &a, const NodeData &b) {
+        return a.absolutePath().count(PATH_SEPARATOR) < b.absolutePath().count(PATH_SEPARATOR);
+    });
+    const QHash<int, QString> folderPaths = folderExportPaths(folders, names);
+    QJsonArray tagArray;
+    const auto tags = getAllTagInfo();
+    for (const auto &tag : tags) {
+        tagArray.append(QJsonObject{ { "id", tag.id() }, { "name", tag.name() }, { "color", tag.color() } });
+    }
+    QJsonArray folderArray;
+    for (const auto &folder : std::as_const(folders)) {
+        if (folder.id() != ROOT_FOLDER_ID) {
+            folderArray.append(QJsonObject{ { "id", folder.id() }, { "parentId", folder.parentId() }, { "title", folder.fullTitle() } });
+        }
+    }
+    QJsonObject index{ { "version", NOTE_ARCHIVE_VERSION }, { "noteCount", totalCount }, { "tags", tagArray }, { "folders", folderArray } };
+    bool isWritten = writer.writeEntry(NoteArchiveWriter::compressEntry(QString::fromLatin1(NOTE_ARCHIVE_INDEX_NAME),
+                                                                        QJsonDocument(index).toJson(QJsonDocument::Compact),
+                                                                        QDateTime::currentDateTime()));
 
+    QSqlQuery tagQuery(m_db);
+    if (!tagQuery.prepare(R"(SELECT "node_id", "tag_id" FROM tag_relationship WHERE node_id BETWEEN :first_id AND :last_id;)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << tagQuery.lastError();
+    }
+    query.setForwardOnly(true);
+    if (!query.prepare(R"(SELECT "id", "title", "content", "parent_id", "creation_date", "modification_date", "is_pinned_note" )"
+                       R"(FROM node_table WHERE node_type = :note_type ORDER BY "id";)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+    }
+    query.bindValue(":note_type", static_cast<int>(NodeData::Type::Note));
     if (!query.exec()) {
-        qDebug() << "Failed to retrieve notes for export:" << query.lastError();
+        qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        isWritten = false;
+    }
+
+    // Each batch is its metadata entry followed by the content of its notes
+    int processedCount = 0;
+    int batchCount = 0;
+    int compressingCount = 0;
+    QVector<ArchivedFile> compressingFiles;
+    QFuture<NoteArchiveEntry> compressing;
+    auto finishWriting = [&]() {
+        const auto entries = compressing.results();
+        for (const auto &entry : entries) {
+            if (isWritten && !writer.writeEntry(entry)) {
+                isWritten = false;
+            }
+        }
+        processedCount += compressingCount;
+        compressingFiles.clear();
+        emit exportProgressChanged(processedCount, totalCount);
+    };
+    emit exportProgressChanged(processedCount, totalCount);
+    bool hasNext = isWritten && query.next();
+    while (hasNext && isWritten && !m_isExportCanceled) {
+        QVector<ArchivedFile> files;
+        QJsonArray notes;
+        QHash<int, int> noteIndexes;
+        int firstId = query.value(0).toInt();
+        int lastId = firstId;
+        for (; hasNext && notes.size() < EXPORT_BATCH_SIZE; hasNext = query.next()) {
+            lastId = query.value(0).toInt();
+            int parentId = query.value(3).toInt();
+            QString folderPath = QString::fromLatin1(NOTE_ARCHIVE_NOTES_DIRECTORY);
+            if (!folderPaths.value(parentId).isEmpty()) {
+                folderPath += u'/';
+                folderPath += folderPaths.value(parentId);
+            }
+            QString title = query.value(1).toString();
+            QString name = folderPath + u'/' + names.unique(folderPath, exportFileName(title), QStringLiteral(".md"));
+            auto modificationDate = QDateTime::fromMSecsSinceEpoch(query.value(5).toLongLong());
+            noteIndexes[lastId] = notes.size();
+            notes.append(QJsonObject{ { "file", name },
+                                      { "title", title },
+                                      { "folderId", parentId },
+                                      { "creationDate", query.value(4).toLongLong() },
+                                      { "modificationDate", query.value(5).toLongLong() },
+                                      { "isPinned", query.value(6).toInt() != 0 },
+                                      { "tags", QJsonArray() } });
+            files.append({ name, decodeNoteContent(query.value(2)).toUtf8(), modificationDate });
+        }
+        tagQuery.bindValue(":first_id", firstId);
+        tagQuery.bindValue(":last_id", lastId);
+        if (tagQuery.exec()) {
+            while (tagQuery.next()) {
+                auto it = noteIndexes.constFind(tagQuery.value(0).toInt());
+                if (it != noteIndexes.constEnd()) {
+                    auto note = notes[it.value()].toObject();
+                    auto noteTags = note["tags"].toArray();
+                    noteTags.append(tagQuery.value(1).toInt());
+                    note["tags"] = noteTags;
+                    notes[it.value()] = note;
+                }
+            }
+        } else {
+            qDebug() << __FUNCTION__ << __LINE__ << tagQuery.lastError();
+        }
+        int noteCount = files.size();
+        files.prepend({ QStringLiteral("%1%2.json").arg(QLatin1String(NOTE_ARCHIVE_METADATA_PREFIX)).arg(batchCount++),
+                        QJsonDocument(notes).toJson(QJsonDocument::Compact), QDateTime::currentDateTime() });
+
+        if (!compressingFiles.isEmpty()) {
+            finishWriting();
+        }
+        compressingFiles = files;
+        compressingCount = noteCount;
+        compressing = QtConcurrent::mapped(compressingFiles, compressArchivedFile);
+    }
+    if (!compressingFiles.isEmpty()) {
+        finishWriting();
+    }
+
+    bool isCanceled = m_isExportCanceled;
+    if (isWritten && !isCanceled) {
+        isWritten = writer.close() && file.commit();
+    } else {
+        file.cancelWriting();
+    }
+    if (!isWritten) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Failed to write" << fileName << file.errorString();
+    }
+    emit exportFinished(isWritten && !isCanceled ? processedCount : 0, isWritten ? QStringList() : QStringList{ fileName }, isCanceled);
+}
+
+/*!
+ * \brief DBManager::onImportArchiveRequested
+ * Import the notes of an archive written by exportNotesToArchive(). Tags
+ * are matched by name and color and folders by title under the same parent,
+ * the ones missing are created. The archive is read one entry at a time
+ * and the notes of each of its batches are inserted in one transaction, so
+ * only a batch of metadata is held in memory. Batches already inserted are
+ * kept when the import is canceled.
+ * \param fileName
+ */
+void DBManager::onImportArchiveRequested(const QString &fileName)
+{
+    m_isImportCanceled = false;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << __FUNCTION__ << __LINE__ << file.errorString();
+        emit importFinished(0, 0, { fileName }, false);
+        return;
+    }
+    NoteArchiveReader reader(&file);
+    QString name;
+    QByteArray data;
+    QJsonObject index;
+    if (reader.readEntry(name, data) && name == QLatin1String(NOTE_ARCHIVE_INDEX_NAME)) {
+        index = QJsonDocument::fromJson(data).object();
+    }
+    if (index.value("version").toInt() != NOTE_ARCHIVE_VERSION) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Not a notes archive:" << fileName;
+        emit importFinished(0, 0, { fileName }, false);
         return;
     }
+    int totalCount = index.value("noteCount").toInt();
 
-    // Export each note as a .txt file in its corresponding directory
-    QTextDocument doc;
-    while (query.next()) {
-        // int noteId = query.value(0).toInt();
-        QString title = query.value(1).toString();
-        QString content = query.value(2).toString();
-        int parentId = query.value(3).toInt();
-
-        QString notePath = folderPaths[parentId];
-        QString safeTitle = title;
-        if (safeTitle.contains("<br />"))
-            safeTitle = safeTitle.section("<br />", 0, 0, QString::SectionSkipEmpty);
-        safeTitle = safeTitle.simplified();
-        // Convert Markdown to plain text
-        doc.setMarkdown(safeTitle);
-        safeTitle = doc.toPlainText();
-        safeTitle.replace(QRegularExpression(R"([\/\\:*?"<>|])"),
-                          "_"); // Make the title filesystem-safe
-        QString filePath = QStringLiteral("%1%2%3%4").arg(notePath, QDir::separator(), safeTitle, extension);
-
-        if (safeTitle.isEmpty()) {
-            safeTitle = QStringLiteral("Untitled Note");
-        }
-
-        counter = 1;
-        while (directory.exists(filePath)) {
-            filePath = QStringLiteral("%1%2%3 %4%5").arg(notePath, QDir::separator(), safeTitle, QString::number(counter++), extension);
-        }
-
-        QFile file(filePath);
-        if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            QTextStream out(&file);
-            out << content;
-            file.close();
-        } else {
-            qDebug() << "Failed to export note:" << filePath;
+    if (!m_db.transaction()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+    }
+    QHash<QPair<QString, QString>, int> existingTags;
+    const auto tags = getAllTagInfo();
+    for (const auto &tag : tags) {
+        auto key = qMakePair(tag.name(), tag.color());
+        if (!existingTags.contains(key) || existingTags[key] > tag.id()) {
+            existingTags[key] = tag.id();
+        }
+    }
+    QHash<int, int> tagIds;
+    const auto tagArray = index.value("tags").toArray();
+    for (const auto &value : tagArray) {
+        auto tagObject = value.toObject();
+        auto key = qMakePair(tagObject.value("name").toString(), tagObject.value("color").toString());
+        auto it = existingTags.find(key);
+        if (it == existingTags.end()) {
+            TagData tag;
+            tag.setName(key.first);
+            tag.setColor(key.second);
+            it = existingTags.insert(key, addTag(tag));
+        }
+        tagIds[tagObject.value("id").toInt()] = it.value();
+    }
+
+    QHash<QPair<int, QString>, int> folderIdsByTitle;
+    QHash<int, QString> parentAbsPaths;
+    getFoldersByTitle(folderIdsByTitle, parentAbsPaths);
+    QHash<int, int> folderIds{ { ROOT_FOLDER_ID, ROOT_FOLDER_ID }, { TRASH_FOLDER_ID, TRASH_FOLDER_ID }, { DEFAULT_NOTES_FOLDER_ID, DEFAULT_NOTES_FOLDER_ID } };
+    const auto folderArray = index.value("folders").toArray();
+    for (const auto &value : folderArray) {
+        auto folderObject = value.toObject();
+        int archivedId = folderObject.value("id").toInt();
+        if (folderIds.contains(archivedId)) {
+            continue;
         }
+        auto key = qMakePair(folderIds.value(folderObject.value("parentId").toInt(), ROOT_FOLDER_ID), folderObject.value("title").toString());
+        auto it = folderIdsByTitle.find(key);
+        if (it == folderIdsByTitle.end()) {
+            NodeData folder;
+            folder.setNodeType(NodeData::Type::Folder);
+            QDateTime currentDate = QDateTime::currentDateTime();
+            folder.setCreationDateTime(currentDate);
+            folder.setLastModificationDateTime(currentDate);
+            folder.setFullTitle(key.second);
+            folder.setParentId(key.first);
+            it = folderIdsByTitle.insert(key, addNode(folder));
+        }
+        folderIds[archivedId] = it.value();
+    }
+    if (!m_db.commit()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
     }
 
-    qDebug() << "Export completed to:" << baseExportPath;
+    // Notes of the current batch whose content hasn't been read yet, by entry name
+    QHash<QString, QJsonObject> pendingNotes;
+    QHash<int, int> notePositions;
+    QSqlQuery query(m_db);
+    QSqlQuery tagQuery(m_db);
+    if (!tagQuery.prepare(R"(INSERT OR IGNORE INTO "tag_relationship" ("node_id","tag_id") VALUES (:note_id, :tag_id);)")) {
+        qDebug() << __FUNCTION__ << __LINE__ << tagQuery.lastError();
+    }
+    int importedCount = 0;
+    int processedCount = 0;
+    int nodeId = INVALID_NODE_ID;
+    auto finishBatch = [&]() {
+        if (!query.prepare(R"(UPDATE "metadata" SET "value"=:value WHERE "key"='next_node_id';)")) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        query.bindValue(":value", nodeId);
+        if (!query.exec()) {
+            qDebug() << __FUNCTION__ << __LINE__ << query.lastError();
+        }
+        if (!m_db.commit()) {
+            qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+        }
+        // Index the batch now, the timer can't fire before the import is done
+        updateNoteTaskIndex();
+        emit importProgressChanged(processedCount, totalCount);
+    };
+    emit importProgressChanged(processedCount, totalCount);
+    while (reader.readEntry(name, data)) {
+        if (name.startsWith(QLatin1String(NOTE_ARCHIVE_METADATA_PREFIX))) {
+            if (nodeId != INVALID_NODE_ID) {
+                finishBatch();
+                nodeId = INVALID_NODE_ID;
+                if (m_isImportCanceled) {
+                    break;
+                }
+            }
+            processedCount += pendingNotes.size();
+            pendingNotes.clear();
+            const auto notes = QJsonDocument::fromJson(data).array();
+            for (const auto &value : notes) {
+                auto noteObject = value.toObject();
+                pendingNotes.insert(noteObject.value("file").toString(), noteObject);
+            }
+            if (!m_db.transaction()) {
+                qDebug() << __FUNCTION__ << __LINE__ << m_db.lastError();
+            }
+            nodeId = nextAvailableNodeId();
+            continue;
+        }
+        auto pendingNote = pendingNotes.find(name);
+        if (pendingNote == pendingNotes.end()) {
+            continue;
+        }
+        const QJsonObject noteObject = pendingNote.value();
+        pendingNotes.erase(pendingNote);
+        int noteParentId = folderIds.value(noteObject.value("folderId").toInt(), DEFAULT_NOTES_FOLDER_ID);
+        auto parentAbsPath = parentAbsPaths.find(noteParentId);
+        if (parentAbsPath == parentAbsPaths.end()) {
+            parentAbsPath = parentAbsPaths.insert(noteParentId, getNodeAbsolutePath(noteParentId).path());
+        }
+        auto notePosition = notePositions.find(noteParentId);
+        if (notePosition == notePositions.end()) {
+            notePosition = notePositions.insert(noteParentId, nextAvailablePosition(noteParentId, NodeData::Type::Note));
+        }
+        NodeData note;
+        note.setFullTitle(noteObject.value("title").toString());
+        note.setContent(QString::fromUtf8(data));
+        note.setId(nodeId++);
+        note.setRelativePosition(notePosition.value()++);
+        note.setAbsolutePath(parentAbsPath.value() + PATH_SEPARATOR + QString::number(note.id()));
+        note.setNodeType(NodeData::Type::Note);
+        note.setParentId(noteParentId);
+        note.setIsPinnedNote(noteObject.value("isPinned").toBool());
+        note.setCreationDateTime(QDateTime::fromMSecsSinceEpoch(noteObject.value("creationDate").toVariant().toLongLong()));
+        note.setLastModificationDateTime(QDateTime::fromMSecsSinceEpoch(noteObject.value("modificationDate").toVariant().toLongLong()));
+        addNodePreComputed(note);
+        const auto noteTags = noteObject.value("tags").toArray();
+        for (const auto &tagId : noteTags) {
+            auto it = tagIds.constFind(tagId.toInt());
+            if (it == tagIds.constEnd()) {
+                continue;
+            }
+            tagQuery.bindValue(":note_id", note.id());
+            tagQuery.bindValue(":tag_id", it.value());
+            if (!tagQuery.exec()) {
+                qDebug() << __FUNCTION__ << __LINE__ << tagQuery.lastError();
+            }
+        }
+        ++importedCount;
+        ++processedCount;
+    }
+    if (nodeId != INVALID_NODE_ID) {
+        finishBatch();
+    }
+
+    QStringList failedFileNames;
+    if (reader.hasError()) {
+        failedFileNames.append(fileName);
+    }
+    recalculateChildNotesCount();
+    emitNodeTagTreeChanges();
+    emit importFinished(importedCount, 0, failedFileNames, m_isImportCanceled);
 }
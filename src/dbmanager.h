@@ -7,9 +7,16 @@
 #include <QObject>
 #include <QtSql/QSqlDatabase>
 #include <QPair>
+#include <QHash>
 #include <QSet>
 #include <QVector>
 #include <QTextDocument>
+#include <QFutureWatcher>
+#include <atomic>
+
+class QSqlQuery;
+class QTimer;
+struct sqlite3_backup;
 
 struct NodeTagTreeData
 {
@@ -37,6 +44,35 @@ struct Folder
 
 using FolderListType = QMap<int, QString>;
 
+struct NoteRevision
+{
+    int id;
+    int noteId;
+    QDateTime creationDateTime;
+    QString title;
+    bool isSnapshot;
+};
+
+struct NoteTask
+{
+    int noteId;
+    QString noteTitle;
+    int line;
+    QString column;
+    bool isChecked;
+    QString text;
+};
+
+struct NoteEditLog
+{
+    QString content;
+    QString title;
+    qint64 modificationDate;
+    int scrollBarPosition;
+    int entryCount;
+    qint64 loggedSize;
+};
+
 class DBManager : public QObject
 {
     Q_OBJECT
@@ -46,12 +82,19 @@ public:
     Q_INVOKABLE NodeData getNode(int nodeId);
     Q_INVOKABLE void moveFolderToTrash(const NodeData &node);
     Q_INVOKABLE FolderListType getFolderList();
-    void exportNotes(const QString &baseExportPath, const QString &extension);
-    void addNotesToNewImportedFolder(const QList<QPair<QString, QDateTime>> &fileDatas);
+    void cancelImport();
+    void cancelExport();
 
 private:
     void open(const QString &path, bool doCreate = false);
     void createTables();
+    void createIndexes();
+    void createNoteEditLogTable();
+    void createContentCompressedColumn();
+    void createNoteRevisionTable();
+    bool createNoteTaskTable();
+    bool createNoteSearchTable();
+    void createImportedFileTable();
 
     bool isNodeExist(const NodeData &node);
     QString m_dbpath;
@@ -61,7 +104,32 @@ private:
     QVector<TagData> getAllTagInfo();
     QSet<int> getAllTagForNote(int noteId);
     bool updateNoteContent(const NodeData &note);
+    bool appendNoteEdit(int noteId, const QString &content, const QString &title, qint64 modificationDate, int scrollBarPosition);
+    bool loadNoteEditLog(int noteId, NoteEditLog &log);
+    void compactNoteEditLog(int noteId);
+    void compactAllNoteEditLogs();
+    void discardNoteEditLog(int noteId);
+    void applyPendingNoteEdits(NodeData &note) const;
+    void bindNoteContent(QSqlQuery &query, const QString &content) const;
+    void addNoteRevision(const NodeData &note, bool isForced);
+    QVector<NoteRevision> getNoteRevisions(int noteId);
+    QString getNoteRevisionContent(int revisionId);
+    void removeNoteRevisions(int noteId);
+    void queueNoteTasksUpdate(int noteId, const QString &content);
+    void indexNoteTasks(int noteId, const QString &content);
+    void indexAllNoteTasks(int firstNodeId = ROOT_FOLDER_ID);
+    void removeNoteTasks(int noteId);
+    void indexNoteSearch(int noteId, const QString &content);
+    void removeNoteSearch(int noteId);
+    void indexAllNoteSearch(int firstNodeId = ROOT_FOLDER_ID);
+    QVector<NoteTask> readNoteTasks(QSqlQuery &query);
+    QVector<NoteTask> getOpenTasks();
+    QVector<NoteTask> getTasksByTag(int tagId, bool isOpenOnly = true);
+    QVector<NoteTask> getTasksInFolder(int folderId, bool isOpenOnly = true);
     QList<NodeData> readOldNBK(const QString &fileName);
+    bool importNotesFromDatabase(const QString &fileName);
+    void getFoldersByTitle(QHash<QPair<int, QString>, int> &folderIds, QHash<int, QString> &folderPaths);
+    void importPlainTextFiles(const QStringList &fileNames, const QHash<QString, int> &directoryFolderIds, int parentId, const QString &baseDirectoryPath);
     int nextAvailablePosition(int parentId, NodeData::Type nodeType);
     int addNodePreComputed(const NodeData &node);
     void recalculateChildNotesCount();
@@ -72,6 +140,15 @@ private:
     void decreaseChildNotesCountTag(int tagId);
     void increaseChildNotesCountFolder(int folderId);
     void decreaseChildNotesCountFolder(int folderId);
+    void changeChildNotesCountTag(int tagId, int delta);
+    void changeChildNotesCountFolder(int folderId, int delta);
+    int countNotesInSubtree(const QString &folderPath);
+    void startNextBackup();
+    void stepBackup();
+    void finishBackup(bool isSuccess);
+    void cancelBackups();
+    void runScheduledBackup();
+    void rotateBackups();
 
 signals:
     void notesListReceived(const QVector<NodeData> &noteList, const ListViewInfo &inf);
@@ -84,6 +161,20 @@ signals:
     void showErrorMessage(const QString &title, const QString &content);
     void childNotesCountUpdatedTag(int tagId, int childCount);
     void childNotesCountUpdatedFolder(int folderId, const QString &path, int childCount);
+    void folderAdded(const NodeData &folder);
+    void folderRemoved(int folderId);
+    void folderMoved(int folderId, int parentId);
+    void folderRenamed(int folderId, const QString &newName);
+    void noteRevisionsReceived(int noteId, const QVector<NoteRevision> &revisions);
+    void noteRevisionRestored(const NodeData &note);
+    void importedNoteUpdated(const NodeData &note);
+    void taskBoardReceived(const QVector<NoteTask> &tasks);
+    void importProgressChanged(int processedCount, int totalCount);
+    void importFinished(int importedCount, int skippedCount, const QStringList &failedFileNames, bool isCanceled);
+    void exportProgressChanged(int processedCount, int totalCount);
+    void exportFinished(int exportedCount, const QStringList &failedFilePaths, bool isCanceled);
+    void backupProgressChanged(const QString &fileName, int copiedPageCount, int pageCount);
+    void backupFinished(const QString &fileName, bool isSuccess);
 
 public slots:
     void onNodeTagTreeRequested();
@@ -92,12 +183,28 @@ public slots:
     void onOpenDBManagerRequested(const QString &path, bool doCreate);
     void onCreateUpdateRequestedNoteContent(const NodeData &note);
     void onImportNotesRequested(const QString &fileName);
+    void onImportPlainTextFilesRequested(const QStringList &fileNames);
+    void onImportPlainTextDirectoryRequested(const QString &directoryPath);
+    void onImportArchiveRequested(const QString &fileName);
     void onRestoreNotesRequested(const QString &fileName);
     void onExportNotesRequested(const QString &fileName);
+    void setBackupSchedule(const QString &directoryPath, int intervalHours, int keptBackupCount);
+    void exportNotes(const QString &baseExportPath, const QString &extension);
+    void exportNotesIncrementally(const QString &exportPath, const QString &extension);
+    void exportNotesToArchive(const QString &fileName);
     void onMigrateNotesFromV0_9_0Requested(QVector<NodeData> &noteList);
     void onMigrateTrashFrom0_9_0Requested(QVector<NodeData> &noteList);
     void onMigrateNotesFrom1_5_0Requested(const QString &fileName);
     void onChangeDatabasePathRequested(const QString &newPath);
+    void onNoteEditClosed(const NodeData &note);
+    void onNoteRevisionsRequested(int noteId);
+    void restoreNoteRevision(int revisionId);
+    void setContentCompressionEnabled(bool isEnabled);
+    void recompressNoteContents();
+    void updateNoteTaskIndex();
+    void onTaskBoardRequested();
+    void onTaskBoardInFolderRequested(int folderId);
+    void onTaskBoardInTagRequested(int tagId);
 
     int addNode(const NodeData &node);
 
@@ -120,6 +227,26 @@ public slots:
     void updateRelPosPinnedNoteAN(int nodeId, int relPos);
     void setNoteIsPinned(int noteId, bool isPinned);
     NodeData getChildNotesCountFolder(int folderId);
+
+private:
+    void emitNodeTagTreeChanges();
+
+    bool m_hasLastTree;
+    QHash<int, NodeData> m_lastTreeFolders;
+    QHash<int, TagData> m_lastTreeTags;
+    QHash<int, NoteEditLog> m_noteEditLogs;
+    bool m_isContentCompressionEnabled;
+    bool m_hasNoteSearchIndex;
+    QHash<int, QString> m_pendingNoteTasks;
+    std::atomic<bool> m_isImportCanceled;
+    std::atomic<bool> m_isExportCanceled;
+    sqlite3_backup *m_backup;
+    QFutureWatcher<bool> *m_backupWatcher;
+    QString m_backupFileName;
+    QStringList m_pendingBackupFileNames;
+    QTimer *m_backupTimer;
+    QString m_backupDirectory;
+    int m_keptBackupCount;
 };
 
 #endif // DBMANAGER_H
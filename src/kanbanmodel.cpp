@@ -0,0 +1,333 @@
+#include "kanbanmodel.h"
+#include <algorithm>
+
+KanbanTaskModel::KanbanTaskModel(QObject *parent) : QAbstractListModel(parent)
+{
+    connect(this, &QAbstractItemModel::rowsInserted, this, &KanbanTaskModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &KanbanTaskModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &KanbanTaskModel::countChanged);
+}
+
+/*!
+ * \brief KanbanTaskModel::setTasks
+ * Update the rows in place, only the roles that differ are reported as
+ * changed. Rows past the new task count are removed, new ones appended.
+ * \param tasks
+ */
+void KanbanTaskModel::setTasks(const QVector<KanbanTask> &tasks)
+{
+    int commonCount = std::min(m_rows.size(), tasks.size());
+    for (int i = 0; i < commonCount; ++i) {
+        auto &row = m_rows[i].task;
+        const auto &task = tasks[i];
+        QVector<int> roles;
+        if (row.text != task.text) {
+            roles.append(static_cast<int>(KanbanTaskRole::TaskTextRole));
+        }
+        if (row.checked != task.checked) {
+            roles.append(static_cast<int>(KanbanTaskRole::TaskCheckedRole));
+        }
+        if (row.startLine != task.startLine) {
+            roles.append(static_cast<int>(KanbanTaskRole::TaskStartLineRole));
+        }
+        if (row.endLine != task.endLine) {
+            roles.append(static_cast<int>(KanbanTaskRole::TaskEndLineRole));
+        }
+        if (!roles.isEmpty()) {
+            row = task;
+            emit dataChanged(index(i), index(i), roles);
+        }
+    }
+    if (tasks.size() > m_rows.size()) {
+        beginInsertRows(QModelIndex(), m_rows.size(), tasks.size() - 1);
+        for (int i = m_rows.size(); i < tasks.size(); ++i) {
+            m_rows.append({ tasks[i], false });
+        }
+        endInsertRows();
+    } else if (tasks.size() < m_rows.size()) {
+        beginRemoveRows(QModelIndex(), tasks.size(), m_rows.size() - 1);
+        m_rows.resize(tasks.size());
+        endRemoveRows();
+    }
+}
+
+int KanbanTaskModel::completedTaskCount() const
+{
+    return std::count_if(m_rows.cbegin(), m_rows.cend(), [](const TaskRow &row) { return row.task.checked; });
+}
+
+QVariantMap KanbanTaskModel::get(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return {};
+    }
+    const auto &taskRow = m_rows[row];
+    return { { "taskText", taskRow.task.text },
+             { "taskChecked", taskRow.task.checked },
+             { "taskStartLine", taskRow.task.startLine },
+             { "taskEndLine", taskRow.task.endLine },
+             { "doNeedAnimateTaskCreation", taskRow.doNeedAnimateTaskCreation } };
+}
+
+void KanbanTaskModel::insert(int row, const QVariantMap &task)
+{
+    row = std::clamp(row, 0, static_cast<int>(m_rows.size()));
+    beginInsertRows(QModelIndex(), row, row);
+    m_rows.insert(row,
+                  { { task.value("taskText").toString(), task.value("taskChecked").toBool(), task.value("taskStartLine").toInt(),
+                      task.value("taskEndLine").toInt() },
+                    task.value("doNeedAnimateTaskCreation").toBool() });
+    endInsertRows();
+}
+
+void KanbanTaskModel::remove(int row)
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return;
+    }
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.removeAt(row);
+    endRemoveRows();
+}
+
+int KanbanTaskModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return m_rows.size();
+}
+
+QVariant KanbanTaskModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return {};
+    }
+    const auto &row = m_rows[index.row()];
+    switch (static_cast<KanbanTaskRole>(role)) {
+    case KanbanTaskRole::TaskTextRole:
+        return row.task.text;
+    case KanbanTaskRole::TaskCheckedRole:
+        return row.task.checked;
+    case KanbanTaskRole::TaskStartLineRole:
+        return row.task.startLine;
+    case KanbanTaskRole::TaskEndLineRole:
+        return row.task.endLine;
+    case KanbanTaskRole::DoNeedAnimateTaskCreationRole:
+        return row.doNeedAnimateTaskCreation;
+    }
+    return {};
+}
+
+QHash<int, QByteArray> KanbanTaskModel::roleNames() const
+{
+    return { { static_cast<int>(KanbanTaskRole::TaskTextRole), "taskText" },
+             { static_cast<int>(KanbanTaskRole::TaskCheckedRole), "taskChecked" },
+             { static_cast<int>(KanbanTaskRole::TaskStartLineRole), "taskStartLine" },
+             { static_cast<int>(KanbanTaskRole::TaskEndLineRole), "taskEndLine" },
+             { static_cast<int>(KanbanTaskRole::DoNeedAnimateTaskCreationRole), "doNeedAnimateTaskCreation" } };
+}
+
+KanbanColumnModel::KanbanColumnModel(QObject *parent) : QAbstractListModel(parent), m_isTasksReversed{ false }
+{
+    connect(this, &QAbstractItemModel::rowsInserted, this, &KanbanColumnModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &KanbanColumnModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &KanbanColumnModel::countChanged);
+}
+
+/*!
+ * \brief KanbanColumnModel::setColumns
+ * Apply the columns parsed from the note. Existing columns keep their id
+ * and task model, columns past the new count are removed and new ones
+ * appended.
+ * \param columns
+ */
+void KanbanColumnModel::setColumns(const QVector<KanbanColumn> &columns)
+{
+    m_columns = columns;
+    applyColumns();
+}
+
+void KanbanColumnModel::applyColumns()
+{
+    int commonCount = std::min(m_rows.size(), m_columns.size());
+    for (int i = 0; i < commonCount; ++i) {
+        auto &row = m_rows[i];
+        const auto &column = m_columns[i];
+        QVector<int> roles;
+        if (row.title != column.title) {
+            roles.append(static_cast<int>(KanbanColumnRole::TitleRole));
+        }
+        if (row.startLine != column.startLine) {
+            roles.append(static_cast<int>(KanbanColumnRole::ColumnStartLineRole));
+        }
+        if (row.endLine != column.endLine) {
+            roles.append(static_cast<int>(KanbanColumnRole::ColumnEndLineRole));
+        }
+        if (!roles.isEmpty()) {
+            row.title = column.title;
+            row.startLine = column.startLine;
+            row.endLine = column.endLine;
+            emit dataChanged(index(i), index(i), roles);
+        }
+    }
+    if (m_columns.size() > m_rows.size()) {
+        beginInsertRows(QModelIndex(), m_rows.size(), m_columns.size() - 1);
+        for (int i = m_rows.size(); i < m_columns.size(); ++i) {
+            const auto &column = m_columns[i];
+            m_rows.append({ getNewColumnID(), column.title, column.startLine, column.endLine, new KanbanTaskModel(this) });
+        }
+        endInsertRows();
+    } else if (m_columns.size() < m_rows.size()) {
+        beginRemoveRows(QModelIndex(), m_columns.size(), m_rows.size() - 1);
+        for (int i = m_columns.size(); i < m_rows.size(); ++i) {
+            m_rows[i].taskModel->deleteLater();
+        }
+        m_rows.resize(m_columns.size());
+        endRemoveRows();
+    }
+    for (int i = 0; i < m_rows.size(); ++i) {
+        auto tasks = m_columns[i].tasks;
+        if (m_isTasksReversed) {
+            std::reverse(tasks.begin(), tasks.end());
+        }
+        m_rows[i].taskModel->setTasks(tasks);
+    }
+}
+
+QVariantMap KanbanColumnModel::get(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return {};
+    }
+    const auto &columnRow = m_rows[row];
+    return { { "title", columnRow.title },
+             { "columnID", columnRow.id },
+             { "columnStartLine", columnRow.startLine },
+             { "columnEndLine", columnRow.endLine } };
+}
+
+void KanbanColumnModel::append(const QVariantMap &column)
+{
+    beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size());
+    m_rows.append({ column.value("columnID", getNewColumnID()).toInt(), column.value("title").toString(), column.value("columnStartLine").toInt(),
+                    column.value("columnEndLine").toInt(), new KanbanTaskModel(this) });
+    endInsertRows();
+}
+
+void KanbanColumnModel::remove(int row)
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return;
+    }
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.takeAt(row).taskModel->deleteLater();
+    endRemoveRows();
+}
+
+void KanbanColumnModel::move(int from, int to, int count)
+{
+    if (count <= 0 || from == to || from < 0 || to < 0 || from + count > m_rows.size() || to + count > m_rows.size()) {
+        return;
+    }
+    beginMoveRows(QModelIndex(), from, from + count - 1, QModelIndex(), to > from ? to + count : to);
+    auto moved = m_rows.mid(from, count);
+    m_rows.remove(from, count);
+    for (int i = 0; i < count; ++i) {
+        m_rows.insert(to + i, moved[i]);
+    }
+    endMoveRows();
+}
+
+void KanbanColumnModel::clear()
+{
+    beginResetModel();
+    for (const auto &row : std::as_const(m_rows)) {
+        row.taskModel->deleteLater();
+    }
+    m_rows.clear();
+    m_columns.clear();
+    endResetModel();
+}
+
+int KanbanColumnModel::getNewColumnID() const
+{
+    int previousLargest = -1;
+    for (const auto &row : std::as_const(m_rows)) {
+        previousLargest = std::max(previousLargest, row.id);
+    }
+    return previousLargest + 1;
+}
+
+KanbanTaskModel *KanbanColumnModel::taskModel(int columnID) const
+{
+    for (const auto &row : std::as_const(m_rows)) {
+        if (row.id == columnID) {
+            return row.taskModel;
+        }
+    }
+    return nullptr;
+}
+
+void KanbanColumnModel::setTasksReversed(bool isReversed)
+{
+    if (m_isTasksReversed == isReversed) {
+        return;
+    }
+    m_isTasksReversed = isReversed;
+    if (m_columns.size() == m_rows.size()) {
+        applyColumns();
+    }
+}
+
+int KanbanColumnModel::taskCount() const
+{
+    int count = 0;
+    for (const auto &row : std::as_const(m_rows)) {
+        count += row.taskModel->rowCount();
+    }
+    return count;
+}
+
+int KanbanColumnModel::completedTaskCount() const
+{
+    int count = 0;
+    for (const auto &row : std::as_const(m_rows)) {
+        count += row.taskModel->completedTaskCount();
+    }
+    return count;
+}
+
+int KanbanColumnModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return m_rows.size();
+}
+
+QVariant KanbanColumnModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return {};
+    }
+    const auto &row = m_rows[index.row()];
+    switch (static_cast<KanbanColumnRole>(role)) {
+    case KanbanColumnRole::TitleRole:
+        return row.title;
+    case KanbanColumnRole::ColumnIDRole:
+        return row.id;
+    case KanbanColumnRole::ColumnStartLineRole:
+        return row.startLine;
+    case KanbanColumnRole::ColumnEndLineRole:
+        return row.endLine;
+    case KanbanColumnRole::TaskModelRole:
+        return QVariant::fromValue(row.taskModel);
+    }
+    return {};
+}
+
+QHash<int, QByteArray> KanbanColumnModel::roleNames() const
+{
+    return { { static_cast<int>(KanbanColumnRole::TitleRole), "title" },
+             { static_cast<int>(KanbanColumnRole::ColumnIDRole), "columnID" },
+             { static_cast<int>(KanbanColumnRole::ColumnStartLineRole), "columnStartLine" },
+             { static_cast<int>(KanbanColumnRole::ColumnEndLineRole), "columnEndLine" },
+             { static_cast<int>(KanbanColumnRole::TaskModelRole), "taskModel" } };
+}
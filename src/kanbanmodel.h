@@ -0,0 +1,122 @@
+#ifndef KANBANMODEL_H
+#define KANBANMODEL_H
+
+#include <QAbstractListModel>
+#include <QVariantMap>
+#include <QVector>
+
+struct KanbanTask
+{
+    QString text;
+    bool checked;
+    int startLine;
+    int endLine;
+};
+
+struct KanbanColumn
+{
+    QString title;
+    int startLine;
+    int endLine;
+    QVector<KanbanTask> tasks;
+};
+
+/*!
+ * \brief The KanbanTaskModel class
+ * Tasks of a single kanban column. Besides the model interface it offers
+ * the few ListModel functions the kanban QML view calls on it.
+ */
+class KanbanTaskModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+public:
+    enum class KanbanTaskRole : std::uint16_t {
+        TaskTextRole = Qt::UserRole + 1,
+        TaskCheckedRole,
+        TaskStartLineRole,
+        TaskEndLineRole,
+        DoNeedAnimateTaskCreationRole,
+    };
+
+    explicit KanbanTaskModel(QObject *parent);
+    void setTasks(const QVector<KanbanTask> &tasks);
+    int completedTaskCount() const;
+
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE void insert(int row, const QVariantMap &task);
+    Q_INVOKABLE void remove(int row);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+
+private:
+    struct TaskRow
+    {
+        KanbanTask task;
+        bool doNeedAnimateTaskCreation;
+    };
+    QVector<TaskRow> m_rows;
+};
+
+/*!
+ * \brief The KanbanColumnModel class
+ * Columns of the kanban view, each with its own task model. Parsed note
+ * content is applied as a diff against the current rows, so only the
+ * columns and tasks that changed are updated in the view.
+ */
+class KanbanColumnModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+public:
+    enum class KanbanColumnRole : std::uint16_t {
+        TitleRole = Qt::UserRole + 1,
+        ColumnIDRole,
+        ColumnStartLineRole,
+        ColumnEndLineRole,
+        TaskModelRole,
+    };
+
+    explicit KanbanColumnModel(QObject *parent);
+    void setColumns(const QVector<KanbanColumn> &columns);
+
+    Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE void append(const QVariantMap &column);
+    Q_INVOKABLE void remove(int row);
+    Q_INVOKABLE void move(int from, int to, int count);
+    Q_INVOKABLE void clear();
+    Q_INVOKABLE int getNewColumnID() const;
+    Q_INVOKABLE KanbanTaskModel *taskModel(int columnID) const;
+    Q_INVOKABLE void setTasksReversed(bool isReversed);
+    Q_INVOKABLE int taskCount() const;
+    Q_INVOKABLE int completedTaskCount() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+
+private:
+    struct ColumnRow
+    {
+        int id;
+        QString title;
+        int startLine;
+        int endLine;
+        KanbanTaskModel *taskModel;
+    };
+    QVector<ColumnRow> m_rows;
+    QVector<KanbanColumn> m_columns;
+    bool m_isTasksReversed;
+
+    void applyColumns();
+};
+
+#endif // KANBANMODEL_H
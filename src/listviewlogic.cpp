@@ -40,6 +40,8 @@ ListViewLogic::ListViewLogic(NoteListView *noteView, NoteListModel *noteModel, Q
     m_listView->setItemDelegate(m_listDelegate);
     m_listView->setDbManager(m_dbManager);
     connect(m_dbManager, &DBManager::notesListReceived, this, &ListViewLogic::loadNoteListModel);
+    connect(m_dbManager, &DBManager::noteRevisionRestored, this, &ListViewLogic::setNoteData);
+    connect(m_dbManager, &DBManager::importedNoteUpdated, this, &ListViewLogic::setNoteData);
     // note model rows moved
     connect(m_listModel, &NoteListModel::rowsAboutToBeMovedC, m_listView, &NoteListView::rowsAboutToBeMoved);
     connect(m_listModel, &NoteListModel::rowsMovedC, m_listView, &NoteListView::rowsMoved);
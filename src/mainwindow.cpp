@@ -10,6 +10,7 @@
 #include "treeviewlogic.h"
 #include "listviewlogic.h"
 #include "noteeditorlogic.h"
+#include "kanbanmodel.h"
 #include "tagpool.h"
 #include "splitterstyle.h"
 #include "editorsettingsoptions.h"
@@ -23,7 +24,9 @@
 #include <QtConcurrent>
 #include <QProgressDialog>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QLocale>
 #include <QList>
 #include <QWidgetAction>
 #include <QTimer>
@@ -31,6 +34,7 @@
 #include <QSqlQuery>
 
 #define DEFAULT_DATABASE_NAME "default_database"
+#define DEFAULT_KEPT_BACKUP_COUNT 7
 
 /*!
  * \brief MainWindow::MainWindow
@@ -67,6 +71,7 @@ MainWindow::MainWindow(QWidget *parent)
       m_treeViewLogic(nullptr),
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
       m_kanbanWidget(nullptr),
+      m_kanbanColumnModel(nullptr),
 #endif
       m_editorSettingsQuickView(nullptr),
       m_editorSettingsWidget(new QWidget(this)),
@@ -546,6 +551,8 @@ void MainWindow::setupKeyboardShortcuts()
     new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F), this, SLOT(fullscreenWindow()));
     new QShortcut(Qt::Key_F11, this, SLOT(fullscreenWindow()));
     connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_L), this), &QShortcut::activated, this, [=]() { m_listView->setFocus(); });
+    connect(new QShortcut(QKeySequence::FindNext, this), &QShortcut::activated, this, [=]() { m_noteEditorLogic->findNextSearchMatch(); });
+    connect(new QShortcut(QKeySequence::FindPrevious, this), &QShortcut::activated, this, [=]() { m_noteEditorLogic->findPreviousSearchMatch(); });
     new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_M), this, SLOT(minimizeWindow()));
     new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_Q), this, SLOT(quitApplication()));
 #if defined(Q_OS_MACOS) || defined(Q_OS_WINDOWS)
@@ -791,7 +798,20 @@ void MainWindow::setupSignalsSlots()
     connect(this, &MainWindow::requestNodesTree, m_dbManager, &DBManager::onNodeTagTreeRequested, Qt::BlockingQueuedConnection);
     connect(this, &MainWindow::requestRestoreNotes, m_dbManager, &DBManager::onRestoreNotesRequested, Qt::BlockingQueuedConnection);
     connect(this, &MainWindow::requestImportNotes, m_dbManager, &DBManager::onImportNotesRequested, Qt::BlockingQueuedConnection);
-    connect(this, &MainWindow::requestExportNotes, m_dbManager, &DBManager::onExportNotesRequested, Qt::BlockingQueuedConnection);
+    connect(this, &MainWindow::requestImportPlainTextFiles, m_dbManager, &DBManager::onImportPlainTextFilesRequested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestImportPlainTextDirectory, m_dbManager, &DBManager::onImportPlainTextDirectoryRequested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestExportPlainTextFiles, m_dbManager, &DBManager::exportNotes, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestIncrementalExport, m_dbManager, &DBManager::exportNotesIncrementally, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestExportArchive, m_dbManager, &DBManager::exportNotesToArchive, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestImportArchive, m_dbManager, &DBManager::onImportArchiveRequested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestExportNotes, m_dbManager, &DBManager::onExportNotesRequested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestNoteRevisions, m_dbManager, &DBManager::onNoteRevisionsRequested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestRestoreNoteRevision, m_dbManager, &DBManager::restoreNoteRevision, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::noteRevisionsReceived, this, &MainWindow::onNoteRevisionsReceived);
+    connect(this, &MainWindow::requestTaskBoard, m_dbManager, &DBManager::onTaskBoardRequested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestTaskBoardInFolder, m_dbManager, &DBManager::onTaskBoardInFolderRequested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestTaskBoardInTag, m_dbManager, &DBManager::onTaskBoardInTagRequested, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::taskBoardReceived, this, &MainWindow::onTaskBoardReceived);
     connect(this, &MainWindow::requestMigrateNotesFromV0_9_0, m_dbManager, &DBManager::onMigrateNotesFromV0_9_0Requested, Qt::BlockingQueuedConnection);
     connect(this, &MainWindow::requestMigrateTrashFromV0_9_0, m_dbManager, &DBManager::onMigrateTrashFrom0_9_0Requested, Qt::BlockingQueuedConnection);
 
@@ -1209,7 +1229,9 @@ void MainWindow::setupKanbanView()
 
     QUrl source("qrc:/qt/qml/kanbanMain.qml");
     m_kanbanWidget = new QQuickWidget(this);
+    m_kanbanColumnModel = new KanbanColumnModel(this);
     m_kanbanWidget->rootContext()->setContextProperty("noteEditorLogic", m_noteEditorLogic);
+    m_kanbanWidget->rootContext()->setContextProperty("kanbanColumnModel", m_kanbanColumnModel);
     m_kanbanWidget->rootContext()->setContextProperty("mainWindow", this);
     m_kanbanWidget->setSource(source);
     m_kanbanWidget->setResizeMode(QQuickWidget::SizeRootObjectToView);
@@ -1603,12 +1625,20 @@ void MainWindow::setupDatabases()
     connect(m_dbThread, &QThread::started, this, [=]() {
         setTheme(m_currentTheme);
         emit requestOpenDBManager(noteDBFilePath, doCreate);
+        emit requestSetContentCompression(m_settingsDatabase->value(QStringLiteral("compressLargeNotes"), false).toBool());
         if (needMigrateFromV1_5_0) {
             emit requestMigrateNotesFromV1_5_0(dir.path() + QDir::separator() + QStringLiteral("oldNotes.db"));
         }
+        int backupIntervalHours = m_settingsDatabase->value(QStringLiteral("backupIntervalHours"), 0).toInt();
+        if (backupIntervalHours > 0) {
+            emit requestBackupSchedule(m_settingsDatabase->value(QStringLiteral("backupDirectory")).toString(), backupIntervalHours,
+                                       m_settingsDatabase->value(QStringLiteral("keptBackupCount"), DEFAULT_KEPT_BACKUP_COUNT).toInt());
+        }
     });
     connect(this, &MainWindow::requestOpenDBManager, m_dbManager, &DBManager::onOpenDBManagerRequested, Qt::QueuedConnection);
     connect(this, &MainWindow::requestMigrateNotesFromV1_5_0, m_dbManager, &DBManager::onMigrateNotesFrom1_5_0Requested, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestBackupSchedule, m_dbManager, &DBManager::setBackupSchedule, Qt::QueuedConnection);
+    connect(this, &MainWindow::requestSetContentCompression, m_dbManager, &DBManager::setContentCompressionEnabled, Qt::QueuedConnection);
     connect(m_dbThread, &QThread::finished, m_dbManager, &QObject::deleteLater);
     m_dbThread->start();
 }
@@ -1628,7 +1658,8 @@ void MainWindow::setupModelView()
     m_treeView->setModel(m_treeModel);
     m_treeViewLogic = new TreeViewLogic(m_treeView, m_treeModel, m_dbManager, m_listView, this);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-    m_noteEditorLogic = new NoteEditorLogic(m_textEdit, m_editorDateLabel, m_searchEdit, m_kanbanWidget, m_ui->tagListView, m_tagPool, m_dbManager, this);
+    m_noteEditorLogic = new NoteEditorLogic(m_textEdit, m_editorDateLabel, m_searchEdit, m_kanbanWidget, m_kanbanColumnModel, m_ui->tagListView, m_tagPool,
+                                            m_dbManager, this);
     m_kanbanWidget->rootContext()->setContextProperty("noteEditorLogic", m_noteEditorLogic);
 #else
     m_noteEditorLogic = new NoteEditorLogic(m_textEdit, m_editorDateLabel, m_searchEdit, m_ui->tagListView, m_tagPool, m_dbManager, this);
@@ -2003,6 +2034,16 @@ void MainWindow::setupGlobalSettingsMenu()
     importExportNotesMenu->setFont(QFont(m_displayFont, 10, QFont::Normal));
 #endif
 
+    // History of the open note
+    QAction *noteHistoryAction = m_mainMenu.addAction(tr("Note &History..."));
+    noteHistoryAction->setToolTip(tr("Restore the open note to an earlier revision"));
+    connect(noteHistoryAction, &QAction::triggered, this, &MainWindow::showNoteHistory);
+
+    // Open tasks of the notes listed
+    QAction *openTasksAction = m_mainMenu.addAction(tr("Open &Tasks..."));
+    openTasksAction->setToolTip(tr("List the unchecked tasks of the notes in the selected folder or tag"));
+    connect(openTasksAction, &QAction::triggered, this, &MainWindow::showOpenTasks);
+
 #if defined(UPDATE_CHECKER)
     // Check for update action
     QAction *checkForUpdatesAction = m_mainMenu.addAction(tr("Check For &Updates"));
@@ -2041,6 +2082,16 @@ void MainWindow::setupGlobalSettingsMenu()
         }
     });
 
+    // Compress large notes in the database, off by default
+    QAction *compressLargeNotesAction = m_mainMenu.addAction(tr("C&ompress large notes"));
+    compressLargeNotesAction->setToolTip(tr("Store large notes compressed to save disk space"));
+    compressLargeNotesAction->setCheckable(true);
+    compressLargeNotesAction->setChecked(m_settingsDatabase->value(QStringLiteral("compressLargeNotes"), false).toBool());
+    connect(compressLargeNotesAction, &QAction::triggered, this, [this](bool checked) {
+        m_settingsDatabase->setValue(QStringLiteral("compressLargeNotes"), checked);
+        emit requestSetContentCompression(checked);
+    });
+
     // About Notes
     QAction *aboutAction = m_mainMenu.addAction(tr("&About Notes"));
     connect(aboutAction, &QAction::triggered, this, [&]() { m_aboutWindow.show(); });
@@ -2065,6 +2116,11 @@ void MainWindow::setupGlobalSettingsMenu()
     importNotesPlainTextAction->setToolTip(tr("Import notes from .txt or .md files"));
     connect(importNotesPlainTextAction, &QAction::triggered, this, &MainWindow::importPlainTextFiles);
 
+    QAction *importNotesDirectoryAction = importExportNotesMenu->addAction(tr("Import &Folder of .txt/.md"));
+    importNotesDirectoryAction->setToolTip(tr("Import the .txt and .md files of a folder and its subfolders,\nkeeping the folder structure. "
+                                              "Unchanged files imported before are skipped,\nchanged ones update their note"));
+    connect(importNotesDirectoryAction, &QAction::triggered, this, &MainWindow::importPlainTextDirectory);
+
     QAction *exportNotesToPlainTextAction = importExportNotesMenu->addAction(tr("&Export to .txt"));
     exportNotesToPlainTextAction->setToolTip(tr("Export notes to .txt files\nNote: If you wish to backup your notes,\nuse the .nbk "
                                                 "file format instead of .txt/.md"));
@@ -2075,6 +2131,19 @@ void MainWindow::setupGlobalSettingsMenu()
                                                "file format instead of .txt/.md"));
     connect(exportNotesToMarkdownAction, &QAction::triggered, this, [this]() { exportToPlainTextFiles(".md"); });
 
+    QAction *syncNotesToMarkdownAction = importExportNotesMenu->addAction(tr("&Sync to .md Folder"));
+    syncNotesToMarkdownAction->setToolTip(tr("Export notes to .md files in a folder kept in sync with them,\n"
+                                             "only the notes changed since the last sync are written"));
+    connect(syncNotesToMarkdownAction, &QAction::triggered, this, &MainWindow::exportToPlainTextDirectory);
+
+    QAction *exportNotesToArchiveAction = importExportNotesMenu->addAction(tr("Export to &Archive (.zip)"));
+    exportNotesToArchiveAction->setToolTip(tr("Export notes, with their folders and tags, to a single .zip file"));
+    connect(exportNotesToArchiveAction, &QAction::triggered, this, &MainWindow::exportNotesToArchive);
+
+    QAction *importNotesArchiveAction = importExportNotesMenu->addAction(tr("Import from A&rchive (.zip)"));
+    importNotesArchiveAction->setToolTip(tr("Add notes from a .zip file exported by Notes"));
+    connect(importNotesArchiveAction, &QAction::triggered, this, &MainWindow::importNotesFromArchive);
+
     importExportNotesMenu->addSeparator();
 
     // Export notes action
@@ -2082,6 +2151,11 @@ void MainWindow::setupGlobalSettingsMenu()
     exportNotesFileAction->setToolTip(tr("Save notes to a file"));
     connect(exportNotesFileAction, &QAction::triggered, this, &MainWindow::exportNotesFile);
 
+    // Scheduled backups action
+    QAction *scheduleBackupsAction = importExportNotesMenu->addAction(tr("Sc&hedule Backups..."));
+    scheduleBackupsAction->setToolTip(tr("Save notes to a folder periodically, keeping the most recent backups"));
+    connect(scheduleBackupsAction, &QAction::triggered, this, &MainWindow::scheduleBackups);
+
     // Import notes action
     QAction *importNotesFileAction = importExportNotesMenu->addAction(tr("&Import"));
     importNotesFileAction->setToolTip(tr("Add notes from a file"));
@@ -2674,8 +2748,8 @@ void MainWindow::executeImport(const bool replace)
  * \brief MainWindow::exportNotesFile
  * Called when the "Export Notes" menu button is clicked. this function will
  * prompt the user to select a location for the export file, and then builds
- * the file.
- * The user is presented with a dialog box if the file cannot be opened for any reason.
+ * the file in the background, notes can still be edited meanwhile.
+ * The user is presented with a dialog box if the file cannot be written for any reason.
  * \param clicked
  */
 void MainWindow::exportNotesFile()
@@ -2684,18 +2758,169 @@ void MainWindow::exportNotesFile()
     if (fileName.isEmpty()) {
         return;
     }
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::information(this, tr("Unable to open file"), file.errorString());
+
+#ifdef USE_SYSTEM_SQLITE
+    auto *pd = new QProgressDialog(tr("Saving notes..."), QString(), 0, 0, this);
+#else
+    // Without the system SQLite the file is written in one go, with no progress to show
+    auto *pd = new QProgressDialog(tr("Saving notes...\nProgress can't be shown, notes can still be edited meanwhile."), QString(), 0, 0, this);
+#endif
+    pd->setMinimumDuration(0);
+    pd->setAutoReset(false);
+    pd->setAutoClose(false);
+    pd->setValue(0);
+    connect(m_dbManager, &DBManager::backupProgressChanged, pd, [pd, fileName](const QString &backupFileName, int copiedPageCount, int pageCount) {
+        if (backupFileName == fileName) {
+            pd->setMaximum(pageCount);
+            pd->setValue(copiedPageCount);
+        }
+    });
+    connect(m_dbManager, &DBManager::backupFinished, pd, [this, pd, fileName](const QString &backupFileName, bool isSuccess) {
+        if (backupFileName != fileName) {
+            return;
+        }
+        pd->deleteLater();
+        if (!isSuccess) {
+            QMessageBox::information(this, tr("Unable to save notes"), tr("Can't write file %1").arg(fileName));
+        }
+    });
+    emit requestExportNotes(fileName);
+}
+
+/*!
+ * \brief MainWindow::showNoteHistory
+ * Ask for the revisions of the open note, saving its last edits first so
+ * they are part of its history
+ */
+void MainWindow::showNoteHistory()
+{
+    int noteId = m_noteEditorLogic->currentEditingNoteId();
+    if (noteId == INVALID_NODE_ID || m_noteEditorLogic->isTempNote()) {
+        QMessageBox::information(this, tr("Note History"), tr("Open a note to see its history."));
         return;
     }
-    file.close();
-    emit requestExportNotes(fileName);
+    m_noteEditorLogic->saveNoteToDB();
+    emit requestNoteRevisions(noteId);
 }
 
+/*!
+ * \brief MainWindow::onNoteRevisionsReceived
+ * List the revisions of the open note, newest first, and restore the one
+ * picked. What the note contains now is kept as a revision as well.
+ * \param noteId
+ * \param revisions
+ */
+void MainWindow::onNoteRevisionsReceived(int noteId, const QVector<NoteRevision> &revisions)
+{
+    if (noteId != m_noteEditorLogic->currentEditingNoteId()) {
+        return;
+    }
+    if (revisions.isEmpty()) {
+        QMessageBox::information(this, tr("Note History"), tr("This note has no earlier revisions yet."));
+        return;
+    }
+    QStringList items;
+    items.reserve(revisions.size());
+    for (int i = 0; i < revisions.size(); ++i) {
+        items.append(QStringLiteral("%1. %2 - %3")
+                             .arg(QString::number(i + 1), QLocale().toString(revisions[i].creationDateTime, QLocale::ShortFormat), revisions[i].title));
+    }
+    bool ok = false;
+    QString item = QInputDialog::getItem(this, tr("Note History"), tr("Restore the note to:"), items, 0, false, &ok);
+    int index = items.indexOf(item);
+    if (!ok || index < 0) {
+        return;
+    }
+    emit requestRestoreNoteRevision(revisions[index].id);
+}
+
+/*!
+ * \brief MainWindow::showOpenTasks
+ * Ask for the open tasks of the folder or tag selected, or of all notes
+ */
+void MainWindow::showOpenTasks()
+{
+    // Tasks are read from the database, the last edits have to be in it
+    m_noteEditorLogic->saveNoteToDB();
+    const auto &inf = m_listViewLogic->listViewInfo();
+    if (inf.isInTag && inf.currentTagList.size() == 1) {
+        emit requestTaskBoardInTag(*inf.currentTagList.constBegin());
+    } else if (!inf.isInTag && inf.parentFolderId != ROOT_FOLDER_ID && inf.parentFolderId != TRASH_FOLDER_ID) {
+        emit requestTaskBoardInFolder(inf.parentFolderId);
+    } else {
+        emit requestTaskBoard();
+    }
+}
+
+/*!
+ * \brief MainWindow::onTaskBoardReceived
+ * List open tasks under the title of their note
+ * \param tasks
+ */
+void MainWindow::onTaskBoardReceived(const QVector<NoteTask> &tasks)
+{
+    QMessageBox msgBox(this);
+    msgBox.setWindowTitle(tr("Open Tasks"));
+    if (tasks.isEmpty()) {
+        msgBox.setText(tr("No open tasks."));
+        msgBox.exec();
+        return;
+    }
+    QString taskList;
+    int noteId = INVALID_NODE_ID;
+    for (const auto &task : tasks) {
+        if (task.noteId != noteId) {
+            noteId = task.noteId;
+            if (!taskList.isEmpty()) {
+                taskList += QStringLiteral("\n");
+            }
+            taskList += task.noteTitle + QStringLiteral("\n");
+        }
+        taskList += QStringLiteral("  - [ ] %1\n").arg(task.text);
+    }
+    msgBox.setText(tr("%n open task(s).", nullptr, tasks.size()));
+    msgBox.setDetailedText(taskList);
+    msgBox.exec();
+}
+
+/*!
+ * \brief MainWindow::scheduleBackups
+ * Ask how often to back up the notes, where, and how many backups to keep
+ */
+void MainWindow::scheduleBackups()
+{
+    bool ok = false;
+    int intervalHours = QInputDialog::getInt(this, tr("Schedule Backups"), tr("Back up notes every (hours, 0 to stop):"),
+                                             m_settingsDatabase->value(QStringLiteral("backupIntervalHours"), 24).toInt(), 0, 24 * 7, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    QString directoryPath = m_settingsDatabase->value(QStringLiteral("backupDirectory")).toString();
+    int keptBackupCount = m_settingsDatabase->value(QStringLiteral("keptBackupCount"), DEFAULT_KEPT_BACKUP_COUNT).toInt();
+    if (intervalHours > 0) {
+        directoryPath = QFileDialog::getExistingDirectory(this, tr("Select Backup Directory"), directoryPath.isEmpty() ? QDir::homePath() : directoryPath,
+                                                          QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+        if (directoryPath.isEmpty()) {
+            return;
+        }
+        keptBackupCount = QInputDialog::getInt(this, tr("Schedule Backups"), tr("Number of backups to keep:"), keptBackupCount, 1, 1000, 1, &ok);
+        if (!ok) {
+            return;
+        }
+    }
+    m_settingsDatabase->setValue(QStringLiteral("backupIntervalHours"), intervalHours);
+    m_settingsDatabase->setValue(QStringLiteral("backupDirectory"), directoryPath);
+    m_settingsDatabase->setValue(QStringLiteral("keptBackupCount"), keptBackupCount);
+    emit requestBackupSchedule(directoryPath, intervalHours, keptBackupCount);
+}
+
+/*!
+ * \brief MainWindow::importPlainTextFiles
+ * Import the selected text files in the background
+ */
 void MainWindow::importPlainTextFiles()
 {
-    QList<QPair<QString, QDateTime>> fileDatas;
+    QStringList files;
     QFileDialog dialog(this);
 
     // Set filters and options
@@ -2704,42 +2929,107 @@ void MainWindow::importPlainTextFiles()
 
     // Open the dialog and check if user has selected files
     if (dialog.exec() != 0) {
-        // Get list of selected files
-        QStringList files = dialog.selectedFiles();
-
-        // Loop over the files and read their content
-        for (const QString &fileName : files) {
-            QFile file(fileName);
+        files = dialog.selectedFiles();
+    }
 
-            // Open the file and check for errors
-            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                QMessageBox::warning(this, "File error", "Can't open file " + fileName);
-                continue;
-            }
+    if (files.isEmpty()) {
+        QMessageBox msgBox;
+        msgBox.setText("No files selected. Please select one or more files to import.");
+        msgBox.exec();
+        return;
+    }
 
-            // Read the file content
-            QTextStream in(&file);
-            QString fileContent = in.readAll();
+    showImportProgress();
+    emit requestImportPlainTextFiles(files);
+}
 
-            QFileInfo fileInfo(file);
-            QDateTime lastModified = fileInfo.lastModified();
+/*!
+ * \brief MainWindow::importPlainTextDirectory
+ * Import the text files of a directory and its subdirectories in the
+ * background, as a folder tree with the same structure
+ */
+void MainWindow::importPlainTextDirectory()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Select Directory to Import"), QDir::homePath(),
+                                                    QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+    if (dir.isEmpty()) {
+        return;
+    }
 
-            fileDatas.append(qMakePair(fileContent, lastModified));
+    showImportProgress();
+    emit requestImportPlainTextDirectory(dir);
+}
 
-            // Close the file
-            file.close();
-        }
+/*!
+ * \brief MainWindow::importNotesFromArchive
+ * Import the notes of a .zip archive in the background
+ */
+void MainWindow::importNotesFromArchive()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Import Notes"), QDir::homePath(), tr("Notes Archive (*.zip)"));
+    if (fileName.isEmpty()) {
+        return;
     }
 
-    QMessageBox msgBox;
-    if (!fileDatas.isEmpty()) {
-        m_dbManager->addNotesToNewImportedFolder(fileDatas);
-        msgBox.setText("Notes imported successfully!");
-        msgBox.exec();
-    } else {
-        msgBox.setText("No files selected. Please select one or more files to import.");
-        msgBox.exec();
+    showImportProgress();
+    emit requestImportArchive(fileName);
+}
+
+/*!
+ * \brief MainWindow::exportNotesToArchive
+ * Export all notes to a single .zip archive in the background
+ */
+void MainWindow::exportNotesToArchive()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Notes"), "notes.zip", tr("Notes Archive (*.zip)"));
+    if (fileName.isEmpty()) {
+        return;
     }
+
+    showExportProgress();
+    emit requestExportArchive(fileName);
+}
+
+/*!
+ * \brief MainWindow::showImportProgress
+ * Show the progress of the import the DB thread is about to run, which can
+ * be canceled from the progress dialog
+ */
+void MainWindow::showImportProgress()
+{
+    auto *pd = new QProgressDialog(tr("Importing notes, please wait."), tr("Cancel"), 0, 0, this);
+    pd->setWindowModality(Qt::WindowModal);
+    pd->setMinimumDuration(0);
+    pd->setAutoReset(false);
+    pd->setAutoClose(false);
+    pd->setValue(0);
+    setButtonsAndFieldsEnabled(false);
+
+    connect(pd, &QProgressDialog::canceled, this, [this]() { m_dbManager->cancelImport(); });
+    connect(m_dbManager, &DBManager::importProgressChanged, pd, [pd](int processedCount, int totalCount) {
+        pd->setMaximum(totalCount);
+        pd->setValue(processedCount);
+    });
+    connect(m_dbManager, &DBManager::importFinished, pd,
+            [this, pd](int importedCount, int skippedCount, const QStringList &failedFileNames, bool isCanceled) {
+                pd->deleteLater();
+                setButtonsAndFieldsEnabled(true);
+                if (!failedFileNames.isEmpty()) {
+                    QMessageBox::warning(this, "File error", "Can't open file " + failedFileNames.join(QStringLiteral("\n")));
+                }
+                QMessageBox msgBox;
+                if (isCanceled) {
+                    msgBox.setText(tr("Import canceled, %n note(s) imported.", nullptr, importedCount));
+                } else if (importedCount == 0) {
+                    msgBox.setText(tr("No new notes to import."));
+                } else {
+                    msgBox.setText("Notes imported successfully!");
+                }
+                if (skippedCount > 0) {
+                    msgBox.setInformativeText(tr("%n file(s) already imported and unchanged were skipped.", nullptr, skippedCount));
+                }
+                msgBox.exec();
+            });
 }
 
 void MainWindow::exportToPlainTextFiles(const QString &extension)
@@ -2751,11 +3041,62 @@ void MainWindow::exportToPlainTextFiles(const QString &extension)
         return;
     }
 
-    m_dbManager->exportNotes(dir, extension);
+    showExportProgress();
+    emit requestExportPlainTextFiles(dir, extension);
+}
 
-    QMessageBox msgBox;
-    msgBox.setText("Notes exported successfully!");
-    msgBox.exec();
+/*!
+ * \brief MainWindow::exportToPlainTextDirectory
+ * Bring the .md files of a directory up to date with the notes, writing
+ * only the notes that changed since the directory was last synced
+ */
+void MainWindow::exportToPlainTextDirectory()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Select Directory to Sync"), QDir::homePath(),
+                                                    QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+    if (dir.isEmpty()) {
+        return;
+    }
+
+    showExportProgress();
+    emit requestIncrementalExport(dir, QStringLiteral(".md"));
+}
+
+/*!
+ * \brief MainWindow::showExportProgress
+ * Show the progress of the export the DB thread is about to run, which can
+ * be canceled from the progress dialog
+ */
+void MainWindow::showExportProgress()
+{
+    auto *pd = new QProgressDialog(tr("Exporting notes, please wait."), tr("Cancel"), 0, 0, this);
+    pd->setWindowModality(Qt::WindowModal);
+    pd->setMinimumDuration(0);
+    pd->setAutoReset(false);
+    pd->setAutoClose(false);
+    pd->setValue(0);
+    setButtonsAndFieldsEnabled(false);
+
+    connect(pd, &QProgressDialog::canceled, this, [this]() { m_dbManager->cancelExport(); });
+    connect(m_dbManager, &DBManager::exportProgressChanged, pd, [pd](int processedCount, int totalCount) {
+        pd->setMaximum(totalCount);
+        pd->setValue(processedCount);
+    });
+    connect(m_dbManager, &DBManager::exportFinished, pd,
+            [this, pd](int exportedCount, const QStringList &failedFilePaths, bool isCanceled) {
+                pd->deleteLater();
+                setButtonsAndFieldsEnabled(true);
+                if (!failedFilePaths.isEmpty()) {
+                    QMessageBox::warning(this, "File error", "Can't write file " + failedFilePaths.join(QStringLiteral("\n")));
+                }
+                QMessageBox msgBox;
+                if (isCanceled) {
+                    msgBox.setText(tr("Export canceled, %n note(s) exported.", nullptr, exportedCount));
+                } else {
+                    msgBox.setText("Notes exported successfully!");
+                }
+                msgBox.exec();
+            });
 }
 
 void MainWindow::toggleFolderTree()
@@ -4015,13 +4356,7 @@ void MainWindow::onSearchEditReturnPressed()
     if (m_searchEdit->text().isEmpty())
         return;
 
-    QString searchText = m_searchEdit->text();
-    QTextDocument *doc = m_textEdit->document();
-    // get current cursor
-    QTextCursor from = m_textEdit->textCursor();
-    // search
-    QTextCursor found = doc->find(searchText, from);
-    m_textEdit->setTextCursor(found);
+    m_noteEditorLogic->findNextSearchMatch();
 }
 
 /*!
@@ -62,6 +62,7 @@ class MainWindow;
 class TreeViewLogic;
 class ListViewLogic;
 class NoteEditorLogic;
+class KanbanColumnModel;
 class TagPool;
 class SplitterStyle;
 
@@ -170,6 +171,7 @@ private:
     TreeViewLogic *m_treeViewLogic;
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
     QQuickWidget *m_kanbanWidget;
+    KanbanColumnModel *m_kanbanColumnModel;
 #endif
     QQuickView m_editorSettingsQuickView;
     QWidget *m_editorSettingsWidget;
@@ -281,6 +283,8 @@ private:
     void initializeSettingsDatabase();
     void setLayoutForScrollArea();
     void setButtonsAndFieldsEnabled(bool doEnable);
+    void showImportProgress();
+    void showExportProgress();
     void resetFormat(const QString &formatChars);
     void restoreStates();
     void migrateFromV0_9_0();
@@ -337,8 +341,17 @@ private slots:
     void toggleFolderTree();
     void importNotesFile();
     void exportNotesFile();
+    void scheduleBackups();
+    void showNoteHistory();
+    void onNoteRevisionsReceived(int noteId, const QVector<NoteRevision> &revisions);
+    void showOpenTasks();
+    void onTaskBoardReceived(const QVector<NoteTask> &tasks);
     void importPlainTextFiles();
+    void importPlainTextDirectory();
+    void importNotesFromArchive();
+    void exportNotesToArchive();
     void exportToPlainTextFiles(const QString &extension);
+    void exportToPlainTextDirectory();
     void restoreNotesFile();
     void increaseHeading();
     void decreaseHeading();
@@ -361,7 +374,20 @@ signals:
     void requestOpenDBManager(const QString &path, bool doCreate);
     void requestRestoreNotes(const QString &filePath);
     void requestImportNotes(const QString &filePath);
+    void requestImportPlainTextFiles(const QStringList &filePaths);
+    void requestImportPlainTextDirectory(const QString &directoryPath);
+    void requestExportPlainTextFiles(const QString &directoryPath, const QString &extension);
+    void requestIncrementalExport(const QString &directoryPath, const QString &extension);
+    void requestImportArchive(const QString &fileName);
+    void requestExportArchive(const QString &fileName);
     void requestExportNotes(QString fileName);
+    void requestBackupSchedule(const QString &directoryPath, int intervalHours, int keptBackupCount);
+    void requestSetContentCompression(bool isEnabled);
+    void requestNoteRevisions(int noteId);
+    void requestRestoreNoteRevision(int revisionId);
+    void requestTaskBoard();
+    void requestTaskBoardInFolder(int folderId);
+    void requestTaskBoardInTag(int tagId);
     void requestMigrateNotesFromV0_9_0(QVector<NodeData> &noteList);
     void requestMigrateTrashFromV0_9_0(QVector<NodeData> &noteList);
     void requestMigrateNotesFromV1_5_0(const QString &path);
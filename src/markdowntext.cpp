@@ -0,0 +1,406 @@
+#include "markdowntext.h"
+#include <QPair>
+
+namespace {
+struct DelimiterRun
+{
+    int outputPosition;
+    QChar character;
+    int length;
+    int remaining;
+    bool canOpen;
+    bool canClose;
+};
+
+bool isAsciiPunctuation(QChar c)
+{
+    auto u = c.unicode();
+    return (u >= '!' && u <= '/') || (u >= ':' && u <= '@') || (u >= '[' && u <= '`') || (u >= '{' && u <= '~');
+}
+
+bool isPunctuation(QChar c)
+{
+    return isAsciiPunctuation(c) || c.isPunct() || c.isSymbol();
+}
+
+bool isAsciiDigit(QChar c)
+{
+    return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+bool isBlank(QChar c)
+{
+    return c == u' ' || c == u'\t';
+}
+
+bool isThematicBreak(QStringView line)
+{
+    if (line.isEmpty()) {
+        return false;
+    }
+    auto marker = line.front();
+    if (marker != u'-' && marker != u'*' && marker != u'_') {
+        return false;
+    }
+    int count = 0;
+    for (auto c : line) {
+        if (c == marker) {
+            ++count;
+        } else if (!isBlank(c)) {
+            return false;
+        }
+    }
+    return count >= 3;
+}
+
+/*!
+ * Strip the block level markers a single line can start with: block quotes,
+ * ATX headings, list items and task list check boxes
+ */
+QStringView stripBlockPrefix(QStringView line)
+{
+    bool isStripped = true;
+    while (isStripped) {
+        isStripped = false;
+        line = line.trimmed();
+        if (line.isEmpty() || isThematicBreak(line)) {
+            return {};
+        }
+        if (line.front() == u'>') {
+            line = line.mid(1);
+            isStripped = true;
+            continue;
+        }
+        int hashes = 0;
+        while (hashes < line.size() && line[hashes] == u'#') {
+            ++hashes;
+        }
+        if (hashes >= 1 && hashes <= 6 && (hashes == line.size() || isBlank(line[hashes]))) {
+            line = line.mid(hashes).trimmed();
+            // optional closing sequence
+            int end = line.size();
+            while (end > 0 && line[end - 1] == u'#') {
+                --end;
+            }
+            if (end == 0) {
+                return {};
+            }
+            if (end < line.size() && isBlank(line[end - 1])) {
+                line = line.left(end).trimmed();
+            }
+            return line;
+        }
+        if ((line.front() == u'-' || line.front() == u'*' || line.front() == u'+') && (line.size() == 1 || isBlank(line[1]))) {
+            line = line.mid(1);
+            isStripped = true;
+        } else {
+            int digits = 0;
+            while (digits < line.size() && digits < 9 && isAsciiDigit(line[digits])) {
+                ++digits;
+            }
+            if (digits > 0 && digits < line.size() && (line[digits] == u'.' || line[digits] == u')')
+                && (digits + 1 == line.size() || isBlank(line[digits + 1]))) {
+                line = line.mid(digits + 1);
+                isStripped = true;
+            }
+        }
+        if (isStripped) {
+            auto item = line.trimmed();
+            if (item.size() >= 3 && item[0] == u'[' && item[2] == u']' && (item[1] == u' ' || item[1] == u'x' || item[1] == u'X')
+                && (item.size() == 3 || isBlank(item[3]))) {
+                line = item.mid(3);
+            }
+        }
+    }
+    return line;
+}
+
+/*!
+ * Index right after the ')' closing the inline link or image whose text
+ * starts with the '[' at openBracket, or -1 if it isn't one
+ */
+int findLinkEnd(QStringView s, int openBracket, int *closeBracket)
+{
+    int depth = 0;
+    int i = openBracket + 1;
+    for (; i < s.size(); ++i) {
+        if (s[i] == u'\\') {
+            ++i;
+        } else if (s[i] == u'[') {
+            ++depth;
+        } else if (s[i] == u']') {
+            if (depth == 0) {
+                break;
+            }
+            --depth;
+        }
+    }
+    if (i + 1 >= s.size() || s[i + 1] != u'(') {
+        return -1;
+    }
+    *closeBracket = i;
+    depth = 0;
+    for (i += 2; i < s.size(); ++i) {
+        if (s[i] == u'\\') {
+            ++i;
+        } else if (s[i] == u'(') {
+            ++depth;
+        } else if (s[i] == u')') {
+            if (depth == 0) {
+                return i + 1;
+            }
+            --depth;
+        }
+    }
+    return -1;
+}
+
+int decodeEntity(QStringView s, int ampersand, QString &out)
+{
+    int semicolon = s.indexOf(u';', ampersand + 1);
+    if (semicolon == -1 || semicolon - ampersand > 10) {
+        return -1;
+    }
+    auto name = s.mid(ampersand + 1, semicolon - ampersand - 1);
+    if (name == u"amp") {
+        out += u'&';
+    } else if (name == u"lt") {
+        out += u'<';
+    } else if (name == u"gt") {
+        out += u'>';
+    } else if (name == u"quot") {
+        out += u'"';
+    } else if (name == u"apos") {
+        out += u'\'';
+    } else if (name == u"nbsp") {
+        out += u' ';
+    } else if (name.size() > 1 && name.front() == u'#') {
+        bool ok = false;
+        uint code = (name[1] == u'x' || name[1] == u'X') ? name.mid(2).toUInt(&ok, 16) : name.mid(1).toUInt(&ok, 10);
+        if (!ok || code == 0 || code > 0x10FFFF) {
+            return -1;
+        }
+        auto codePoint = static_cast<char32_t>(code);
+        out += QString::fromUcs4(&codePoint, 1);
+    } else {
+        return -1;
+    }
+    return semicolon + 1;
+}
+} // namespace
+
+QString MarkdownText::inlineToPlainText(QStringView line)
+{
+    line = stripBlockPrefix(line);
+    QString out;
+    out.reserve(line.size());
+    QVector<DelimiterRun> runs;
+    QVector<QPair<int, int>> openLinks;
+
+    int i = 0;
+    while (i < line.size()) {
+        if (!openLinks.isEmpty() && openLinks.last().first == i) {
+            // skip the destination of a link or an image
+            i = openLinks.takeLast().second;
+            continue;
+        }
+        auto c = line[i];
+        if (c == u'\\' && i + 1 < line.size() && isAsciiPunctuation(line[i + 1])) {
+            out += line[i + 1];
+            i += 2;
+        } else if (c == u'`') {
+            int n = 0;
+            while (i + n < line.size() && line[i + n] == u'`') {
+                ++n;
+            }
+            int close = i + n;
+            while (true) {
+                close = line.indexOf(u'`', close);
+                if (close == -1) {
+                    break;
+                }
+                int m = 0;
+                while (close + m < line.size() && line[close + m] == u'`') {
+                    ++m;
+                }
+                if (m == n) {
+                    break;
+                }
+                close += m;
+            }
+            if (close == -1) {
+                out += line.mid(i, n);
+                i += n;
+            } else {
+                auto code = line.mid(i + n, close - i - n);
+                if (code.size() > 1 && code.front() == u' ' && code.back() == u' ' && !code.trimmed().isEmpty()) {
+                    code = code.mid(1, code.size() - 2);
+                }
+                out += code;
+                i = close + n;
+            }
+        } else if (c == u'[' || (c == u'!' && i + 1 < line.size() && line[i + 1] == u'[')) {
+            // images keep their alt text where QTextDocument would insert an object
+            int openBracket = c == u'!' ? i + 1 : i;
+            int closeBracket = -1;
+            int end = findLinkEnd(line, openBracket, &closeBracket);
+            if (end == -1) {
+                out += c;
+                ++i;
+            } else {
+                openLinks.append(qMakePair(closeBracket, end));
+                i = openBracket + 1;
+            }
+        } else if (c == u'<') {
+            int close = line.indexOf(u'>', i + 1);
+            auto inner = close == -1 ? QStringView() : line.mid(i + 1, close - i - 1);
+            bool hasSpace = inner.contains(u' ');
+            if (!inner.isEmpty() && !hasSpace && (inner.contains(u':') || inner.contains(u'@'))) {
+                out += inner;
+                i = close + 1;
+            } else if (!inner.isEmpty() && !inner.contains(u'<')
+                       && (inner.front().isLetter() || inner.front() == u'/' || inner.front() == u'!' || inner.front() == u'?')) {
+                // inline html tag
+                i = close + 1;
+            } else {
+                out += c;
+                ++i;
+            }
+        } else if (c == u'&') {
+            int end = decodeEntity(line, i, out);
+            if (end == -1) {
+                out += c;
+                ++i;
+            } else {
+                i = end;
+            }
+        } else if (c == u'*' || c == u'_' || c == u'~') {
+            int n = 0;
+            while (i + n < line.size() && line[i + n] == c) {
+                ++n;
+            }
+            QChar prev = i > 0 ? line[i - 1] : QChar(u' ');
+            QChar next = i + n < line.size() ? line[i + n] : QChar(u' ');
+            bool isLeftFlanking = !next.isSpace() && (!isPunctuation(next) || prev.isSpace() || isPunctuation(prev));
+            bool isRightFlanking = !prev.isSpace() && (!isPunctuation(prev) || next.isSpace() || isPunctuation(next));
+            DelimiterRun run{ static_cast<int>(out.size()), c, n, n, isLeftFlanking, isRightFlanking };
+            if (c == u'_') {
+                run.canOpen = isLeftFlanking && (!isRightFlanking || isPunctuation(prev));
+                run.canClose = isRightFlanking && (!isLeftFlanking || isPunctuation(next));
+            } else if (c == u'~' && n > 2) {
+                run.canOpen = false;
+                run.canClose = false;
+            }
+            runs.append(run);
+            out += line.mid(i, n);
+            i += n;
+        } else {
+            out += c;
+            ++i;
+        }
+    }
+
+    if (runs.isEmpty()) {
+        return out.trimmed();
+    }
+
+    // pair emphasis delimiters, closers look back for the nearest usable opener
+    for (int closerIndex = 0; closerIndex < runs.size(); ++closerIndex) {
+        auto &closer = runs[closerIndex];
+        if (!closer.canClose) {
+            continue;
+        }
+        while (closer.remaining > 0) {
+            int openerIndex = closerIndex - 1;
+            for (; openerIndex >= 0; --openerIndex) {
+                auto const &opener = runs[openerIndex];
+                if (opener.character != closer.character || !opener.canOpen || opener.remaining == 0) {
+                    continue;
+                }
+                if (closer.character == u'~' && opener.remaining != closer.remaining) {
+                    continue;
+                }
+                if ((opener.canClose || closer.canOpen) && (opener.length + closer.length) % 3 == 0
+                    && !(opener.length % 3 == 0 && closer.length % 3 == 0)) {
+                    continue;
+                }
+                break;
+            }
+            if (openerIndex < 0) {
+                break;
+            }
+            auto &opener = runs[openerIndex];
+            int used = closer.character == u'~' ? closer.remaining : ((opener.remaining >= 2 && closer.remaining >= 2) ? 2 : 1);
+            opener.remaining -= used;
+            closer.remaining -= used;
+            for (int k = openerIndex + 1; k < closerIndex; ++k) {
+                runs[k].canOpen = false;
+            }
+        }
+    }
+
+    QString result;
+    result.reserve(out.size());
+    int from = 0;
+    for (const auto &run : std::as_const(runs)) {
+        result += QStringView(out).mid(from, run.outputPosition - from);
+        for (int k = 0; k < run.remaining; ++k) {
+            result += run.character;
+        }
+        from = run.outputPosition + run.length;
+    }
+    result += QStringView(out).mid(from);
+    return result.trimmed();
+}
+
+int MarkdownText::findTaskMarker(QStringView line, int *markerSize, bool *isChecked)
+{
+    static const QStringView taskExpressions[] = { u"- [ ]", u"- [x]", u"* [ ]", u"* [x]", u"- [X]", u"* [X]" };
+    for (auto taskExpression : taskExpressions) {
+        int index = line.indexOf(taskExpression);
+        if (index != -1) {
+            if (markerSize != nullptr) {
+                *markerSize = taskExpression.size();
+            }
+            if (isChecked != nullptr) {
+                *isChecked = taskExpression[3] == u'x';
+            }
+            return index;
+        }
+    }
+    return -1;
+}
+
+QVector<MarkdownTask> MarkdownText::tasks(QStringView content)
+{
+    QVector<MarkdownTask> result;
+    QString currentColumn;
+    bool isPreviousLineATask = false;
+    int lineNumber = 0;
+    for (auto line : content.split(u'\n')) {
+        auto lineTrimmed = line.trimmed();
+        if (lineTrimmed.startsWith(u'#')) {
+            currentColumn = lineTrimmed.mid(lineTrimmed.count(u'#')).toString();
+            isPreviousLineATask = false;
+            ++lineNumber;
+            continue;
+        }
+        int markerSize = 0;
+        bool isChecked = false;
+        int markerIndex = findTaskMarker(line, &markerSize, &isChecked);
+        if (markerIndex == -1 && lineTrimmed.endsWith(u"::")) {
+            currentColumn = line.left(line.indexOf(u"::")).trimmed().toString();
+            isPreviousLineATask = false;
+        } else if (markerIndex != -1) {
+            result.append({ lineNumber, currentColumn, isChecked, line.mid(markerIndex + markerSize).trimmed().toString() });
+            isPreviousLineATask = true;
+        } else if (line.isEmpty()) {
+            isPreviousLineATask = false;
+        } else if (isPreviousLineATask) {
+            auto &lastTask = result.last();
+            lastTask.text = QStringLiteral("%1  \n%2").arg(lastTask.text, lineTrimmed.toString());
+        }
+        ++lineNumber;
+    }
+    return result;
+}
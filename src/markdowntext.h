@@ -0,0 +1,47 @@
+#ifndef MARKDOWNTEXT_H
+#define MARKDOWNTEXT_H
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+struct MarkdownTask
+{
+    int line;
+    QString column;
+    bool isChecked;
+    QString text;
+};
+
+namespace MarkdownText {
+/*!
+ * \brief inlineToPlainText
+ * Plain text of a single line of Markdown, close to what
+ * QTextDocument::setMarkdown() followed by toPlainText() gives for it,
+ * without building a document. Used for note titles, previews and file names.
+ * \param line
+ */
+QString inlineToPlainText(QStringView line);
+
+/*!
+ * \brief findTaskMarker
+ * Position of the "- [ ]" or "- [x]" (or '*' bullet) marker of a task line,
+ * or -1 if the line isn't one. Only a lowercase x counts as checked, the way
+ * the kanban view reads them.
+ * \param line
+ * \param markerSize
+ * \param isChecked
+ */
+int findTaskMarker(QStringView line, int *markerSize = nullptr, bool *isChecked = nullptr);
+
+/*!
+ * \brief tasks
+ * All tasks of a note, each with the title of the column it's under: the
+ * closest header, or line ending with "::", above it. Lines following a task
+ * are part of its text until an empty line or a header.
+ * \param content
+ */
+QVector<MarkdownTask> tasks(QStringView content);
+} // namespace MarkdownText
+
+#endif // MARKDOWNTEXT_H
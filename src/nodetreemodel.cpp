@@ -7,7 +7,10 @@ namespace {
 auto constexpr COLUMN_COUNT = 1;
 }
 
-NodeTreeItem::NodeTreeItem(const QHash<NodeItem::Roles, QVariant> &data, NodeTreeItem *parentItem) : m_itemData(data), m_parentItem(parentItem) { }
+NodeTreeItem::NodeTreeItem(NodeItem::Type type, NodeTreeItem *parentItem)
+    : m_parentItem(parentItem), m_type(type), m_id(INVALID_NODE_ID), m_relativePosition(0), m_childNotesCount(0)
+{
+}
 
 NodeTreeItem::~NodeTreeItem()
 {
@@ -69,15 +72,10 @@ int NodeTreeItem::recursiveNodeCount() const
 
 void NodeTreeItem::recursiveUpdateFolderPath(const QString &oldP, const QString &newP)
 {
-    {
-        auto type = static_cast<NodeItem::Type>(getData(NodeItem::Roles::ItemType).toInt());
-        if (type != NodeItem::Type::FolderItem) {
-            return;
-        }
-        auto currP = getData(NodeItem::Roles::AbsPath).toString();
-        currP.replace(currP.indexOf(oldP), oldP.size(), newP);
-        setData(NodeItem::Roles::AbsPath, currP);
+    if (m_type != NodeItem::Type::FolderItem) {
+        return;
     }
+    m_absolutePath.replace(m_absolutePath.indexOf(oldP), oldP.size(), newP);
     for (auto &child : m_childItems) {
         child->recursiveUpdateFolderPath(oldP, newP);
     }
@@ -85,12 +83,79 @@ void NodeTreeItem::recursiveUpdateFolderPath(const QString &oldP, const QString
 
 QVariant NodeTreeItem::getData(NodeItem::Roles role) const
 {
-    return m_itemData.value(role, QVariant());
+    switch (role) {
+    case NodeItem::Roles::ItemType:
+        return static_cast<int>(m_type);
+    case NodeItem::Roles::DisplayText:
+        return m_displayText;
+    case NodeItem::Roles::Icon:
+        return m_icon.isNull() ? QVariant() : m_icon;
+    case NodeItem::Roles::TagColor:
+        return m_tagColor.isNull() ? QVariant() : m_tagColor;
+    case NodeItem::Roles::AbsPath:
+        return m_absolutePath.isNull() ? QVariant() : m_absolutePath;
+    case NodeItem::Roles::RelPos:
+        return m_relativePosition;
+    case NodeItem::Roles::ChildCount:
+        return m_childNotesCount;
+    case NodeItem::Roles::NodeId:
+        return m_id == INVALID_NODE_ID ? QVariant() : m_id;
+    default:
+        return {};
+    }
 }
 
 void NodeTreeItem::setData(NodeItem::Roles role, const QVariant &d)
 {
-    m_itemData[role] = d;
+    switch (role) {
+    case NodeItem::Roles::ItemType:
+        m_type = static_cast<NodeItem::Type>(d.toInt());
+        break;
+    case NodeItem::Roles::DisplayText:
+        m_displayText = d.toString();
+        break;
+    case NodeItem::Roles::Icon:
+        m_icon = d.toString();
+        break;
+    case NodeItem::Roles::TagColor:
+        m_tagColor = d.toString();
+        break;
+    case NodeItem::Roles::AbsPath:
+        m_absolutePath = d.toString();
+        break;
+    case NodeItem::Roles::RelPos:
+        m_relativePosition = d.toInt();
+        break;
+    case NodeItem::Roles::ChildCount:
+        m_childNotesCount = d.toInt();
+        break;
+    case NodeItem::Roles::NodeId:
+        m_id = d.toInt();
+        break;
+    default:
+        qDebug() << __FUNCTION__ << "Unsupported role" << static_cast<int>(role);
+        break;
+    }
+}
+
+NodeItem::Type NodeTreeItem::type() const
+{
+    return m_type;
+}
+
+int NodeTreeItem::id() const
+{
+    return m_id;
+}
+
+int NodeTreeItem::relativePosition() const
+{
+    return m_relativePosition;
+}
+
+const QString &NodeTreeItem::absolutePath() const
+{
+    return m_absolutePath;
 }
 
 NodeTreeItem *NodeTreeItem::getParentItem() const
@@ -110,16 +175,13 @@ void NodeTreeItem::moveChild(int from, int to)
 
 void NodeTreeItem::recursiveSort()
 {
-    auto type = static_cast<NodeItem::Type>(getData(NodeItem::Roles::ItemType).toInt());
-    auto relPosComparator = [](const NodeTreeItem *a, const NodeTreeItem *b) {
-        return a->getData(NodeItem::Roles::RelPos).toInt() < b->getData(NodeItem::Roles::RelPos).toInt();
-    };
-    if (type == NodeItem::Type::FolderItem) {
+    auto relPosComparator = [](const NodeTreeItem *a, const NodeTreeItem *b) { return a->relativePosition() < b->relativePosition(); };
+    if (m_type == NodeItem::Type::FolderItem) {
         std::sort(m_childItems.begin(), m_childItems.end(), relPosComparator);
         for (auto &child : m_childItems) {
             child->recursiveSort();
         }
-    } else if (type == NodeItem::Type::RootItem) {
+    } else if (m_type == NodeItem::Type::RootItem) {
         QVector<NodeTreeItem *> allNoteButton;
         QVector<NodeTreeItem *> trashFolder;
         QVector<NodeTreeItem *> folderSep;
@@ -127,7 +189,7 @@ void NodeTreeItem::recursiveSort()
         QVector<NodeTreeItem *> tagSep;
         QVector<NodeTreeItem *> tagItems;
         for (auto *const child : std::as_const(m_childItems)) {
-            auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+            auto childType = child->type();
             if (childType == NodeItem::Type::AllNoteButton) {
                 allNoteButton.append(child);
             } else if (childType == NodeItem::Type::TrashButton) {
@@ -168,11 +230,12 @@ int NodeTreeItem::getRow() const
     return 0;
 }
 
-NodeTreeModel::NodeTreeModel(QObject *parent) : QAbstractItemModel(parent), m_rootItem(nullptr)
+NodeTreeModel::NodeTreeModel(QObject *parent)
+    : QAbstractItemModel(parent), m_rootItem(nullptr), m_allNotesButtonItem(nullptr), m_trashButtonItem(nullptr)
 {
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::RootItem;
-    m_rootItem = new NodeTreeItem(hs);
+    m_rootItem = new NodeTreeItem(NodeItem::Type::RootItem);
+    m_rootItem->setData(NodeItem::Roles::NodeId, ROOT_FOLDER_ID);
+    registerItem(m_rootItem);
 }
 
 NodeTreeModel::~NodeTreeModel()
@@ -191,15 +254,15 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
                 int row = 0;
                 for (int i = 0; i < parentItem->getChildCount(); ++i) {
                     auto const *childItem = parentItem->getChild(i);
-                    auto childType = static_cast<NodeItem::Type>(childItem->getData(NodeItem::Roles::ItemType).toInt());
-                    if (childType == NodeItem::Type::FolderItem && childItem->getData(NodeItem::Roles::NodeId).toInt() == DEFAULT_NOTES_FOLDER_ID) {
+                    if (childItem->type() == NodeItem::Type::FolderItem && childItem->id() == DEFAULT_NOTES_FOLDER_ID) {
                         row = i + 1;
                         break;
                     }
                 }
                 emit layoutAboutToBeChanged();
                 beginInsertRows(parentIndex, row, row);
-                auto *nodeItem = new NodeTreeItem(data, parentItem);
+                auto *nodeItem = new NodeTreeItem(type, parentItem);
+                applyItemData(nodeItem, data);
                 parentItem->insertChild(row, nodeItem);
                 endInsertRows();
                 emit layoutChanged();
@@ -207,7 +270,8 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
                 updateChildRelativePosition(parentItem, NodeItem::Type::FolderItem);
             } else {
                 beginInsertRows(parentIndex, 0, 0);
-                auto *nodeItem = new NodeTreeItem(data, parentItem);
+                auto *nodeItem = new NodeTreeItem(type, parentItem);
+                applyItemData(nodeItem, data);
                 parentItem->insertChild(0, nodeItem);
                 endInsertRows();
                 updateChildRelativePosition(parentItem, NodeItem::Type::FolderItem);
@@ -221,16 +285,15 @@ void NodeTreeModel::appendChildNodeToParent(const QModelIndex &parentIndex, cons
             }
             int row = 0;
             for (int i = 0; i < parentItem->getChildCount(); ++i) {
-                auto const *childItem = parentItem->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(childItem->getData(NodeItem::Roles::ItemType).toInt());
-                if (childType == NodeItem::Type::TagSeparator) {
+                if (parentItem->getChild(i)->type() == NodeItem::Type::TagSeparator) {
                     row = i + 1;
                     break;
                 }
             }
             emit layoutAboutToBeChanged();
             beginInsertRows(parentIndex, row, row);
-            auto *nodeItem = new NodeTreeItem(data, parentItem);
+            auto *nodeItem = new NodeTreeItem(type, parentItem);
+            applyItemData(nodeItem, data);
             parentItem->insertChild(row, nodeItem);
             endInsertRows();
             emit layoutChanged();
@@ -292,6 +355,27 @@ int NodeTreeModel::columnCount(const QModelIndex &parent) const
     return m_rootItem->getColumnCount();
 }
 
+bool NodeTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return false;
+    }
+    NodeTreeItem const *parentItem = parent.isValid() ? static_cast<NodeTreeItem *>(parent.internalPointer()) : m_rootItem;
+    return parentItem->getChildCount() > 0 || hasUnfetchedChildren(parentItem);
+}
+
+bool NodeTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    NodeTreeItem const *parentItem = parent.isValid() ? static_cast<NodeTreeItem *>(parent.internalPointer()) : m_rootItem;
+    return hasUnfetchedChildren(parentItem);
+}
+
+void NodeTreeModel::fetchMore(const QModelIndex &parent)
+{
+    auto *parentItem = parent.isValid() ? static_cast<NodeTreeItem *>(parent.internalPointer()) : m_rootItem;
+    fetchChildren(parentItem);
+}
+
 QVariant NodeTreeModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid()) {
@@ -300,9 +384,9 @@ QVariant NodeTreeModel::data(const QModelIndex &index, int role) const
 
     auto const *item = static_cast<NodeTreeItem *>(index.internalPointer());
     if (static_cast<NodeItem::Roles>(role) == NodeItem::Roles::IsExpandable) {
-        return item->getChildCount() > 0;
+        return item->getChildCount() > 0 || hasUnfetchedChildren(item);
     }
-    if (item->getData(NodeItem::Roles::ItemType) == NodeItem::Type::RootItem) {
+    if (item->type() == NodeItem::Type::RootItem) {
         return {};
     }
     return item->getData(static_cast<NodeItem::Roles>(role));
@@ -319,54 +403,60 @@ QModelIndex NodeTreeModel::folderIndexFromIdPath(const NodePath &idPath)
         return {};
     }
     auto ps = idPath.separate();
-    auto const *item = m_rootItem;
-    for (const auto &ite : std::as_const(ps)) {
-        bool ok = false;
-        auto id = ite.toInt(&ok);
+    if (ps.isEmpty()) {
+        return createIndex(m_rootItem->getRow(), 0, m_rootItem);
+    }
+    bool ok = false;
+    auto id = ps.last().toInt(&ok);
+    if (!ok) {
+        qDebug() << __FUNCTION__ << "Can't convert to id" << ps.last();
+        return {};
+    }
+    auto *item = fetchFolder(id);
+    if (item == nullptr) {
+        return {};
+    }
+    // The item is found by its id, but the path must still describe where it currently lives
+    auto const *ancestor = item;
+    for (auto i = ps.size() - 1; i >= 0; --i) {
+        id = ps.at(i).toInt(&ok);
         if (!ok) {
-            qDebug() << __FUNCTION__ << "Can't convert to id" << ite;
+            qDebug() << __FUNCTION__ << "Can't convert to id" << ps.at(i);
             return {};
         }
-        if (id == item->getData(NodeItem::Roles::NodeId).toInt()) {
-            continue;
-        }
-        bool foundChild = false;
-        for (int i = 0; i < item->getChildCount(); ++i) {
-            auto *child = item->getChild(i);
-            if (static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt()) != NodeItem::FolderItem) {
-                continue;
-            }
-            if (id == child->getData(NodeItem::Roles::NodeId).toInt()) {
-                item = child;
-                foundChild = true;
-                break;
-            }
-        }
-        if (!foundChild) {
+        if (ancestor == nullptr || ancestor->id() != id) {
             return {};
         }
+        ancestor = ancestor->getParentItem();
+    }
+    return createIndex(item->getRow(), 0, item);
+}
+
+QModelIndex NodeTreeModel::folderIndexFromId(int id)
+{
+    auto *item = fetchFolder(id);
+    if (item == nullptr) {
+        return {};
     }
     return createIndex(item->getRow(), 0, item);
 }
 
 QModelIndex NodeTreeModel::tagIndexFromId(int id)
 {
-    for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
-        auto *child = m_rootItem->getChild(i);
-        if (static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt()) == NodeItem::Type::TagItem
-            && (static_cast<int>(child->getData(NodeItem::Roles::NodeId).toInt() == id) != 0)) {
-            return createIndex(i, 0, child);
-        }
+    auto *item = m_tagItems.value(id, nullptr);
+    if (item == nullptr) {
+        return {};
     }
-    return {};
+    return createIndex(item->getRow(), 0, item);
 }
 
 QString NodeTreeModel::getNewFolderPlaceholderName(const QModelIndex &parentIndex)
 {
     QString result = "New Folder";
     if (parentIndex.isValid()) {
-        auto const *parentItem = static_cast<NodeTreeItem *>(parentIndex.internalPointer());
+        auto *parentItem = static_cast<NodeTreeItem *>(parentIndex.internalPointer());
         if (parentItem != nullptr) {
+            fetchChildren(parentItem);
             QRegularExpression reg(R"(^New Folder\s\((\d+)\))");
             int n = 0;
             for (int i = 0; i < parentItem->getChildCount(); ++i) {
@@ -425,7 +515,7 @@ QVector<QModelIndex> NodeTreeModel::getSeparatorIndex()
     if (m_rootItem != nullptr) {
         for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
             auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
+            auto type = child->type();
             if (type == NodeItem::Type::FolderSeparator || type == NodeItem::Type::TagSeparator) {
                 result.append(createIndex(i, 0, child));
             }
@@ -436,44 +526,23 @@ QVector<QModelIndex> NodeTreeModel::getSeparatorIndex()
 
 QModelIndex NodeTreeModel::getDefaultNotesIndex()
 {
-    if (m_rootItem != nullptr) {
-        for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
-            auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-            if (type == NodeItem::Type::FolderItem && child->getData(NodeItem::Roles::NodeId).toInt() == DEFAULT_NOTES_FOLDER_ID) {
-                return createIndex(i, 0, child);
-            }
-        }
-    }
-    return QModelIndex{};
+    return folderIndexFromId(DEFAULT_NOTES_FOLDER_ID);
 }
 
 QModelIndex NodeTreeModel::getAllNotesButtonIndex()
 {
-    if (m_rootItem != nullptr) {
-        for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
-            auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-            if (type == NodeItem::Type::AllNoteButton) {
-                return createIndex(i, 0, child);
-            }
-        }
+    if (m_allNotesButtonItem == nullptr) {
+        return QModelIndex{};
     }
-    return QModelIndex{};
+    return createIndex(m_allNotesButtonItem->getRow(), 0, m_allNotesButtonItem);
 }
 
 QModelIndex NodeTreeModel::getTrashButtonIndex()
 {
-    if (m_rootItem != nullptr) {
-        for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
-            auto *child = m_rootItem->getChild(i);
-            auto type = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-            if (type == NodeItem::Type::TrashButton) {
-                return createIndex(i, 0, child);
-            }
-        }
+    if (m_trashButtonItem == nullptr) {
+        return QModelIndex{};
     }
-    return QModelIndex{};
+    return createIndex(m_trashButtonItem->getRow(), 0, m_trashButtonItem);
 }
 
 void NodeTreeModel::deleteRow(const QModelIndex &rowIndex, const QModelIndex &parentIndex)
@@ -485,10 +554,11 @@ void NodeTreeModel::deleteRow(const QModelIndex &rowIndex, const QModelIndex &pa
         return;
     }
     auto *parentItem = static_cast<NodeTreeItem *>(parentIndex.internalPointer());
-    auto const *item = static_cast<NodeTreeItem *>(rowIndex.internalPointer());
+    auto *item = static_cast<NodeTreeItem *>(rowIndex.internalPointer());
     int row = item->getRow();
 
     setData(rowIndex, "deleted", NodeItem::DisplayText);
+    unregisterItem(item);
     if (parentItem == m_rootItem) {
         beginResetModel();
         parentItem->removeChild(row);
@@ -502,13 +572,322 @@ void NodeTreeModel::deleteRow(const QModelIndex &rowIndex, const QModelIndex &pa
     }
 }
 
+void NodeTreeModel::addFolderNode(const NodeData &folder)
+{
+    if (folder.id() == TRASH_FOLDER_ID || folder.parentId() == TRASH_FOLDER_ID || m_folderItems.contains(folder.id())
+        || m_unfetchedNodes.contains(folder.id())) {
+        return;
+    }
+    auto *parentItem = m_folderItems.value(folder.parentId(), nullptr);
+    if ((parentItem == nullptr && m_unfetchedNodes.contains(folder.parentId())) || (parentItem != nullptr && hasUnfetchedChildren(parentItem))) {
+        // siblings aren't loaded yet, it'll be created with them
+        m_unfetchedNodes[folder.id()] = folder;
+        m_unfetchedChildIds[folder.parentId()].append(folder.id());
+        return;
+    }
+    if (parentItem == nullptr) {
+        qDebug() << __FUNCTION__ << "Can't find parent of folder" << folder.id();
+        return;
+    }
+    int row = insertRowForType(parentItem, NodeItem::Type::FolderItem, folder.relativePosition());
+    beginInsertRows(indexFromItem(parentItem), row, row);
+    auto *nodeItem = new NodeTreeItem(NodeItem::Type::FolderItem, parentItem);
+    nodeItem->setData(NodeItem::Roles::DisplayText, folder.fullTitle());
+    nodeItem->setData(NodeItem::Roles::NodeId, folder.id());
+    nodeItem->setData(NodeItem::Roles::AbsPath, folder.absolutePath());
+    nodeItem->setData(NodeItem::Roles::RelPos, folder.relativePosition());
+    nodeItem->setData(NodeItem::Roles::ChildCount, folder.childNotesCount());
+    parentItem->insertChild(row, nodeItem);
+    registerItem(nodeItem);
+    endInsertRows();
+    if (parentItem == m_rootItem) {
+        emit topLevelItemLayoutChanged();
+    }
+}
+
+void NodeTreeModel::moveFolderNode(int folderId, int parentId)
+{
+    if (parentId == TRASH_FOLDER_ID) {
+        removeFolderNode(folderId);
+        return;
+    }
+    auto *item = fetchFolder(folderId);
+    auto *newParent = fetchFolder(parentId);
+    if (item == nullptr || newParent == nullptr || item == m_rootItem) {
+        return;
+    }
+    auto *oldParent = item->getParentItem();
+    if (oldParent == newParent) {
+        return;
+    }
+    int from = item->getRow();
+    int to = insertRowForType(newParent, NodeItem::Type::FolderItem, item->relativePosition());
+    if (!beginMoveRows(indexFromItem(oldParent), from, from, indexFromItem(newParent), to)) {
+        qDebug() << __FUNCTION__ << "Can't move folder" << folderId << "into" << parentId;
+        return;
+    }
+    auto oldAbsolutePath = item->absolutePath();
+    auto newAbsolutePath = (newParent == m_rootItem ? NodePath::getAllNoteFolderPath() : newParent->absolutePath()) + PATH_SEPARATOR
+            + QString::number(folderId);
+    oldParent->takeChildAt(from);
+    item->setParentItem(newParent);
+    item->recursiveUpdateFolderPath(oldAbsolutePath, newAbsolutePath);
+    updateUnfetchedPaths(oldAbsolutePath, newAbsolutePath);
+    newParent->insertChild(to, item);
+    endMoveRows();
+    emit requestUpdateAbsPath(oldAbsolutePath, newAbsolutePath);
+    if (oldParent == m_rootItem || newParent == m_rootItem) {
+        emit topLevelItemLayoutChanged();
+    }
+}
+
+void NodeTreeModel::removeFolderNode(int folderId)
+{
+    if (folderId <= DEFAULT_NOTES_FOLDER_ID) {
+        return;
+    }
+    auto *item = m_folderItems.value(folderId, nullptr);
+    if (item == nullptr) {
+        auto node = m_unfetchedNodes.constFind(folderId);
+        if (node == m_unfetchedNodes.constEnd()) {
+            return;
+        }
+        int parentId = node->parentId();
+        m_unfetchedNodes.erase(node);
+        dropUnfetchedChildren(folderId);
+        auto siblings = m_unfetchedChildIds.find(parentId);
+        if (siblings != m_unfetchedChildIds.end()) {
+            siblings->removeAll(folderId);
+            if (siblings->isEmpty()) {
+                m_unfetchedChildIds.erase(siblings);
+                auto parentIndex = indexFromItem(m_folderItems.value(parentId, nullptr));
+                if (parentIndex.isValid()) {
+                    emit dataChanged(parentIndex, parentIndex, { NodeItem::Roles::IsExpandable });
+                }
+            }
+        }
+        return;
+    }
+    auto *parentItem = item->getParentItem();
+    int row = item->getRow();
+    beginRemoveRows(indexFromItem(parentItem), row, row);
+    unregisterItem(item);
+    parentItem->removeChild(row);
+    endRemoveRows();
+    if (parentItem == m_rootItem) {
+        emit topLevelItemLayoutChanged();
+    }
+}
+
+void NodeTreeModel::addTagNode(const TagData &tag)
+{
+    if (m_tagItems.contains(tag.id())) {
+        return;
+    }
+    int row = insertRowForType(m_rootItem, NodeItem::Type::TagItem, tag.relativePosition());
+    beginInsertRows(QModelIndex(), row, row);
+    auto *tagItem = new NodeTreeItem(NodeItem::Type::TagItem, m_rootItem);
+    tagItem->setData(NodeItem::Roles::DisplayText, tag.name());
+    tagItem->setData(NodeItem::Roles::TagColor, tag.color());
+    tagItem->setData(NodeItem::Roles::NodeId, tag.id());
+    tagItem->setData(NodeItem::Roles::RelPos, tag.relativePosition());
+    tagItem->setData(NodeItem::Roles::ChildCount, tag.childNotesCount());
+    m_rootItem->insertChild(row, tagItem);
+    registerItem(tagItem);
+    endInsertRows();
+    emit topLevelItemLayoutChanged();
+}
+
+void NodeTreeModel::removeTagNode(int tagId)
+{
+    auto *item = m_tagItems.value(tagId, nullptr);
+    if (item == nullptr) {
+        return;
+    }
+    int row = item->getRow();
+    beginRemoveRows(QModelIndex(), row, row);
+    unregisterItem(item);
+    m_rootItem->removeChild(row);
+    endRemoveRows();
+    emit topLevelItemLayoutChanged();
+}
+
+void NodeTreeModel::setFolderChildNotesCount(int folderId, int notesCount)
+{
+    auto *item = m_folderItems.value(folderId, nullptr);
+    if (item != nullptr) {
+        auto index = indexFromItem(item);
+        if (index.isValid()) {
+            setData(index, notesCount, NodeItem::Roles::ChildCount);
+        }
+        return;
+    }
+    auto node = m_unfetchedNodes.find(folderId);
+    if (node != m_unfetchedNodes.end()) {
+        node->setChildNotesCount(notesCount);
+    }
+}
+
+bool NodeTreeModel::hasUnfetchedChildren(const NodeTreeItem *item) const
+{
+    if (item->type() != NodeItem::Type::FolderItem && item->type() != NodeItem::Type::RootItem) {
+        return false;
+    }
+    return m_unfetchedChildIds.contains(item->id());
+}
+
+/*!
+ * \brief NodeTreeModel::takeUnfetchedChildren
+ * Create the items for the children of parentItem that are still only kept
+ * as NodeData, sorted by relative position. The caller inserts them.
+ */
+QVector<NodeTreeItem *> NodeTreeModel::takeUnfetchedChildren(NodeTreeItem *parentItem)
+{
+    QVector<NodeTreeItem *> items;
+    if (!hasUnfetchedChildren(parentItem)) {
+        return items;
+    }
+    const auto childIds = m_unfetchedChildIds.take(parentItem->id());
+    items.reserve(childIds.size());
+    for (const auto id : childIds) {
+        auto node = m_unfetchedNodes.take(id);
+        NodeTreeItem *nodeItem;
+        if (node.nodeType() == NodeData::Type::Folder) {
+            nodeItem = new NodeTreeItem(NodeItem::Type::FolderItem, parentItem);
+            nodeItem->setData(NodeItem::Roles::AbsPath, node.absolutePath());
+            nodeItem->setData(NodeItem::Roles::RelPos, node.relativePosition());
+            nodeItem->setData(NodeItem::Roles::ChildCount, node.childNotesCount());
+        } else if (node.nodeType() == NodeData::Type::Note) {
+            nodeItem = new NodeTreeItem(NodeItem::Type::NoteItem, parentItem);
+        } else {
+            qDebug() << "Wrong node type";
+            continue;
+        }
+        nodeItem->setData(NodeItem::Roles::DisplayText, node.fullTitle());
+        nodeItem->setData(NodeItem::Roles::NodeId, node.id());
+        items.append(nodeItem);
+    }
+    std::sort(items.begin(), items.end(), [](const NodeTreeItem *a, const NodeTreeItem *b) { return a->relativePosition() < b->relativePosition(); });
+    return items;
+}
+
+void NodeTreeModel::fetchChildren(NodeTreeItem *parentItem)
+{
+    auto items = takeUnfetchedChildren(parentItem);
+    if (items.isEmpty()) {
+        return;
+    }
+    auto parentIndex = indexFromItem(parentItem);
+    if (parentItem->getChildCount() == 0) {
+        beginInsertRows(parentIndex, 0, items.size() - 1);
+        for (auto *item : std::as_const(items)) {
+            parentItem->appendChild(item);
+            registerItem(item);
+        }
+        endInsertRows();
+        return;
+    }
+    // folders were created or dropped here before it was expanded
+    for (auto *item : std::as_const(items)) {
+        int row = insertRowForType(parentItem, item->type(), item->relativePosition());
+        beginInsertRows(parentIndex, row, row);
+        parentItem->insertChild(row, item);
+        registerItem(item);
+        endInsertRows();
+    }
+}
+
+/*!
+ * \brief NodeTreeModel::fetchFolder
+ * Return the item of a folder, creating it and its ancestors first if they
+ * haven't been expanded yet
+ */
+NodeTreeItem *NodeTreeModel::fetchFolder(int id)
+{
+    auto *item = m_folderItems.value(id, nullptr);
+    if (item != nullptr) {
+        return item;
+    }
+    auto node = m_unfetchedNodes.constFind(id);
+    if (node == m_unfetchedNodes.constEnd() || node->nodeType() != NodeData::Type::Folder) {
+        return nullptr;
+    }
+    auto *parentItem = fetchFolder(node->parentId());
+    if (parentItem == nullptr) {
+        return nullptr;
+    }
+    fetchChildren(parentItem);
+    return m_folderItems.value(id, nullptr);
+}
+
+void NodeTreeModel::dropUnfetchedChildren(int folderId)
+{
+    const auto childIds = m_unfetchedChildIds.take(folderId);
+    for (const auto id : childIds) {
+        m_unfetchedNodes.remove(id);
+        dropUnfetchedChildren(id);
+    }
+}
+
+void NodeTreeModel::updateUnfetchedPaths(const QString &oldPath, const QString &newPath)
+{
+    auto const prefix = oldPath + PATH_SEPARATOR;
+    for (auto &node : m_unfetchedNodes) {
+        if (node.absolutePath().startsWith(prefix)) {
+            node.setAbsolutePath(newPath + node.absolutePath().mid(oldPath.size()));
+        }
+    }
+}
+
+QModelIndex NodeTreeModel::indexFromItem(NodeTreeItem *item) const
+{
+    if (item == nullptr || item == m_rootItem) {
+        return {};
+    }
+    return createIndex(item->getRow(), 0, item);
+}
+
+/*!
+ * \brief NodeTreeModel::insertRowForType
+ * Row at which a new child of the given type keeps the parent ordered by
+ * relative position, the same order recursiveSort() produces
+ */
+int NodeTreeModel::insertRowForType(NodeTreeItem *parentItem, NodeItem::Type type, int relativePosition) const
+{
+    auto separatorType = type == NodeItem::Type::TagItem ? NodeItem::Type::TagSeparator : NodeItem::Type::FolderSeparator;
+    int lastRow = -1;
+    int separatorRow = -1;
+    for (int i = 0; i < parentItem->getChildCount(); ++i) {
+        auto const *child = parentItem->getChild(i);
+        if (child->type() == type) {
+            if (child->relativePosition() > relativePosition) {
+                return i;
+            }
+            lastRow = i;
+        } else if (child->type() == separatorType) {
+            separatorRow = i;
+        }
+    }
+    if (lastRow != -1) {
+        return lastRow + 1;
+    }
+    if (separatorRow != -1) {
+        return separatorRow + 1;
+    }
+    return parentItem->getChildCount();
+}
+
 void NodeTreeModel::setTreeData(const NodeTagTreeData &treeData)
 {
     beginResetModel();
     delete m_rootItem;
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::RootItem;
-    m_rootItem = new NodeTreeItem(hs);
+    m_folderItems.clear();
+    m_tagItems.clear();
+    m_unfetchedNodes.clear();
+    m_unfetchedChildIds.clear();
+    m_rootItem = new NodeTreeItem(NodeItem::Type::RootItem);
+    m_rootItem->setData(NodeItem::Roles::NodeId, ROOT_FOLDER_ID);
+    registerItem(m_rootItem);
     appendAllNotesAndTrashButton(m_rootItem);
     appendFolderSeparator(m_rootItem);
     loadNodeTree(treeData.nodeTreeData, m_rootItem);
@@ -520,95 +899,97 @@ void NodeTreeModel::setTreeData(const NodeTagTreeData &treeData)
 
 void NodeTreeModel::loadNodeTree(const QVector<NodeData> &nodeData, NodeTreeItem *rootNode)
 {
-    QHash<int, NodeTreeItem *> itemMap;
-    itemMap[ROOT_FOLDER_ID] = rootNode;
-    for (const auto &node : nodeData) {
-        if (node.id() != ROOT_FOLDER_ID && node.id() != TRASH_FOLDER_ID && node.parentId() != TRASH_FOLDER_ID) {
-            auto hs = QHash<NodeItem::Roles, QVariant>{};
-            if (node.nodeType() == NodeData::Type::Folder) {
-                hs[NodeItem::Roles::ItemType] = NodeItem::Type::FolderItem;
-                hs[NodeItem::Roles::AbsPath] = node.absolutePath();
-                hs[NodeItem::Roles::RelPos] = node.relativePosition();
-                hs[NodeItem::Roles::ChildCount] = node.childNotesCount();
-            } else if (node.nodeType() == NodeData::Type::Note) {
-                hs[NodeItem::Roles::ItemType] = NodeItem::Type::NoteItem;
-            } else {
-                qDebug() << "Wrong node type";
-                continue;
-            }
-            hs[NodeItem::Roles::DisplayText] = node.fullTitle();
-            hs[NodeItem::Roles::NodeId] = node.id();
-            auto *nodeItem = new NodeTreeItem(hs, rootNode);
-            itemMap[node.id()] = nodeItem;
-        }
-    }
-
+    // Only the top level gets items right away, deeper nodes are kept as data
+    // until their parent is expanded or looked up (see fetchMore/fetchFolder)
+    m_unfetchedNodes.reserve(nodeData.size());
     for (const auto &node : nodeData) {
         if (node.id() != ROOT_FOLDER_ID && node.parentId() != -1 && node.id() != TRASH_FOLDER_ID && node.parentId() != TRASH_FOLDER_ID) {
-            auto parentNode = itemMap.find(node.parentId());
-            auto nodeItem = itemMap.find(node.id());
-            if (parentNode != itemMap.end() && nodeItem != itemMap.end()) {
-                (*parentNode)->appendChild(*nodeItem);
-                (*nodeItem)->setParentItem(*parentNode);
-            } else {
-                qDebug() << "Can't find node!";
-                continue;
-            }
+            m_unfetchedNodes[node.id()] = node;
+            m_unfetchedChildIds[node.parentId()].append(node.id());
         }
     }
+    const auto topLevelItems = takeUnfetchedChildren(rootNode);
+    for (auto *item : topLevelItems) {
+        rootNode->appendChild(item);
+        registerItem(item);
+    }
 }
 
 void NodeTreeModel::appendAllNotesAndTrashButton(NodeTreeItem *rootNode)
 {
     {
-        auto hs = QHash<NodeItem::Roles, QVariant>{};
-        hs[NodeItem::Roles::ItemType] = NodeItem::Type::AllNoteButton;
-        hs[NodeItem::Roles::DisplayText] = tr("All Notes");
-        hs[NodeItem::Roles::Icon] = u8"\ue2c7"; // folder
-        auto *allNodeButton = new NodeTreeItem(hs, rootNode);
+        auto *allNodeButton = new NodeTreeItem(NodeItem::Type::AllNoteButton, rootNode);
+        allNodeButton->setData(NodeItem::Roles::DisplayText, tr("All Notes"));
+        allNodeButton->setData(NodeItem::Roles::Icon, u8"\ue2c7"); // folder
         rootNode->appendChild(allNodeButton);
+        m_allNotesButtonItem = allNodeButton;
     }
     {
-        auto hs = QHash<NodeItem::Roles, QVariant>{};
-        hs[NodeItem::Roles::ItemType] = NodeItem::Type::TrashButton;
-        hs[NodeItem::Roles::DisplayText] = tr("Trash");
-        hs[NodeItem::Roles::Icon] = u8"\uf1f8"; // fa-trash
-        auto *trashButton = new NodeTreeItem(hs, rootNode);
+        auto *trashButton = new NodeTreeItem(NodeItem::Type::TrashButton, rootNode);
+        trashButton->setData(NodeItem::Roles::DisplayText, tr("Trash"));
+        trashButton->setData(NodeItem::Roles::Icon, u8"\uf1f8"); // fa-trash
         rootNode->appendChild(trashButton);
+        m_trashButtonItem = trashButton;
     }
 }
 
 void NodeTreeModel::appendFolderSeparator(NodeTreeItem *rootNode)
 {
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::FolderSeparator;
-    hs[NodeItem::Roles::DisplayText] = tr("Folders");
-    auto *folderSepButton = new NodeTreeItem(hs, rootNode);
+    auto *folderSepButton = new NodeTreeItem(NodeItem::Type::FolderSeparator, rootNode);
+    folderSepButton->setData(NodeItem::Roles::DisplayText, tr("Folders"));
     rootNode->appendChild(folderSepButton);
 }
 
 void NodeTreeModel::appendTagsSeparator(NodeTreeItem *rootNode)
 {
-    auto hs = QHash<NodeItem::Roles, QVariant>{};
-    hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagSeparator;
-    hs[NodeItem::Roles::DisplayText] = tr("Tags");
-    auto *tagSepButton = new NodeTreeItem(hs, rootNode);
+    auto *tagSepButton = new NodeTreeItem(NodeItem::Type::TagSeparator, rootNode);
+    tagSepButton->setData(NodeItem::Roles::DisplayText, tr("Tags"));
     rootNode->appendChild(tagSepButton);
 }
 
 void NodeTreeModel::loadTagList(const QVector<TagData> &tagData, NodeTreeItem *rootNode)
 {
     for (const auto &tag : tagData) {
-        auto hs = QHash<NodeItem::Roles, QVariant>{};
-        hs[NodeItem::Roles::ItemType] = NodeItem::Type::TagItem;
-        hs[NodeItem::Roles::DisplayText] = tag.name();
-        hs[NodeItem::Roles::TagColor] = tag.color();
-        hs[NodeItem::Roles::NodeId] = tag.id();
-        hs[NodeItem::Roles::RelPos] = tag.relativePosition();
-        hs[NodeItem::Roles::ChildCount] = tag.childNotesCount();
-
-        auto *tagItem = new NodeTreeItem(hs, rootNode);
+        auto *tagItem = new NodeTreeItem(NodeItem::Type::TagItem, rootNode);
+        tagItem->setData(NodeItem::Roles::DisplayText, tag.name());
+        tagItem->setData(NodeItem::Roles::TagColor, tag.color());
+        tagItem->setData(NodeItem::Roles::NodeId, tag.id());
+        tagItem->setData(NodeItem::Roles::RelPos, tag.relativePosition());
+        tagItem->setData(NodeItem::Roles::ChildCount, tag.childNotesCount());
         rootNode->appendChild(tagItem);
+        registerItem(tagItem);
+    }
+}
+
+void NodeTreeModel::applyItemData(NodeTreeItem *item, const QHash<NodeItem::Roles, QVariant> &data)
+{
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if (it.key() != NodeItem::Roles::ItemType) {
+            item->setData(it.key(), it.value());
+        }
+    }
+    registerItem(item);
+}
+
+void NodeTreeModel::registerItem(NodeTreeItem *item)
+{
+    if (item->type() == NodeItem::Type::FolderItem || item->type() == NodeItem::Type::RootItem) {
+        m_folderItems[item->id()] = item;
+    } else if (item->type() == NodeItem::Type::TagItem) {
+        m_tagItems[item->id()] = item;
+    }
+}
+
+void NodeTreeModel::unregisterItem(NodeTreeItem *item)
+{
+    if (item->type() == NodeItem::Type::FolderItem) {
+        m_folderItems.remove(item->id());
+        dropUnfetchedChildren(item->id());
+        for (int i = 0; i < item->getChildCount(); ++i) {
+            unregisterItem(item->getChild(i));
+        }
+    } else if (item->type() == NodeItem::Type::TagItem) {
+        m_tagItems.remove(item->id());
     }
 }
 
@@ -617,13 +998,12 @@ void NodeTreeModel::updateChildRelativePosition(NodeTreeItem *parent, const Node
     int relId = 0;
     for (int i = 0; i < parent->getChildCount(); ++i) {
         auto const *child = parent->getChild(i);
-        auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-        if (childType == type) {
+        if (child->type() == type) {
             if (type == NodeItem::Type::FolderItem) {
-                emit requestUpdateNodeRelativePosition(child->getData(NodeItem::Roles::NodeId).toInt(), relId);
+                emit requestUpdateNodeRelativePosition(child->id(), relId);
                 ++relId;
             } else if (type == NodeItem::Type::TagItem) {
-                emit requestUpdateTagRelativePosition(child->getData(NodeItem::Roles::NodeId).toInt(), relId);
+                emit requestUpdateTagRelativePosition(child->id(), relId);
                 ++relId;
             } else {
                 qDebug() << __FUNCTION__ << "Wrong type";
@@ -741,18 +1121,15 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
         QSet<int> movedIds;
         for (const auto &idString : std::as_const(idl)) {
             auto id = idString.toInt();
-            for (int i = 0; i < m_rootItem->getChildCount(); ++i) {
-                auto const *child = m_rootItem->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-                if (childType == NodeItem::Type::TagItem && child->getData(NodeItem::Roles::NodeId).toInt() == id) {
-                    if (row >= m_rootItem->getChildCount()) {
-                        row = m_rootItem->getChildCount() - 1;
-                    }
-                    m_rootItem->moveChild(i, row);
-                    movedIds.insert(id);
-                    break;
-                }
+            auto const *child = m_tagItems.value(id, nullptr);
+            if (child == nullptr) {
+                continue;
+            }
+            if (row >= m_rootItem->getChildCount()) {
+                row = m_rootItem->getChildCount() - 1;
             }
+            m_rootItem->moveChild(child->getRow(), row);
+            movedIds.insert(id);
         }
         endResetModel();
         emit topLevelItemLayoutChanged();
@@ -782,15 +1159,13 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
         } else {
             parentItem = static_cast<NodeTreeItem *>(parent.internalPointer());
         }
-        auto parentType = static_cast<NodeItem::Type>(parentItem->getData(NodeItem::Roles::ItemType).toInt());
+        auto parentType = parentItem->type();
         if (parentType != NodeItem::Type::FolderItem && parentType != NodeItem::Type::RootItem && parentType != NodeItem::Type::TrashButton) {
             return false;
         }
         movingItem = static_cast<NodeTreeItem *>(idx.internalPointer());
         if (parentType == NodeItem::Type::TrashButton) {
-            auto abs = movingItem->getData(NodeItem::Roles::AbsPath).toString();
-            auto movingIndex = folderIndexFromIdPath(abs);
-            emit requestMoveFolderToTrash(movingIndex);
+            emit requestMoveFolderToTrash(idx);
             return false;
         }
         if (parentType == NodeItem::Type::RootItem) {
@@ -809,53 +1184,37 @@ bool NodeTreeModel::dropMimeData(const QMimeData *mime, Qt::DropAction action, i
 
         if (movingItem->getParentItem() == parentItem) {
             beginResetModel();
-            for (int i = 0; i < parentItem->getChildCount(); ++i) {
-                auto const *child = parentItem->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-                if (childType == NodeItem::Type::FolderItem && child->getData(NodeItem::Roles::NodeId) == movingItem->getData(NodeItem::Roles::NodeId)) {
-                    int targetRow = row;
-                    if (row > i && row > 0) {
-                        targetRow -= 1;
-                    }
-                    parentItem->moveChild(i, targetRow);
-                    break;
-                }
+            int i = movingItem->getRow();
+            int targetRow = row;
+            if (row > i && row > 0) {
+                targetRow -= 1;
             }
+            parentItem->moveChild(i, targetRow);
             endResetModel();
             emit topLevelItemLayoutChanged();
             updateChildRelativePosition(parentItem, NodeItem::Type::FolderItem);
-            emit dropFolderSuccessful(movingItem->getData(NodeItem::Roles::AbsPath).toString());
+            emit dropFolderSuccessful(movingItem->absolutePath());
         } else {
             auto *movingParent = movingItem->getParentItem();
-            int r = -1;
-            for (int i = 0; i < movingParent->getChildCount(); ++i) {
-                auto const *child = movingParent->getChild(i);
-                auto childType = static_cast<NodeItem::Type>(child->getData(NodeItem::Roles::ItemType).toInt());
-                if ((childType == NodeItem::Type::FolderItem)
-                    && (child->getData(NodeItem::Roles::NodeId).toInt() == movingItem->getData(NodeItem::Roles::NodeId).toInt())) {
-                    r = i;
-                    break;
-                }
-            }
+            int r = movingItem->getRow();
             if (r == -1) {
                 return false;
             }
-            movingItem = movingParent->getChild(r);
-            auto oldAbsolutePath = movingItem->getData(NodeItem::Roles::AbsPath).toString();
-            QString newAbsolutePath = parentItem->getData(NodeItem::Roles::AbsPath).toString() + PATH_SEPARATOR
-                    + QString::number(movingItem->getData(NodeItem::Roles::NodeId).toInt());
+            auto oldAbsolutePath = movingItem->absolutePath();
+            QString newAbsolutePath = parentItem->absolutePath() + PATH_SEPARATOR + QString::number(movingItem->id());
             emit requestUpdateAbsPath(oldAbsolutePath, newAbsolutePath);
             beginResetModel();
             movingParent->takeChildAt(r);
             movingItem->setParentItem(parentItem);
             movingItem->recursiveUpdateFolderPath(oldAbsolutePath, newAbsolutePath);
+            updateUnfetchedPaths(oldAbsolutePath, newAbsolutePath);
             parentItem->insertChild(row, movingItem);
             endResetModel();
             emit topLevelItemLayoutChanged();
-            emit requestExpand(parentItem->getData(NodeItem::Roles::AbsPath).toString());
-            emit requestMoveNode(movingItem->getData(NodeItem::Roles::NodeId).toInt(), parentItem->getData(NodeItem::Roles::NodeId).toInt());
+            emit requestExpand(parentItem->absolutePath());
+            emit requestMoveNode(movingItem->id(), parentItem->id());
             updateChildRelativePosition(parentItem, NodeItem::Type::FolderItem);
-            emit dropFolderSuccessful(movingItem->getData(NodeItem::Roles::AbsPath).toString());
+            emit dropFolderSuccessful(movingItem->absolutePath());
         }
         return true;
     }
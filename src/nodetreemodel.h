@@ -40,7 +40,7 @@ enum Type {
 class NodeTreeItem
 {
 public:
-    explicit NodeTreeItem(const QHash<NodeItem::Roles, QVariant> &data, NodeTreeItem *parentItem = nullptr);
+    explicit NodeTreeItem(NodeItem::Type type, NodeTreeItem *parentItem = nullptr);
     ~NodeTreeItem();
 
     void appendChild(NodeTreeItem *child);
@@ -60,10 +60,22 @@ public:
     void moveChild(int from, int to);
     void recursiveSort();
 
+    NodeItem::Type type() const;
+    int id() const;
+    int relativePosition() const;
+    const QString &absolutePath() const;
+
 private:
     QVector<NodeTreeItem *> m_childItems;
-    QHash<NodeItem::Roles, QVariant> m_itemData;
     NodeTreeItem *m_parentItem;
+    NodeItem::Type m_type;
+    int m_id;
+    int m_relativePosition;
+    int m_childNotesCount;
+    QString m_displayText;
+    QString m_icon;
+    QString m_tagColor;
+    QString m_absolutePath;
 };
 
 class NodeTreeModel : public QAbstractItemModel
@@ -76,6 +88,7 @@ public:
     void appendChildNodeToParent(const QModelIndex &parentIndex, const QHash<NodeItem::Roles, QVariant> &data);
     QModelIndex rootIndex() const;
     QModelIndex folderIndexFromIdPath(const NodePath &idPath);
+    QModelIndex folderIndexFromId(int id);
     QModelIndex tagIndexFromId(int id);
     QString getNewFolderPlaceholderName(const QModelIndex &parentIndex);
     QString getNewTagPlaceholderName();
@@ -84,6 +97,12 @@ public:
     QModelIndex getAllNotesButtonIndex();
     QModelIndex getTrashButtonIndex();
     void deleteRow(const QModelIndex &rowIndex, const QModelIndex &parentIndex);
+    void addFolderNode(const NodeData &folder);
+    void moveFolderNode(int folderId, int parentId);
+    void removeFolderNode(int folderId);
+    void addTagNode(const TagData &tag);
+    void removeTagNode(int tagId);
+    void setFolderChildNotesCount(int folderId, int notesCount);
 
 public slots:
     void setTreeData(const NodeTagTreeData &treeData);
@@ -94,6 +113,9 @@ public:
     QModelIndex parent(const QModelIndex &index) const override;
     int rowCount(const QModelIndex &parent) const override;
     int columnCount(const QModelIndex &parent) const override;
+    bool hasChildren(const QModelIndex &parent) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
     QVariant data(const QModelIndex &index, int role) const override;
     Qt::ItemFlags flags(const QModelIndex &index) const override;
     bool setData(const QModelIndex &index, const QVariant &value, int role) override;
@@ -116,6 +138,23 @@ signals:
 
 private:
     NodeTreeItem *m_rootItem;
+    NodeTreeItem *m_allNotesButtonItem;
+    NodeTreeItem *m_trashButtonItem;
+    QHash<int, NodeTreeItem *> m_folderItems;
+    QHash<int, NodeTreeItem *> m_tagItems;
+    QHash<int, NodeData> m_unfetchedNodes;
+    QHash<int, QVector<int>> m_unfetchedChildIds;
+    void applyItemData(NodeTreeItem *item, const QHash<NodeItem::Roles, QVariant> &data);
+    void registerItem(NodeTreeItem *item);
+    void unregisterItem(NodeTreeItem *item);
+    QModelIndex indexFromItem(NodeTreeItem *item) const;
+    int insertRowForType(NodeTreeItem *parentItem, NodeItem::Type type, int relativePosition) const;
+    bool hasUnfetchedChildren(const NodeTreeItem *item) const;
+    QVector<NodeTreeItem *> takeUnfetchedChildren(NodeTreeItem *parentItem);
+    void fetchChildren(NodeTreeItem *parentItem);
+    NodeTreeItem *fetchFolder(int id);
+    void dropUnfetchedChildren(int folderId);
+    void updateUnfetchedPaths(const QString &oldPath, const QString &newPath);
     void loadNodeTree(const QVector<NodeData> &nodeData, NodeTreeItem *rootNode);
     void appendAllNotesAndTrashButton(NodeTreeItem *rootNode);
     void appendFolderSeparator(NodeTreeItem *rootNode);
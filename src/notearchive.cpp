@@ -0,0 +1,288 @@
+#include "notearchive.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QIODevice>
+#include <QtEndian>
+#include <algorithm>
+#include <array>
+
+namespace {
+auto constexpr LOCAL_FILE_HEADER_SIGNATURE = 0x04034b50u;
+auto constexpr CENTRAL_DIRECTORY_HEADER_SIGNATURE = 0x02014b50u;
+auto constexpr END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50u;
+auto constexpr ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50u;
+auto constexpr ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE = 0x07064b50u;
+auto constexpr LOCAL_FILE_HEADER_SIZE = 30;
+auto constexpr VERSION_DEFAULT = 20;
+auto constexpr VERSION_ZIP64 = 45;
+// Names are stored as UTF-8
+auto constexpr FLAG_UTF8 = 0x0800;
+// Entries sizes are only given after their data, which the reader doesn't support
+auto constexpr FLAG_DATA_DESCRIPTOR = 0x0008;
+auto constexpr METHOD_STORED = 0;
+auto constexpr METHOD_DEFLATED = 8;
+auto constexpr ZIP64_EXTRA_FIELD_ID = 0x0001;
+// qUncompress() only takes zlib streams, which end with the Adler-32 of the
+// data where zip entries have a CRC-32. The Adler-32 is kept in an extra
+// field of the local header so the entry can be wrapped back into one.
+auto constexpr ADLER32_EXTRA_FIELD_ID = 0x4e41;
+auto constexpr ZLIB_HEADER_SIZE = 2;
+auto constexpr ZLIB_TRAILER_SIZE = 4;
+// qCompress() prefixes the zlib stream with the data size
+auto constexpr QCOMPRESS_SIZE_PREFIX = 4;
+auto constexpr UINT16_LIMIT = 0xffffu;
+auto constexpr UINT32_LIMIT = 0xffffffffu;
+
+quint32 crc32(const QByteArray &data)
+{
+    static const auto table = []() {
+        std::array<quint32, 256> t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    quint32 crc = 0xffffffffu;
+    for (auto byte : data) {
+        crc = table[(crc ^ static_cast<quint8>(byte)) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffu;
+}
+
+void toDosDateTime(const QDateTime &dateTime, quint16 *dosTime, quint16 *dosDate)
+{
+    auto local = dateTime.toLocalTime();
+    if (!local.isValid() || local.date().year() < 1980) {
+        *dosTime = 0;
+        *dosDate = (1 << 5) | 1;
+        return;
+    }
+    auto time = local.time();
+    auto date = local.date();
+    *dosTime = static_cast<quint16>((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+    *dosDate = static_cast<quint16>(((date.year() - 1980) << 9) | (date.month() << 5) | date.day());
+}
+} // namespace
+
+NoteArchiveWriter::NoteArchiveWriter(QIODevice *device) : m_device(device), m_offset(0) { }
+
+/*!
+ * \brief NoteArchiveWriter::compressEntry
+ * Deflate the data of an entry, or keep it stored if that doesn't make it
+ * smaller
+ * \param name path of the entry in the archive, with '/' separators
+ * \param data
+ * \param modificationDate
+ * \return
+ */
+NoteArchiveEntry NoteArchiveWriter::compressEntry(const QString &name, const QByteArray &data, const QDateTime &modificationDate)
+{
+    NoteArchiveEntry entry{ name, modificationDate, data, crc32(data), 0, static_cast<quint32>(data.size()), false };
+    auto compressed = qCompress(data);
+    auto deflatedSize = compressed.size() - QCOMPRESS_SIZE_PREFIX - ZLIB_HEADER_SIZE - ZLIB_TRAILER_SIZE;
+    if (deflatedSize > 0 && deflatedSize < data.size()) {
+        entry.adler32 = qFromBigEndian<quint32>(compressed.constData() + compressed.size() - ZLIB_TRAILER_SIZE);
+        entry.data = compressed.mid(QCOMPRESS_SIZE_PREFIX + ZLIB_HEADER_SIZE, deflatedSize);
+        entry.isCompressed = true;
+    }
+    return entry;
+}
+
+/*!
+ * \brief NoteArchiveWriter::writeEntry
+ * \param entry
+ * \return false if the device couldn't be written to
+ */
+bool NoteArchiveWriter::writeEntry(const NoteArchiveEntry &entry)
+{
+    CentralDirectoryEntry centralEntry;
+    centralEntry.name = entry.name.toUtf8();
+    centralEntry.method = entry.isCompressed ? METHOD_DEFLATED : METHOD_STORED;
+    toDosDateTime(entry.modificationDate, &centralEntry.dosTime, &centralEntry.dosDate);
+    centralEntry.crc32 = entry.crc32;
+    centralEntry.compressedSize = static_cast<quint32>(entry.data.size());
+    centralEntry.size = entry.size;
+    centralEntry.offset = m_offset;
+
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << quint32(LOCAL_FILE_HEADER_SIGNATURE) << quint16(VERSION_DEFAULT) << quint16(FLAG_UTF8) << centralEntry.method << centralEntry.dosTime
+        << centralEntry.dosDate << centralEntry.crc32 << centralEntry.compressedSize << centralEntry.size << quint16(centralEntry.name.size())
+        << quint16(entry.isCompressed ? 8 : 0);
+    out.writeRawData(centralEntry.name.constData(), centralEntry.name.size());
+    if (entry.isCompressed) {
+        out << quint16(ADLER32_EXTRA_FIELD_ID) << quint16(4) << entry.adler32;
+    }
+    if (!write(header) || !write(entry.data)) {
+        return false;
+    }
+    m_entries.append(centralEntry);
+    return true;
+}
+
+/*!
+ * \brief NoteArchiveWriter::close
+ * Write the central directory, nothing can be added afterwards
+ * \return false if the device couldn't be written to
+ */
+bool NoteArchiveWriter::close()
+{
+    qint64 centralDirectoryOffset = m_offset;
+    for (const auto &entry : std::as_const(m_entries)) {
+        bool isZip64 = entry.offset >= UINT32_LIMIT;
+        QByteArray header;
+        QDataStream out(&header, QIODevice::WriteOnly);
+        out.setByteOrder(QDataStream::LittleEndian);
+        out << quint32(CENTRAL_DIRECTORY_HEADER_SIGNATURE) << quint16(VERSION_ZIP64) << quint16(isZip64 ? VERSION_ZIP64 : VERSION_DEFAULT)
+            << quint16(FLAG_UTF8) << entry.method << entry.dosTime << entry.dosDate << entry.crc32 << entry.compressedSize << entry.size
+            << quint16(entry.name.size()) << quint16(isZip64 ? 12 : 0) << quint16(0) << quint16(0) << quint16(0) << quint32(0)
+            << quint32(isZip64 ? UINT32_LIMIT : entry.offset);
+        out.writeRawData(entry.name.constData(), entry.name.size());
+        if (isZip64) {
+            out << quint16(ZIP64_EXTRA_FIELD_ID) << quint16(8) << quint64(entry.offset);
+        }
+        if (!write(header)) {
+            return false;
+        }
+    }
+    qint64 centralDirectorySize = m_offset - centralDirectoryOffset;
+    quint64 entryCount = m_entries.size();
+
+    QByteArray end;
+    QDataStream out(&end, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    bool isZip64 = entryCount >= UINT16_LIMIT || centralDirectoryOffset >= UINT32_LIMIT || centralDirectorySize >= UINT32_LIMIT;
+    if (isZip64) {
+        qint64 zip64EndOffset = m_offset;
+        out << quint32(ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE) << quint64(44) << quint16(VERSION_ZIP64) << quint16(VERSION_ZIP64) << quint32(0)
+            << quint32(0) << entryCount << entryCount << quint64(centralDirectorySize) << quint64(centralDirectoryOffset);
+        out << quint32(ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE) << quint32(0) << quint64(zip64EndOffset) << quint32(1);
+    }
+    auto classicEntryCount = quint16(std::min<quint64>(entryCount, UINT16_LIMIT));
+    out << quint32(END_OF_CENTRAL_DIRECTORY_SIGNATURE) << quint16(0) << quint16(0) << classicEntryCount << classicEntryCount
+        << quint32(std::min<qint64>(centralDirectorySize, UINT32_LIMIT)) << quint32(std::min<qint64>(centralDirectoryOffset, UINT32_LIMIT))
+        << quint16(0);
+    m_entries.clear();
+    return write(end);
+}
+
+bool NoteArchiveWriter::write(const QByteArray &data)
+{
+    if (m_device->write(data) != data.size()) {
+        qDebug() << __FUNCTION__ << __LINE__ << m_device->errorString();
+        return false;
+    }
+    m_offset += data.size();
+    return true;
+}
+
+NoteArchiveReader::NoteArchiveReader(QIODevice *device) : m_device(device), m_hasError(false) { }
+
+/*!
+ * \brief NoteArchiveReader::readEntry
+ * Read the next entry of the archive
+ * \param name
+ * \param data
+ * \return false once there are no entries left, or on error
+ */
+bool NoteArchiveReader::readEntry(QString &name, QByteArray &data)
+{
+    if (m_hasError) {
+        return false;
+    }
+    auto header = m_device->read(LOCAL_FILE_HEADER_SIZE);
+    if (header.size() < 4) {
+        // A valid archive always ends with its central directory
+        m_hasError = true;
+        return false;
+    }
+    QDataStream in(header);
+    in.setByteOrder(QDataStream::LittleEndian);
+    quint32 signature = 0;
+    in >> signature;
+    if (signature == CENTRAL_DIRECTORY_HEADER_SIGNATURE || signature == END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+        return false;
+    }
+    if (signature != LOCAL_FILE_HEADER_SIGNATURE || header.size() < LOCAL_FILE_HEADER_SIZE) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Not a local file header";
+        m_hasError = true;
+        return false;
+    }
+    quint16 version = 0;
+    quint16 flags = 0;
+    quint16 method = 0;
+    quint16 dosTime = 0;
+    quint16 dosDate = 0;
+    quint32 crc = 0;
+    quint32 compressedSize = 0;
+    quint32 size = 0;
+    quint16 nameSize = 0;
+    quint16 extraSize = 0;
+    in >> version >> flags >> method >> dosTime >> dosDate >> crc >> compressedSize >> size >> nameSize >> extraSize;
+    if ((flags & FLAG_DATA_DESCRIPTOR) != 0 || (method != METHOD_STORED && method != METHOD_DEFLATED)) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Unsupported archive entry";
+        m_hasError = true;
+        return false;
+    }
+    auto nameData = m_device->read(nameSize);
+    auto extra = m_device->read(extraSize);
+    auto entryData = m_device->read(compressedSize);
+    if (nameData.size() != nameSize || extra.size() != extraSize || entryData.size() != static_cast<qint64>(compressedSize)) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Truncated archive";
+        m_hasError = true;
+        return false;
+    }
+    name = QString::fromUtf8(nameData);
+
+    if (method == METHOD_STORED) {
+        data = entryData;
+    } else {
+        bool hasAdler32 = false;
+        quint32 adler32 = 0;
+        QDataStream extraIn(extra);
+        extraIn.setByteOrder(QDataStream::LittleEndian);
+        while (!extraIn.atEnd()) {
+            quint16 id = 0;
+            quint16 fieldSize = 0;
+            extraIn >> id >> fieldSize;
+            if (id == ADLER32_EXTRA_FIELD_ID && fieldSize == 4) {
+                extraIn >> adler32;
+                hasAdler32 = true;
+            } else {
+                extraIn.skipRawData(fieldSize);
+            }
+        }
+        if (!hasAdler32) {
+            qDebug() << __FUNCTION__ << __LINE__ << "Archive not written by Notes";
+            m_hasError = true;
+            return false;
+        }
+        QByteArray zlibData;
+        zlibData.reserve(QCOMPRESS_SIZE_PREFIX + ZLIB_HEADER_SIZE + entryData.size() + ZLIB_TRAILER_SIZE);
+        char sizePrefix[QCOMPRESS_SIZE_PREFIX];
+        qToBigEndian<quint32>(size, sizePrefix);
+        zlibData.append(sizePrefix, QCOMPRESS_SIZE_PREFIX);
+        zlibData.append("\x78\x9c", ZLIB_HEADER_SIZE);
+        zlibData.append(entryData);
+        char trailer[ZLIB_TRAILER_SIZE];
+        qToBigEndian<quint32>(adler32, trailer);
+        zlibData.append(trailer, ZLIB_TRAILER_SIZE);
+        data = qUncompress(zlibData);
+    }
+    if (static_cast<quint32>(data.size()) != size || crc32(data) != crc) {
+        qDebug() << __FUNCTION__ << __LINE__ << "Corrupted archive entry" << name;
+        m_hasError = true;
+        return false;
+    }
+    return true;
+}
+
+bool NoteArchiveReader::hasError() const
+{
+    return m_hasError;
+}
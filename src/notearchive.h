@@ -0,0 +1,79 @@
+#ifndef NOTEARCHIVE_H
+#define NOTEARCHIVE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+#include <QVector>
+
+class QIODevice;
+
+struct NoteArchiveEntry
+{
+    QString name;
+    QDateTime modificationDate;
+    QByteArray data;
+    quint32 crc32;
+    quint32 adler32;
+    quint32 size;
+    bool isCompressed;
+};
+
+/*!
+ * \brief The NoteArchiveWriter class
+ * Writes a zip archive sequentially to a device, so it never has to be
+ * seekable. Entries are compressed beforehand with compressEntry(), which
+ * is thread-safe, so callers can compress on the thread pool and write in
+ * order. Only the central directory, a few dozen bytes per entry, is kept
+ * in memory until close(). ZIP64 records are added when the archive has
+ * too many entries or grows too large for the classic ones.
+ */
+class NoteArchiveWriter
+{
+public:
+    explicit NoteArchiveWriter(QIODevice *device);
+
+    static NoteArchiveEntry compressEntry(const QString &name, const QByteArray &data, const QDateTime &modificationDate);
+    bool writeEntry(const NoteArchiveEntry &entry);
+    bool close();
+
+private:
+    struct CentralDirectoryEntry
+    {
+        QByteArray name;
+        quint16 method;
+        quint16 dosTime;
+        quint16 dosDate;
+        quint32 crc32;
+        quint32 compressedSize;
+        quint32 size;
+        qint64 offset;
+    };
+
+    bool write(const QByteArray &data);
+
+    QIODevice *m_device;
+    qint64 m_offset;
+    QVector<CentralDirectoryEntry> m_entries;
+};
+
+/*!
+ * \brief The NoteArchiveReader class
+ * Reads the entries of an archive written by NoteArchiveWriter one after
+ * the other from their local headers, without seeking to the central
+ * directory. Only one entry is held in memory at a time.
+ */
+class NoteArchiveReader
+{
+public:
+    explicit NoteArchiveReader(QIODevice *device);
+
+    bool readEntry(QString &name, QByteArray &data);
+    bool hasError() const;
+
+private:
+    QIODevice *m_device;
+    bool m_hasError;
+};
+
+#endif // NOTEARCHIVE_H
@@ -6,21 +6,43 @@
 #include "taglistmodel.h"
 #include "tagpool.h"
 #include "taglistdelegate.h"
+#include "markdowntext.h"
+#include "kanbanmodel.h"
 #include <QScrollBar>
 #include <QLabel>
 #include <QLineEdit>
 #include <QListWidget>
 #include <QDebug>
 #include <QCursor>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QAbstractTextDocumentLayout>
+#include <QStringMatcher>
 
 namespace {
 auto constexpr FIRST_LINE_MAX = 80;
+// Recently shown notes keep their document, up to this many of them and
+// this much estimated memory. The estimate counts the text along with its
+// layout and highlighting formats.
+auto constexpr DOCUMENT_CACHE_MAX_ENTRIES = 8;
+auto constexpr DOCUMENT_CACHE_MEMORY_BUDGET = qint64(64) * 1024 * 1024;
+auto constexpr DOCUMENT_CACHE_BYTES_PER_CHARACTER = 8;
+// The multi-note preview only holds a window of the selected notes, loaded
+// a chunk at a time while scrolling, however many notes are selected
+auto constexpr PREVIEW_CHUNK_NOTES = 16;
+auto constexpr PREVIEW_MAX_CHARACTERS = 1024 * 1024;
+auto constexpr PREVIEW_NOTE_MAX_CHARACTERS = 64 * 1024;
+// Search matches get a highlight this many viewports above and below the
+// visible part of the document, and never more than this many at once
+auto constexpr SEARCH_SELECTION_VIEWPORT_MARGIN = 1;
+auto constexpr SEARCH_SELECTION_MAX = 1000;
 }
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
 
-NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLabel, QLineEdit *searchEdit, QWidget *kanbanWidget, TagListView *tagListView,
-                                 TagPool *tagPool, DBManager *dbManager, QObject *parent)
+NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLabel, QLineEdit *searchEdit, QWidget *kanbanWidget,
+                                 KanbanColumnModel *kanbanColumnModel, TagListView *tagListView, TagPool *tagPool, DBManager *dbManager,
+                                 QObject *parent)
 #else
 NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLabel, QLineEdit *searchEdit, TagListView *tagListView, TagPool *tagPool,
                                  DBManager *dbManager, QObject *parent)
@@ -32,16 +54,43 @@ NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLab
       m_searchEdit{ searchEdit },
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
       m_kanbanWidget{ kanbanWidget },
+      m_kanbanColumnModel{ kanbanColumnModel },
 #endif
       m_tagListView{ tagListView },
       m_dbManager{ dbManager },
       m_isContentModified{ false },
       m_spacerColor{ 191, 191, 191 },
       m_currentAdaptableEditorPadding{ 0 },
-      m_currentMinimumEditorPadding{ 0 }
+      m_currentMinimumEditorPadding{ 0 },
+      m_isNoteTextStale{ false },
+      m_hasPendingTextChange{ false },
+      m_pendingChangePosition{ 0 },
+      m_titleEndPosition{ -1 },
+      m_defaultDocument{ m_textEdit->document() },
+      m_defaultHighlighter{ m_highlighter },
+      m_documentCacheHits{ 0 },
+      m_documentCacheMisses{ 0 },
+      m_hasTheme{ false },
+      m_theme{ Theme::Light },
+      m_fontSize{ 0 },
+      m_previewFirstNote{ 0 },
+      m_previewCharacterCount{ 0 },
+      m_isUpdatingPreview{ false },
+      m_searchDocument{ nullptr },
+      m_searchDocumentRevision{ -1 },
+      m_firstSelectedMatch{ -1 },
+      m_lastSelectedMatch{ -1 }
 {
+    // The editor deletes the documents it owns when another one is set,
+    // documents are owned by the editor widget itself instead
+    m_defaultDocument->setParent(m_textEdit);
+    m_highlighter->setTextEdit(m_textEdit);
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, &NoteEditorLogic::onTextEditContentsChange);
     connect(m_textEdit, &QTextEdit::textChanged, this, &NoteEditorLogic::onTextEditTextChanged);
     connect(this, &NoteEditorLogic::requestCreateUpdateNote, m_dbManager, &DBManager::onCreateUpdateRequestedNoteContent, Qt::QueuedConnection);
+    connect(this, &NoteEditorLogic::noteEditClosed, m_dbManager, &DBManager::onNoteEditClosed, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::noteRevisionRestored, this, &NoteEditorLogic::onNoteContentReplaced);
+    connect(m_dbManager, &DBManager::importedNoteUpdated, this, &NoteEditorLogic::onNoteContentReplaced);
     // auto save timer
     m_autoSaveTimer.setSingleShot(true);
     m_autoSaveTimer.setInterval(50);
@@ -60,6 +109,9 @@ NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLab
             m_autoSaveTimer.start();
         }
     });
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &NoteEditorLogic::updateMultiNotePreviewWindow);
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::rangeChanged, this, &NoteEditorLogic::updateMultiNotePreviewWindow);
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &NoteEditorLogic::updateSearchSelections);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
     connect(this, &NoteEditorLogic::showKanbanView, this, [this]() {
         if (m_kanbanWidget != nullptr) {
@@ -88,16 +140,24 @@ NoteEditorLogic::NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLab
 
 bool NoteEditorLogic::markdownEnabled() const
 {
-    return m_highlighter->document() != nullptr;
+    return m_defaultHighlighter->document() != nullptr;
 }
 
 void NoteEditorLogic::setMarkdownEnabled(bool enabled)
 {
-    m_highlighter->setDocument(enabled ? m_textEdit->document() : nullptr);
+    clearInactiveNoteDocuments();
+    m_defaultHighlighter->setDocument(enabled ? m_defaultDocument : nullptr);
+    if (m_highlighter != m_defaultHighlighter) {
+        m_highlighter->setDocument(enabled ? m_textEdit->document() : nullptr);
+    }
 }
 
 void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
 {
+    flushCurrentNoteContent();
+    storeCurrentNoteDocumentState();
+    m_hasPendingTextChange = false;
+    m_titleEndPosition = -1;
     auto currentId = currentEditingNoteId();
     if (notes.size() == 1 && notes[0].id() != INVALID_NODE_ID) {
         if (currentId != INVALID_NODE_ID && notes[0].id() != currentId) {
@@ -113,17 +173,15 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
 
         m_currentNotes = notes;
         showTagListForCurrentNote();
-        //     fixing bug #202
-        m_textEdit->setTextBackgroundColor(QColor(247, 247, 247, 0));
 
-        QString content = notes[0].content();
         QDateTime dateTime = notes[0].lastModificationdateTime();
         int scrollbarPos = notes[0].scrollBarPosition();
 
         // set text and date
-        bool isTextChanged = content != m_textEdit->toPlainText();
-        if (isTextChanged) {
-            m_textEdit->setText(content);
+        if (!swapInNoteDocument(notes[0])) {
+            //     fixing bug #202
+            m_textEdit->setTextBackgroundColor(QColor(247, 247, 247, 0));
+            m_textEdit->setText(notes[0].content());
         }
         QString noteDate = dateTime.toString(Qt::ISODate);
         QString noteDateEditor = getNoteDateEditor(noteDate);
@@ -159,34 +217,20 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
         m_tagListView->setVisible(false);
         m_textEdit->blockSignals(true);
         auto verticalScrollBarValueToRestore = m_textEdit->verticalScrollBar()->value();
+        showDefaultDocument();
+        m_isUpdatingPreview = true;
         m_textEdit->clear();
-        auto padding = m_currentAdaptableEditorPadding > m_currentMinimumEditorPadding ? m_currentAdaptableEditorPadding : m_currentMinimumEditorPadding;
-        QPixmap sep(QSize{ m_textEdit->width() - (padding * 2) - 12, 4 });
-        sep.fill(Qt::transparent);
-        QPainter painter(&sep);
-        painter.setPen(m_spacerColor);
-        painter.drawRect(0, 1, sep.width(), 1);
-        m_textEdit->document()->addResource(QTextDocument::ImageResource, QUrl("mydata://sep.png"), sep);
-        for (int i = 0; i < notes.size(); ++i) {
-            auto cursor = m_textEdit->textCursor();
-            cursor.movePosition(QTextCursor::End);
-            if (!notes[i].content().endsWith("\n")) {
-                if (i != 0) {
-                    cursor.insertText("\n" + notes[i].content() + "\n");
-                } else {
-                    cursor.insertText(notes[i].content() + "\n");
-                }
-            } else {
-                cursor.insertText(notes[i].content());
-            }
-            if (i != notes.size() - 1) {
-                cursor.movePosition(QTextCursor::End);
-                cursor.insertText("\n");
-                cursor.insertImage("mydata://sep.png");
-                cursor.insertText("\n");
-            }
+        addSeparatorResource();
+        m_previewFirstNote = 0;
+        m_previewSegmentLengths.clear();
+        m_previewCharacterCount = 0;
+        for (int i = 0; i < std::min(PREVIEW_CHUNK_NOTES, static_cast<int>(notes.size())); ++i) {
+            m_previewSegmentLengths.append(insertPreviewSegment(i, m_previewCharacterCount));
+            m_previewCharacterCount += m_previewSegmentLengths.last();
         }
+        m_isUpdatingPreview = false;
         m_textEdit->verticalScrollBar()->setValue(verticalScrollBarValueToRestore);
+        updateMultiNotePreviewWindow();
         m_textEdit->blockSignals(false);
         m_textEdit->setReadOnly(true);
         m_textEdit->setTextInteractionFlags(Qt::TextSelectableByMouse);
@@ -195,38 +239,93 @@ void NoteEditorLogic::showNotesInEditor(const QVector<NodeData> &notes)
     }
 }
 
+/*!
+ * \brief NoteEditorLogic::onTextEditContentsChange
+ * Only remember where the document was edited, the change itself is
+ * handled once textChanged() is emitted for it
+ */
+void NoteEditorLogic::onTextEditContentsChange(int position, int charsRemoved, int charsAdded)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
+    invalidateTaskBlocks(position, charsAdded);
+#endif
+    if (m_textEdit->signalsBlocked() || (charsRemoved == 0 && charsAdded == 0)) {
+        return;
+    }
+    if (!m_hasPendingTextChange || position < m_pendingChangePosition) {
+        m_pendingChangePosition = position;
+    }
+    m_hasPendingTextChange = true;
+}
+
+/*!
+ * \brief NoteEditorLogic::onTextEditTextChanged
+ * Keep the current note up to date without copying the whole document on
+ * every keystroke: the title is only recomputed when the edit touched the
+ * blocks it comes from, and the content is materialized when it's flushed
+ */
 void NoteEditorLogic::onTextEditTextChanged()
 {
     if (currentEditingNoteId() != INVALID_NODE_ID) {
+        if (!m_hasPendingTextChange) {
+            return;
+        }
         m_textEdit->blockSignals(true);
-        QString content = m_currentNotes[0].content();
-        if (m_textEdit->toPlainText() != content) {
-            // move note to the top of the list
-            emit moveNoteToListViewTop(m_currentNotes[0]);
-
-            // Get the new data
-            QString firstline = getFirstLine(m_textEdit->toPlainText());
-            QDateTime dateTime = QDateTime::currentDateTime();
-            QString noteDate = dateTime.toString(Qt::ISODate);
-            m_editorDateLabel->setText(NoteEditorLogic::getNoteDateEditor(noteDate));
-            // update note data
-            m_currentNotes[0].setContent(m_textEdit->toPlainText());
-            m_currentNotes[0].setFullTitle(firstline);
-            m_currentNotes[0].setLastModificationDateTime(dateTime);
-            m_currentNotes[0].setIsTempNote(false);
-            m_currentNotes[0].setScrollBarPosition(m_textEdit->verticalScrollBar()->value());
-            // update note data in list view
-            emit updateNoteDataInList(m_currentNotes[0]);
-            m_isContentModified = true;
-            m_autoSaveTimer.start();
-            emit setVisibilityOfFrameRightWidgets(false);
+        // move note to the top of the list
+        emit moveNoteToListViewTop(m_currentNotes[0]);
+
+        if (m_titleEndPosition < 0 || m_pendingChangePosition <= m_titleEndPosition) {
+            updateCurrentNoteTitle();
         }
+        m_hasPendingTextChange = false;
+        m_isNoteTextStale = true;
+
+        QDateTime dateTime = QDateTime::currentDateTime();
+        QString noteDate = dateTime.toString(Qt::ISODate);
+        m_editorDateLabel->setText(NoteEditorLogic::getNoteDateEditor(noteDate));
+        // update note data
+        m_currentNotes[0].setLastModificationDateTime(dateTime);
+        m_currentNotes[0].setIsTempNote(false);
+        m_currentNotes[0].setScrollBarPosition(m_textEdit->verticalScrollBar()->value());
+        // update note data in list view
+        emit updateNoteDataInList(m_currentNotes[0]);
+        m_isContentModified = true;
+        m_autoSaveTimer.start();
+        emit setVisibilityOfFrameRightWidgets(false);
         m_textEdit->blockSignals(false);
     } else {
         qDebug() << "NoteEditorLogic::onTextEditTextChanged() : m_currentNote is not valid";
     }
 }
 
+/*!
+ * \brief NoteEditorLogic::updateCurrentNoteTitle
+ * Same rule as getFirstLine() but only reads the leading blocks of the document
+ */
+void NoteEditorLogic::updateCurrentNoteTitle()
+{
+    auto *document = m_textEdit->document();
+    for (auto block = document->begin(); block.isValid(); block = block.next()) {
+        auto line = block.text().trimmed();
+        if (!line.isEmpty() && !line.startsWith("---") && !line.startsWith("```")) {
+            m_currentNotes[0].setFullTitle(getFirstLine(block.text()));
+            m_titleEndPosition = block.position() + block.length();
+            return;
+        }
+    }
+    m_currentNotes[0].setFullTitle(getFirstLine(QString()));
+    m_titleEndPosition = document->characterCount();
+}
+
+void NoteEditorLogic::flushCurrentNoteContent()
+{
+    if (m_isNoteTextStale && currentEditingNoteId() != INVALID_NODE_ID) {
+        m_currentNotes[0].setContent(m_textEdit->toPlainText());
+        emit updateNoteDataInList(m_currentNotes[0]);
+    }
+    m_isNoteTextStale = false;
+}
+
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
 
 void NoteEditorLogic::rearrangeTasksInTextEditor(int startLinePosition, int endLinePosition, int newLinePosition)
@@ -294,19 +393,14 @@ void NoteEditorLogic::rearrangeColumnsInTextEditor(int startLinePosition, int en
 
 QMap<QString, int> NoteEditorLogic::getTaskDataInLine(const QString &line)
 {
-    QStringList taskExpressions = { "- [ ]", "- [x]", "* [ ]", "* [x]", "- [X]", "* [X]" };
     QMap<QString, int> taskMatchLineData;
-    taskMatchLineData["taskMatchIndex"] = -1;
-
-    int taskMatchIndex = -1;
-    for (auto &taskExpression : taskExpressions) {
-        taskMatchIndex = line.indexOf(taskExpression);
-        if (taskMatchIndex != -1) {
-            taskMatchLineData["taskMatchIndex"] = taskMatchIndex;
-            taskMatchLineData["taskExpressionSize"] = taskExpression.size();
-            taskMatchLineData["taskChecked"] = taskExpression[3] == 'x' ? 1 : 0;
-            return taskMatchLineData;
-        }
+    int taskExpressionSize = 0;
+    bool isTaskChecked = false;
+    int taskMatchIndex = MarkdownText::findTaskMarker(line, &taskExpressionSize, &isTaskChecked);
+    taskMatchLineData["taskMatchIndex"] = taskMatchIndex;
+    if (taskMatchIndex != -1) {
+        taskMatchLineData["taskExpressionSize"] = taskExpressionSize;
+        taskMatchLineData["taskChecked"] = isTaskChecked ? 1 : 0;
     }
 
     return taskMatchLineData;
@@ -527,110 +621,135 @@ void NoteEditorLogic::addUntitledColumnToTextEditor(int startLinePosition)
     }
 }
 
-void NoteEditorLogic::appendNewColumn(QJsonArray &data, QJsonObject &currentColumn, QString &currentTitle, QJsonArray &tasks)
+void NoteEditorLogic::appendNewColumn(QVector<KanbanColumn> &columns, int columnStartLine, QString &currentTitle, QVector<KanbanTask> &tasks)
 {
     if (!tasks.isEmpty()) {
-        currentColumn["title"] = currentTitle;
-        currentColumn["tasks"] = tasks;
-        currentColumn["columnEndLine"] = tasks.last()["taskEndLine"];
-        data.append(currentColumn);
-        currentColumn = QJsonObject();
-        tasks = QJsonArray();
+        columns.append({ currentTitle, columnStartLine, tasks.last().endLine, tasks });
+        tasks.clear();
+    }
+}
+
+/*!
+ * \brief NoteEditorLogic::invalidateTaskBlocks
+ * Blocks touched by an edit get parsed again the next time tasks are
+ * checked, the others keep what was found in them
+ */
+void NoteEditorLogic::invalidateTaskBlocks(int position, int charsAdded)
+{
+    auto document = m_textEdit->document();
+    auto block = document->findBlock(position);
+    auto lastBlock = document->findBlock(position + charsAdded);
+    for (; block.isValid(); block = block.next()) {
+        auto data = dynamic_cast<MarkdownBlockData *>(block.userData());
+        if (data != nullptr) {
+            data->taskLineType = MarkdownBlockData::TaskLineType::Unparsed;
+            data->taskLineText.clear();
+        }
+        if (block == lastBlock) {
+            break;
+        }
     }
 }
 
+/*!
+ * \brief NoteEditorLogic::taskBlockData
+ * What the task parser found in a block, parsing it only if it changed
+ * since the last time
+ */
+MarkdownBlockData *NoteEditorLogic::taskBlockData(QTextBlock &block)
+{
+    auto data = dynamic_cast<MarkdownBlockData *>(block.userData());
+    if (data == nullptr) {
+        data = new MarkdownBlockData;
+        block.setUserData(data);
+    }
+    if (data->taskLineType != MarkdownBlockData::TaskLineType::Unparsed) {
+        return data;
+    }
+
+    QString line = block.text();
+    QString lineTrimmed = line.trimmed();
+    // Header title
+    if (lineTrimmed.startsWith("#")) {
+        data->taskLineType = MarkdownBlockData::TaskLineType::Header;
+        data->taskLineText = lineTrimmed.mid(lineTrimmed.count('#'));
+        return data;
+    }
+    QMap<QString, int> taskDataInLine = getTaskDataInLine(line);
+    int indexOfTaskInLine = taskDataInLine["taskMatchIndex"];
+    // Non-header text with double colons
+    if (lineTrimmed.endsWith("::") && indexOfTaskInLine == -1) {
+        data->taskLineType = MarkdownBlockData::TaskLineType::Header;
+        data->taskLineText = line.split("::")[0].trimmed();
+    }
+    // Todo item
+    else if (indexOfTaskInLine != -1) {
+        data->taskLineType = MarkdownBlockData::TaskLineType::Task;
+        data->taskLineText = line.mid(indexOfTaskInLine + taskDataInLine["taskExpressionSize"]).trimmed();
+        data->isTaskChecked = taskDataInLine["taskChecked"] == 1;
+    } else {
+        data->taskLineType = line.isEmpty() ? MarkdownBlockData::TaskLineType::Empty : MarkdownBlockData::TaskLineType::Text;
+    }
+    return data;
+}
+
 // Check if there are any tasks in the current note.
-// If there are, sends the data to the kanban view.
-// Structure:
-// QJsonArray([
-// {
-//    "title":"TODO",
-//    "columnStartLine": 1
-//    "columnEndLine": 4
-//    "tasks":[
-//              {"checked":false,"text":"todo 1", "taskStartine": 3, "taskEndLine": 3},
-//              {"checked":false,"text":"todo 2", "taskStartine": 4, "taskEndLine": 4}}]
-// },
-// ])
+// If there are, applies them to the kanban model, which only updates the
+// columns and tasks that changed since the last check.
+// Each line is parsed once and the result kept in its block, so a check
+// after an edit only parses the lines that changed.
 bool NoteEditorLogic::checkForTasksInEditor()
 {
-    QStringList lines = m_textEdit->toPlainText().split("\n");
-    QJsonArray data;
-    QJsonObject currentColumn;
-    QJsonArray tasks;
+    QVector<KanbanColumn> columns;
+    int columnStartLine = 0;
+    QVector<KanbanTask> tasks;
     QString currentTitle = "";
     bool isPreviousLineATask = false;
 
-    for (int i = 0; i < lines.size(); i++) {
-        const QString &line = lines[i];
-        QString lineTrimmed = line.trimmed();
-
-        // Header title
-        if (lineTrimmed.startsWith("#")) {
-            if (!tasks.isEmpty() && currentTitle.isEmpty()) {
-                // If we have only tasks without a header we insert one and call this function again
-                addUntitledColumnToTextEditor(tasks.first()["taskStartLine"].toInt());
-                return true;
-            }
-            appendNewColumn(data, currentColumn, currentTitle, tasks);
-            currentColumn["columnStartLine"] = i;
-            int countOfHashTags = lineTrimmed.count('#');
-            currentTitle = lineTrimmed.mid(countOfHashTags);
-            isPreviousLineATask = false;
-        }
-        // Non-header text with double colons
-        else if (lineTrimmed.endsWith("::") && getTaskDataInLine(line)["taskMatchIndex"] == -1) {
+    int i = 0;
+    for (auto block = m_textEdit->document()->begin(); block.isValid(); block = block.next(), ++i) {
+        auto data = taskBlockData(block);
+        switch (data->taskLineType) {
+        case MarkdownBlockData::TaskLineType::Header:
             if (!tasks.isEmpty() && currentTitle.isEmpty()) {
                 // If we have only tasks without a header we insert one and call this function again
-                addUntitledColumnToTextEditor(tasks.first()["taskStartLine"].toInt());
+                addUntitledColumnToTextEditor(tasks.first().startLine);
                 return true;
             }
-            appendNewColumn(data, currentColumn, currentTitle, tasks);
-            currentColumn["columnStartLine"] = i;
-            QStringList parts = line.split("::");
-            currentTitle = parts[0].trimmed();
+            appendNewColumn(columns, columnStartLine, currentTitle, tasks);
+            columnStartLine = i;
+            currentTitle = data->taskLineText;
             isPreviousLineATask = false;
-        }
-        // Todo item
-        else {
-            QMap<QString, int> taskDataInLine = getTaskDataInLine(line);
-            int indexOfTaskInLine = taskDataInLine["taskMatchIndex"];
-
-            if (indexOfTaskInLine != -1) {
-                QJsonObject taskObject;
-                QString taskText = line.mid(indexOfTaskInLine + taskDataInLine["taskExpressionSize"]).trimmed();
-                taskObject["text"] = taskText;
-                taskObject["checked"] = taskDataInLine["taskChecked"] == 1;
-                taskObject["taskStartLine"] = i;
-                taskObject["taskEndLine"] = i;
-                tasks.append(taskObject);
-                isPreviousLineATask = true;
-            }
+            break;
+        case MarkdownBlockData::TaskLineType::Task:
+            tasks.append({ data->taskLineText, data->isTaskChecked, i, i });
+            isPreviousLineATask = true;
+            break;
+        case MarkdownBlockData::TaskLineType::Text:
             // If it's a continues description of the task push current line's text to the last task
-            else if (!line.isEmpty() && isPreviousLineATask) {
-                if (!tasks.empty()) {
-                    QJsonObject newTask = tasks[tasks.size() - 1].toObject();
-                    QString newTaskText = QStringLiteral("%1  \n%2").arg(newTask["text"].toString(), lineTrimmed);
-                    // For markdown rendering a line break needs two white spaces
-                    newTask["text"] = newTaskText;
-                    newTask["taskEndLine"] = i;
-                    tasks[tasks.size() - 1] = newTask;
-                }
-            } else {
-                isPreviousLineATask = false;
+            if (isPreviousLineATask && !tasks.empty()) {
+                auto &lastTask = tasks.last();
+                // For markdown rendering a line break needs two white spaces
+                lastTask.text = QStringLiteral("%1  \n%2").arg(lastTask.text, block.text().trimmed());
+                lastTask.endLine = i;
             }
+            break;
+        default:
+            isPreviousLineATask = false;
+            break;
         }
     }
 
     if (!tasks.isEmpty() && currentTitle.isEmpty()) {
         // If we have only tasks without a header we insert one and call this function again
-        addUntitledColumnToTextEditor(tasks.first()["taskStartLine"].toInt());
+        addUntitledColumnToTextEditor(tasks.first().startLine);
         return true;
     }
 
-    appendNewColumn(data, currentColumn, currentTitle, tasks);
+    appendNewColumn(columns, columnStartLine, currentTitle, tasks);
 
-    emit tasksFoundInEditor(QVariant(data));
+    m_kanbanColumnModel->setColumns(columns);
+    emit tasksFoundInEditor();
 
     return false;
 }
@@ -691,6 +810,7 @@ int NoteEditorLogic::currentEditingNoteId() const
 
 void NoteEditorLogic::saveNoteToDB()
 {
+    flushCurrentNoteContent();
     if (currentEditingNoteId() != INVALID_NODE_ID && m_isContentModified && !m_currentNotes[0].isTempNote()) {
         emit requestCreateUpdateNote(m_currentNotes[0]);
         m_isContentModified = false;
@@ -703,9 +823,11 @@ void NoteEditorLogic::closeEditor()
         saveNoteToDB();
         emit noteEditClosed(m_currentNotes[0], false);
     }
+    storeCurrentNoteDocumentState();
     m_currentNotes.clear();
 
     m_textEdit->blockSignals(true);
+    showDefaultDocument();
     m_textEdit->clear();
     m_textEdit->clearFocus();
     m_textEdit->blockSignals(false);
@@ -720,21 +842,50 @@ void NoteEditorLogic::onNoteTagListChanged(int noteId, const QSet<int> &tagIds)
     }
 }
 
+/*!
+ * \brief NoteEditorLogic::onNoteContentReplaced
+ * Show the content a note was restored to, or updated with by re-importing
+ * its file. Its cached document holds what it had before, and whatever the
+ * editor didn't save yet would overwrite the new content, so both are
+ * dropped.
+ * \param note
+ */
+void NoteEditorLogic::onNoteContentReplaced(const NodeData &note)
+{
+    if (currentEditingNoteId() != note.id()) {
+        removeNoteDocument(note.id());
+        return;
+    }
+    m_autoSaveTimer.stop();
+    m_isContentModified = false;
+    m_isNoteTextStale = false;
+    m_hasPendingTextChange = false;
+    auto restoredNote = m_currentNotes[0];
+    restoredNote.setFullTitle(note.fullTitle());
+    restoredNote.setContent(note.content());
+    restoredNote.setLastModificationDateTime(note.lastModificationdateTime());
+    restoredNote.setScrollBarPosition(m_textEdit->verticalScrollBar()->value());
+    removeNoteDocument(note.id());
+    showNotesInEditor({ restoredNote });
+}
+
 void NoteEditorLogic::deleteCurrentNote()
 {
     if (isTempNote()) {
         auto noteNeedDeleted = m_currentNotes[0];
         m_currentNotes.clear();
         m_textEdit->blockSignals(true);
+        removeNoteDocument(noteNeedDeleted.id());
         m_textEdit->clear();
         m_textEdit->clearFocus();
         m_textEdit->blockSignals(false);
         emit noteEditClosed(noteNeedDeleted, true);
     } else if (currentEditingNoteId() != INVALID_NODE_ID) {
-        auto noteNeedDeleted = m_currentNotes[0];
         saveNoteToDB();
+        auto noteNeedDeleted = m_currentNotes[0];
         m_currentNotes.clear();
         m_textEdit->blockSignals(true);
+        removeNoteDocument(noteNeedDeleted.id());
         m_textEdit->clear();
         m_textEdit->clearFocus();
         m_textEdit->blockSignals(false);
@@ -755,20 +906,16 @@ QString NoteEditorLogic::getNthLine(const QString &str, int targetLineNumber)
         if (i == str.length() || str[i] == '\n') {
             lineCount++;
             if (lineCount >= targetLineNumber && (i - previousLineBreakIndex > 1 || (i > 0 && i == str.length() && str[i - 1] != '\n'))) {
-                QString line = str.mid(previousLineBreakIndex + 1, i - previousLineBreakIndex - 1);
-                line = line.trimmed();
-                if (!line.isEmpty() && !line.startsWith("---") && !line.startsWith("```")) {
-                    QTextDocument doc;
-                    doc.setMarkdown(line);
-                    QString text = doc.toPlainText();
+                auto line = QStringView(str).mid(previousLineBreakIndex + 1, i - previousLineBreakIndex - 1).trimmed();
+                if (!line.isEmpty() && !line.startsWith(u"---") && !line.startsWith(u"```")) {
+                    QString text = MarkdownText::inlineToPlainText(line);
                     if (text.length() > 1 && text.at(0) == '^') {
                         text = text.mid(1);
                     }
                     if (text.isEmpty()) {
                         return tr("No additional text");
                     }
-                    QTextStream ts(&text);
-                    return ts.readLine(FIRST_LINE_MAX);
+                    return text.left(FIRST_LINE_MAX);
                 }
             }
             previousLineBreakIndex = i;
@@ -799,7 +946,16 @@ QString NoteEditorLogic::getSecondLine(const QString &str)
 void NoteEditorLogic::setTheme(Theme::Value theme, QColor textColor, qreal fontSize)
 {
     m_tagListDelegate->setTheme(theme);
-    m_highlighter->setTheme(theme, textColor, fontSize);
+    m_hasTheme = true;
+    m_theme = theme;
+    m_textColor = textColor;
+    m_fontSize = fontSize;
+    // Cached documents were highlighted with the previous formats
+    clearInactiveNoteDocuments();
+    m_defaultHighlighter->setTheme(theme, textColor, fontSize);
+    if (m_highlighter != m_defaultHighlighter) {
+        m_highlighter->setTheme(theme, textColor, fontSize);
+    }
     switch (theme) {
     case Theme::Light: {
         m_spacerColor = QColor(191, 191, 191);
@@ -814,15 +970,305 @@ void NoteEditorLogic::setTheme(Theme::Value theme, QColor textColor, qreal fontS
         break;
     }
     }
-    if (currentEditingNoteId() != INVALID_NODE_ID) {
-        int verticalScrollBarValueToRestore = m_textEdit->verticalScrollBar()->value();
-        m_textEdit->setText(m_textEdit->toPlainText()); // TODO: Update the text color without setting the text
-        m_textEdit->verticalScrollBar()->setValue(verticalScrollBarValueToRestore);
+    // Restyle in place so the document, cursor, scroll position and undo
+    // history are kept: only the highlighter formats and, when several notes
+    // are shown, the separator image depend on the theme
+    if (currentEditingNoteId() == INVALID_NODE_ID && m_currentNotes.size() > 1) {
+        addSeparatorResource();
+        auto document = m_textEdit->document();
+        document->markContentsDirty(0, document->characterCount());
+    }
+    m_highlighter->rehighlight();
+    m_textEdit->viewport()->update();
+}
+
+/*!
+ * \brief NoteEditorLogic::swapInNoteDocument
+ * Put the document of a note in the editor. Recently shown notes keep their
+ * document, already highlighted, along with the cursor, and it's reused as
+ * long as the note didn't change since. Otherwise a new empty document is
+ * put in place for the caller to fill.
+ * \param note
+ * \return true if the cached document was reused
+ */
+bool NoteEditorLogic::swapInNoteDocument(const NodeData &note)
+{
+    qint64 revision = note.lastModificationdateTime().toMSecsSinceEpoch();
+    for (int i = 0; i < m_documentCache.size(); ++i) {
+        if (m_documentCache[i].noteId != note.id()) {
+            continue;
+        }
+        auto entry = m_documentCache[i];
+        if (entry.revision == revision && entry.document->characterCount() - 1 == note.content().size()) {
+            ++m_documentCacheHits;
+            m_documentCache.move(i, 0);
+            setEditorDocument(entry.document, entry.highlighter);
+            int lastPosition = entry.document->characterCount() - 1;
+            QTextCursor cursor(entry.document);
+            cursor.setPosition(std::min(entry.cursorAnchor, lastPosition));
+            cursor.setPosition(std::min(entry.cursorPosition, lastPosition), QTextCursor::KeepAnchor);
+            m_textEdit->setTextCursor(cursor);
+            trimDocumentCache();
+            return true;
+        }
+        removeNoteDocumentAt(i);
+        break;
+    }
+
+    ++m_documentCacheMisses;
+    NoteDocumentCacheEntry entry;
+    entry.noteId = note.id();
+    entry.revision = revision;
+    entry.document = new QTextDocument(m_textEdit);
+    entry.highlighter = new CustomMarkdownHighlighter(entry.document);
+    entry.highlighter->setTextEdit(m_textEdit);
+    if (m_hasTheme) {
+        entry.highlighter->setTheme(m_theme, m_textColor, m_fontSize);
+    }
+    if (!markdownEnabled()) {
+        entry.highlighter->setDocument(nullptr);
+    }
+    entry.cursorPosition = 0;
+    entry.cursorAnchor = 0;
+    entry.estimatedSize = 0;
+    m_documentCache.prepend(entry);
+    setEditorDocument(entry.document, entry.highlighter);
+    trimDocumentCache();
+    return false;
+}
+
+/*!
+ * \brief NoteEditorLogic::showDefaultDocument
+ * Document used when the editor doesn't show a single note
+ */
+void NoteEditorLogic::showDefaultDocument()
+{
+    setEditorDocument(m_defaultDocument, m_defaultHighlighter);
+}
+
+void NoteEditorLogic::setEditorDocument(QTextDocument *document, CustomMarkdownHighlighter *highlighter)
+{
+    auto previousDocument = m_textEdit->document();
+    m_highlighter = highlighter;
+    if (previousDocument == document) {
+        return;
+    }
+    disconnect(previousDocument, &QTextDocument::contentsChange, this, &NoteEditorLogic::onTextEditContentsChange);
+    // Font and tab stops are set on the editor's document, carry them over
+    if (document->defaultFont() != previousDocument->defaultFont()) {
+        document->setDefaultFont(previousDocument->defaultFont());
+    }
+    if (document->defaultTextOption().tabStopDistance() != previousDocument->defaultTextOption().tabStopDistance()) {
+        document->setDefaultTextOption(previousDocument->defaultTextOption());
+    }
+    m_textEdit->setDocument(document);
+    connect(document, &QTextDocument::contentsChange, this, &NoteEditorLogic::onTextEditContentsChange);
+}
+
+/*!
+ * \brief NoteEditorLogic::storeCurrentNoteDocumentState
+ * Remember the revision and cursor of the note being left, the note shown
+ * is always the first cache entry
+ */
+void NoteEditorLogic::storeCurrentNoteDocumentState()
+{
+    if (m_documentCache.isEmpty() || m_documentCache.first().document != m_textEdit->document()) {
+        return;
+    }
+    auto &entry = m_documentCache.first();
+    if (currentEditingNoteId() == entry.noteId) {
+        entry.revision = m_currentNotes[0].lastModificationdateTime().toMSecsSinceEpoch();
+    }
+    auto cursor = m_textEdit->textCursor();
+    entry.cursorPosition = cursor.position();
+    entry.cursorAnchor = cursor.anchor();
+    entry.estimatedSize = qint64(entry.document->characterCount()) * DOCUMENT_CACHE_BYTES_PER_CHARACTER;
+}
+
+void NoteEditorLogic::removeNoteDocumentAt(int index)
+{
+    auto entry = m_documentCache.takeAt(index);
+    if (entry.document == m_textEdit->document()) {
+        showDefaultDocument();
+    }
+    if (entry.document == m_searchDocument) {
+        m_searchDocument = nullptr;
+    }
+    delete entry.document;
+}
+
+void NoteEditorLogic::removeNoteDocument(int noteId)
+{
+    for (int i = 0; i < m_documentCache.size(); ++i) {
+        if (m_documentCache[i].noteId == noteId) {
+            removeNoteDocumentAt(i);
+            return;
+        }
+    }
+}
+
+/*!
+ * \brief NoteEditorLogic::clearInactiveNoteDocuments
+ * Drop every cached document except the one in the editor
+ */
+void NoteEditorLogic::clearInactiveNoteDocuments()
+{
+    for (int i = m_documentCache.size() - 1; i >= 0; --i) {
+        if (m_documentCache[i].document != m_textEdit->document()) {
+            removeNoteDocumentAt(i);
+        }
+    }
+}
+
+/*!
+ * \brief NoteEditorLogic::trimDocumentCache
+ * Evict the least recently shown documents beyond the entry count or the
+ * memory budget, never the one in the editor
+ */
+void NoteEditorLogic::trimDocumentCache()
+{
+    qint64 totalSize = 0;
+    for (const auto &entry : std::as_const(m_documentCache)) {
+        totalSize += entry.estimatedSize;
+    }
+    while (m_documentCache.size() > 1 && (m_documentCache.size() > DOCUMENT_CACHE_MAX_ENTRIES || totalSize > DOCUMENT_CACHE_MEMORY_BUDGET)) {
+        int index = m_documentCache.last().document == m_textEdit->document() ? m_documentCache.size() - 2 : m_documentCache.size() - 1;
+        totalSize -= m_documentCache[index].estimatedSize;
+        removeNoteDocumentAt(index);
+    }
+}
+
+int NoteEditorLogic::documentCacheHits() const
+{
+    return m_documentCacheHits;
+}
+
+int NoteEditorLogic::documentCacheMisses() const
+{
+    return m_documentCacheMisses;
+}
+
+bool NoteEditorLogic::isMultiNotePreview() const
+{
+    return currentEditingNoteId() == INVALID_NODE_ID && m_currentNotes.size() > 1 && m_textEdit->document() == m_defaultDocument;
+}
+
+/*!
+ * \brief NoteEditorLogic::insertPreviewSegment
+ * Insert a selected note in the multi-note preview, followed by a separator
+ * unless it's the last one selected. Very long notes are cut short.
+ * \param noteIndex
+ * \param position
+ * \return the length of the inserted segment
+ */
+int NoteEditorLogic::insertPreviewSegment(int noteIndex, int position)
+{
+    auto content = m_currentNotes[noteIndex].content();
+    if (content.size() > PREVIEW_NOTE_MAX_CHARACTERS) {
+        content = content.left(PREVIEW_NOTE_MAX_CHARACTERS) + QStringLiteral("…\n");
+    }
+    QTextCursor cursor(m_textEdit->document());
+    cursor.setPosition(position);
+    if (!content.endsWith("\n")) {
+        if (noteIndex != 0) {
+            cursor.insertText("\n" + content + "\n");
+        } else {
+            cursor.insertText(content + "\n");
+        }
     } else {
-        int verticalScrollBarValueToRestore = m_textEdit->verticalScrollBar()->value();
-        showNotesInEditor(m_currentNotes);
-        m_textEdit->verticalScrollBar()->setValue(verticalScrollBarValueToRestore);
+        cursor.insertText(content);
+    }
+    if (noteIndex != m_currentNotes.size() - 1) {
+        cursor.insertText("\n");
+        cursor.insertImage("mydata://sep.png");
+        cursor.insertText("\n");
+    }
+    return cursor.position() - position;
+}
+
+void NoteEditorLogic::removePreviewSegment(bool isFirst)
+{
+    int length = isFirst ? m_previewSegmentLengths.takeFirst() : m_previewSegmentLengths.takeLast();
+    int position = isFirst ? 0 : m_previewCharacterCount - length;
+    QTextCursor cursor(m_textEdit->document());
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    m_previewCharacterCount -= length;
+    if (isFirst) {
+        ++m_previewFirstNote;
+    }
+}
+
+/*!
+ * \brief NoteEditorLogic::updateMultiNotePreviewWindow
+ * Load the next or previous chunk of notes when the preview is scrolled
+ * close to one of its ends, and unload notes from the other end once the
+ * preview is over its size budget. The scroll position is shifted by the
+ * height added or removed above the viewport so the view doesn't jump.
+ */
+void NoteEditorLogic::updateMultiNotePreviewWindow()
+{
+    if (m_isUpdatingPreview || !isMultiNotePreview()) {
+        return;
+    }
+    m_isUpdatingPreview = true;
+    auto scrollBar = m_textEdit->verticalScrollBar();
+    auto document = m_textEdit->document();
+    auto layout = document->documentLayout();
+    bool wasBlocked = m_textEdit->blockSignals(true);
+    int previewLastNote = m_previewFirstNote + m_previewSegmentLengths.size();
+    bool isLoadingMore = false;
+    if (scrollBar->value() >= scrollBar->maximum() - scrollBar->pageStep() && previewLastNote < m_currentNotes.size()) {
+        isLoadingMore = true;
+        int last = std::min(previewLastNote + PREVIEW_CHUNK_NOTES, static_cast<int>(m_currentNotes.size()));
+        for (int i = previewLastNote; i < last; ++i) {
+            m_previewSegmentLengths.append(insertPreviewSegment(i, m_previewCharacterCount));
+            m_previewCharacterCount += m_previewSegmentLengths.last();
+        }
+        while (m_previewCharacterCount > PREVIEW_MAX_CHARACTERS && m_previewSegmentLengths.size() > PREVIEW_CHUNK_NOTES) {
+            auto removedHeight = layout->blockBoundingRect(document->findBlock(m_previewSegmentLengths.first())).top();
+            removePreviewSegment(true);
+            scrollBar->setValue(scrollBar->value() - static_cast<int>(removedHeight));
+        }
+    } else if (scrollBar->value() <= scrollBar->pageStep() && m_previewFirstNote > 0) {
+        isLoadingMore = true;
+        int first = std::max(m_previewFirstNote - PREVIEW_CHUNK_NOTES, 0);
+        int insertedLength = 0;
+        for (int i = first; i < m_previewFirstNote; ++i) {
+            int length = insertPreviewSegment(i, insertedLength);
+            m_previewSegmentLengths.insert(i - first, length);
+            insertedLength += length;
+        }
+        m_previewCharacterCount += insertedLength;
+        m_previewFirstNote = first;
+        auto insertedHeight = layout->blockBoundingRect(document->findBlock(insertedLength)).top();
+        scrollBar->setValue(scrollBar->value() + static_cast<int>(insertedHeight));
+        while (m_previewCharacterCount > PREVIEW_MAX_CHARACTERS && m_previewSegmentLengths.size() > PREVIEW_CHUNK_NOTES) {
+            removePreviewSegment(false);
+        }
     }
+    m_textEdit->blockSignals(wasBlocked);
+    m_isUpdatingPreview = false;
+    if (isLoadingMore) {
+        // the chunk may not have filled the viewport yet
+        QTimer::singleShot(0, this, &NoteEditorLogic::updateMultiNotePreviewWindow);
+    }
+}
+
+/*!
+ * \brief NoteEditorLogic::addSeparatorResource
+ * (Re)draw the line shown between notes when several are selected
+ */
+void NoteEditorLogic::addSeparatorResource()
+{
+    auto padding = m_currentAdaptableEditorPadding > m_currentMinimumEditorPadding ? m_currentAdaptableEditorPadding : m_currentMinimumEditorPadding;
+    QPixmap sep(QSize{ m_textEdit->width() - (padding * 2) - 12, 4 });
+    sep.fill(Qt::transparent);
+    QPainter painter(&sep);
+    painter.setPen(m_spacerColor);
+    painter.drawRect(0, 1, sep.width(), 1);
+    m_textEdit->document()->addResource(QTextDocument::ImageResource, QUrl("mydata://sep.png"), sep);
 }
 
 QString NoteEditorLogic::getNoteDateEditor(const QString &dateEdited)
@@ -833,26 +1279,135 @@ QString NoteEditorLogic::getNoteDateEditor(const QString &dateEdited)
     return usLocale.toString(dateTimeEdited, QStringLiteral("MMMM d, yyyy, h:mm A"));
 }
 
-void NoteEditorLogic::highlightSearch() const
+/*!
+ * \brief NoteEditorLogic::highlightSearch
+ * Find the search text in the editor and select its first occurrence.
+ * Only the matches around the viewport are highlighted, the others get
+ * their highlight as the editor is scrolled to them.
+ */
+void NoteEditorLogic::highlightSearch()
 {
-    QString searchString = m_searchEdit->text();
+    if (!updateSearchMatches()) {
+        updateSearchSelections();
+        return;
+    }
+    if (!m_searchMatches.isEmpty()) {
+        selectSearchMatch(0);
+    }
+    updateSearchSelections();
+}
 
-    if (searchString.isEmpty())
+/*!
+ * \brief NoteEditorLogic::findNextSearchMatch
+ * Select the next occurrence of the search text after the cursor,
+ * wrapping around to the first one
+ */
+void NoteEditorLogic::findNextSearchMatch()
+{
+    if (!updateSearchMatches() || m_searchMatches.isEmpty()) {
         return;
+    }
+    auto from = m_textEdit->textCursor().selectionEnd();
+    auto it = std::lower_bound(m_searchMatches.cbegin(), m_searchMatches.cend(), from);
+    selectSearchMatch(it == m_searchMatches.cend() ? 0 : static_cast<int>(it - m_searchMatches.cbegin()));
+}
 
-    m_textEdit->moveCursor(QTextCursor::Start);
+/*!
+ * \brief NoteEditorLogic::findPreviousSearchMatch
+ * Select the previous occurrence of the search text before the cursor,
+ * wrapping around to the last one
+ */
+void NoteEditorLogic::findPreviousSearchMatch()
+{
+    if (!updateSearchMatches() || m_searchMatches.isEmpty()) {
+        return;
+    }
+    auto from = m_textEdit->textCursor().selectionStart();
+    auto it = std::lower_bound(m_searchMatches.cbegin(), m_searchMatches.cend(), from);
+    int index = static_cast<int>(it - m_searchMatches.cbegin()) - 1;
+    selectSearchMatch(index < 0 ? m_searchMatches.size() - 1 : index);
+}
+
+/*!
+ * \brief NoteEditorLogic::updateSearchMatches
+ * Offsets of the search text in the editor, found in a single pass over
+ * the document text. They are kept until the search text or the document
+ * changes.
+ * \return false if there's nothing to search for
+ */
+bool NoteEditorLogic::updateSearchMatches()
+{
+    auto searchText = m_searchEdit->text();
+    auto document = m_textEdit->document();
+    if (searchText.isEmpty()) {
+        m_searchText.clear();
+        m_searchMatches.clear();
+        return false;
+    }
+    if (searchText == m_searchText && document == m_searchDocument && document->revision() == m_searchDocumentRevision) {
+        return true;
+    }
+    m_searchText = searchText;
+    m_searchDocument = document;
+    m_searchDocumentRevision = document->revision();
+    m_searchMatches.clear();
+    m_firstSelectedMatch = -1;
+    m_lastSelectedMatch = -1;
+    // same matches as QTextDocument::find(): case insensitive, not overlapping
+    auto text = document->toPlainText();
+    QStringMatcher matcher(searchText, Qt::CaseInsensitive);
+    for (auto from = matcher.indexIn(text, 0); from != -1; from = matcher.indexIn(text, from + searchText.size())) {
+        m_searchMatches.append(static_cast<int>(from));
+    }
+    return true;
+}
+
+/*!
+ * \brief NoteEditorLogic::updateSearchSelections
+ * Highlight the search matches in and around the viewport
+ */
+void NoteEditorLogic::updateSearchSelections()
+{
+    if (!updateSearchMatches() || m_searchMatches.isEmpty()) {
+        if (m_firstSelectedMatch != -1 || !m_textEdit->extraSelections().isEmpty()) {
+            m_firstSelectedMatch = -1;
+            m_lastSelectedMatch = -1;
+            m_textEdit->setExtraSelections({});
+        }
+        return;
+    }
+    auto viewport = m_textEdit->viewport()->rect();
+    int margin = viewport.height() * SEARCH_SELECTION_VIEWPORT_MARGIN;
+    int from = m_textEdit->cursorForPosition(QPoint(0, -margin)).position();
+    int to = m_textEdit->cursorForPosition(QPoint(viewport.width(), viewport.height() + margin)).position();
+    auto first = std::lower_bound(m_searchMatches.cbegin(), m_searchMatches.cend(), from - m_searchText.size());
+    auto last = std::upper_bound(first, m_searchMatches.cend(), to);
+    int firstIndex = static_cast<int>(first - m_searchMatches.cbegin());
+    int lastIndex = std::min(static_cast<int>(last - m_searchMatches.cbegin()), firstIndex + SEARCH_SELECTION_MAX);
+    if (firstIndex == m_firstSelectedMatch && lastIndex == m_lastSelectedMatch) {
+        return;
+    }
+    m_firstSelectedMatch = firstIndex;
+    m_lastSelectedMatch = lastIndex;
 
     QList<QTextEdit::ExtraSelection> extraSelections;
     QTextCharFormat highlightFormat;
     highlightFormat.setBackground(Qt::yellow);
-
-    while (m_textEdit->find(searchString))
-        extraSelections.append({ m_textEdit->textCursor(), highlightFormat });
-
-    if (!extraSelections.isEmpty()) {
-        m_textEdit->setTextCursor(extraSelections.first().cursor);
-        m_textEdit->setExtraSelections(extraSelections);
+    for (int i = firstIndex; i < lastIndex; ++i) {
+        QTextCursor cursor(m_searchDocument);
+        cursor.setPosition(m_searchMatches[i]);
+        cursor.setPosition(m_searchMatches[i] + m_searchText.size(), QTextCursor::KeepAnchor);
+        extraSelections.append({ cursor, highlightFormat });
     }
+    m_textEdit->setExtraSelections(extraSelections);
+}
+
+void NoteEditorLogic::selectSearchMatch(int index)
+{
+    QTextCursor cursor(m_searchDocument);
+    cursor.setPosition(m_searchMatches[index]);
+    cursor.setPosition(m_searchMatches[index] + m_searchText.size(), QTextCursor::KeepAnchor);
+    m_textEdit->setTextCursor(cursor);
 }
 
 bool NoteEditorLogic::isTempNote() const
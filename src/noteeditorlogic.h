@@ -8,8 +8,6 @@
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
 #  include <QWidget>
 #  include <QVariant>
-#  include <QJsonArray>
-#  include <QJsonObject>
 #  include <QRegularExpression>
 #endif
 
@@ -18,6 +16,9 @@
 
 class CustomDocument;
 class CustomMarkdownHighlighter;
+class MarkdownBlockData;
+class QTextBlock;
+class QTextDocument;
 class QLabel;
 class QLineEdit;
 class DBManager;
@@ -26,13 +27,29 @@ class TagListModel;
 class TagPool;
 class TagListDelegate;
 class QListWidget;
+class KanbanColumnModel;
+struct KanbanColumn;
+struct KanbanTask;
+
+struct NoteDocumentCacheEntry
+{
+    int noteId;
+    qint64 revision;
+    QTextDocument *document;
+    CustomMarkdownHighlighter *highlighter;
+    int cursorPosition;
+    int cursorAnchor;
+    qint64 estimatedSize;
+};
+
 class NoteEditorLogic : public QObject
 {
     Q_OBJECT
 public:
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-    explicit NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLabel, QLineEdit *searchEdit, QWidget *kanbanWidget, TagListView *tagListView,
-                             TagPool *tagPool, DBManager *dbManager, QObject *parent = nullptr);
+    explicit NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLabel, QLineEdit *searchEdit, QWidget *kanbanWidget,
+                             KanbanColumnModel *kanbanColumnModel, TagListView *tagListView, TagPool *tagPool, DBManager *dbManager,
+                             QObject *parent = nullptr);
 
 #else
     explicit NoteEditorLogic(CustomDocument *textEdit, QLabel *editorDateLabel, QLineEdit *searchEdit, TagListView *tagListView, TagPool *tagPool,
@@ -42,7 +59,9 @@ public:
     bool markdownEnabled() const;
     void setMarkdownEnabled(bool enabled);
     static QString getNoteDateEditor(const QString &dateEdited);
-    void highlightSearch() const;
+    void highlightSearch();
+    void findNextSearchMatch();
+    void findPreviousSearchMatch();
     bool isTempNote() const;
     void saveNoteToDB();
     int currentEditingNoteId() const;
@@ -59,11 +78,16 @@ public:
     int currentMinimumEditorPadding() const;
     void setCurrentMinimumEditorPadding(int newCurrentMinimumEditorPadding);
 
+    int documentCacheHits() const;
+    int documentCacheMisses() const;
+
 public slots:
     void showNotesInEditor(const QVector<NodeData> &notes);
     void onTextEditTextChanged();
+    void onTextEditContentsChange(int position, int charsRemoved, int charsAdded);
     void closeEditor();
     void onNoteTagListChanged(int noteId, const QSet<int> &tagIds);
+    void onNoteContentReplaced(const NodeData &note);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
     bool checkForTasksInEditor();
     void rearrangeTasksInTextEditor(int startLinePosition, int endLinePosition, int newLinePosition);
@@ -90,7 +114,7 @@ signals:
     void textShown();
     void kanbanShown();
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
-    void tasksFoundInEditor(QVariant data);
+    void tasksFoundInEditor();
     void clearKanbanModel();
     void resetKanbanSettings();
     void checkMultipleNotesSelected(QVariant isMultipleNotesSelected);
@@ -104,8 +128,28 @@ private:
     QMap<QString, int> getTaskDataInLine(const QString &line);
     void replaceTextBetweenLines(int startLinePosition, int endLinePosition, QString &newText);
     void removeTextBetweenLines(int startLinePosition, int endLinePosition);
-    void appendNewColumn(QJsonArray &data, QJsonObject &currentColumn, QString &currentTitle, QJsonArray &tasks);
+    void invalidateTaskBlocks(int position, int charsAdded);
+    MarkdownBlockData *taskBlockData(QTextBlock &block);
+    void appendNewColumn(QVector<KanbanColumn> &columns, int columnStartLine, QString &currentTitle, QVector<KanbanTask> &tasks);
     void addUntitledColumnToTextEditor(int startLinePosition);
+    void updateCurrentNoteTitle();
+    void flushCurrentNoteContent();
+    void addSeparatorResource();
+    bool swapInNoteDocument(const NodeData &note);
+    void showDefaultDocument();
+    void setEditorDocument(QTextDocument *document, CustomMarkdownHighlighter *highlighter);
+    void storeCurrentNoteDocumentState();
+    void removeNoteDocumentAt(int index);
+    void removeNoteDocument(int noteId);
+    void clearInactiveNoteDocuments();
+    void trimDocumentCache();
+    bool isMultiNotePreview() const;
+    int insertPreviewSegment(int noteIndex, int position);
+    void removePreviewSegment(bool isFirst);
+    void updateMultiNotePreviewWindow();
+    bool updateSearchMatches();
+    void updateSearchSelections();
+    void selectSearchMatch(int index);
 
 private:
     CustomDocument *m_textEdit;
@@ -114,6 +158,7 @@ private:
     QLineEdit *m_searchEdit;
 #if QT_VERSION >= QT_VERSION_CHECK(6, 2, 0)
     QWidget *m_kanbanWidget;
+    KanbanColumnModel *m_kanbanColumnModel;
 #endif
     TagListView *m_tagListView;
     DBManager *m_dbManager;
@@ -125,6 +170,29 @@ private:
     QColor m_spacerColor;
     int m_currentAdaptableEditorPadding;
     int m_currentMinimumEditorPadding;
+    bool m_isNoteTextStale;
+    bool m_hasPendingTextChange;
+    int m_pendingChangePosition;
+    int m_titleEndPosition;
+    QTextDocument *m_defaultDocument;
+    CustomMarkdownHighlighter *m_defaultHighlighter;
+    QList<NoteDocumentCacheEntry> m_documentCache;
+    int m_documentCacheHits;
+    int m_documentCacheMisses;
+    bool m_hasTheme;
+    Theme::Value m_theme;
+    QColor m_textColor;
+    qreal m_fontSize;
+    int m_previewFirstNote;
+    QList<int> m_previewSegmentLengths;
+    int m_previewCharacterCount;
+    bool m_isUpdatingPreview;
+    QString m_searchText;
+    QTextDocument *m_searchDocument;
+    int m_searchDocumentRevision;
+    QVector<int> m_searchMatches;
+    int m_firstSelectedMatch;
+    int m_lastSelectedMatch;
 };
 
 #endif // NOTEEDITORLOGIC_H
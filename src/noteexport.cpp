@@ -0,0 +1,143 @@
+#include "noteexport.h"
+#include "markdowntext.h"
+#include "nodepath.h"
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace {
+// Longest file name, in characters, an exported note gets before its
+// extension and de-duplication suffix
+constexpr int EXPORT_FILE_NAME_MAX_LENGTH = 200;
+} // namespace
+
+QString ExportNames::unique(const QString &directory, const QString &name, const QString &extension)
+{
+    QString key = QStringLiteral("%1/%2").arg(directory, name).toCaseFolded();
+    QString fileName = name + extension;
+    if (m_used.contains(key + extension.toCaseFolded())) {
+        int &suffix = m_nextSuffixes[key];
+        do {
+            fileName = QStringLiteral("%1 %2%3").arg(name, QString::number(++suffix), extension);
+        } while (m_used.contains(QStringLiteral("%1/%2").arg(directory, fileName).toCaseFolded()));
+    }
+    m_used.insert(QStringLiteral("%1/%2").arg(directory, fileName).toCaseFolded());
+    return fileName;
+}
+
+void ExportNames::reserve(const QString &directory, const QString &fileName)
+{
+    m_used.insert(QStringLiteral("%1/%2").arg(directory, fileName).toCaseFolded());
+}
+
+QString exportFileName(const QString &title)
+{
+    QString name = title;
+    if (name.contains(QStringLiteral("<br />"))) {
+        name = name.section(QStringLiteral("<br />"), 0, 0, QString::SectionSkipEmpty);
+    }
+    name = MarkdownText::inlineToPlainText(name.simplified());
+    for (auto &c : name) {
+        if (c.unicode() < 0x20 || c == u'/' || c == u'\\' || c == u':' || c == u'*' || c == u'?' || c == u'"' || c == u'<' || c == u'>'
+            || c == u'|') {
+            c = u'_';
+        }
+    }
+    name.truncate(EXPORT_FILE_NAME_MAX_LENGTH);
+    if (name.isEmpty()) {
+        name = QStringLiteral("Untitled Note");
+    }
+    return name;
+}
+
+QHash<int, QString> folderExportPaths(QVector<NodeData> folders, ExportNames &names)
+{
+    std::sort(folders.begin(), folders.end(), [](const NodeData &a, const NodeData &b) {
+        return a.absolutePath().count(PATH_SEPARATOR) < b.absolutePath().count(PATH_SEPARATOR);
+    });
+    QHash<int, QString> folderPaths;
+    folderPaths[ROOT_FOLDER_ID] = QString();
+    for (const auto &folder : std::as_const(folders)) {
+        if (folder.id() == ROOT_FOLDER_ID || !folderPaths.contains(folder.parentId())) {
+            continue;
+        }
+        const QString &parentPath = folderPaths[folder.parentId()];
+        QString name = names.unique(parentPath, exportFileName(folder.fullTitle()), QString());
+        folderPaths[folder.id()] = parentPath.isEmpty() ? name : parentPath + u'/' + name;
+    }
+    return folderPaths;
+}
+
+bool isExportManifestPathValid(const QDir &directory, const QString &filePath)
+{
+    if (filePath.isEmpty() || QDir::isAbsolutePath(filePath) || filePath == QString::fromLatin1(EXPORT_MANIFEST_FILE_NAME)) {
+        return false;
+    }
+    QString directoryPath = QDir::cleanPath(directory.absolutePath());
+    QString resolvedPath = QDir::cleanPath(directory.absoluteFilePath(filePath));
+    return resolvedPath.startsWith(directoryPath + u'/') && directory.relativeFilePath(resolvedPath) == filePath;
+}
+
+QHash<int, ExportManifestEntry> readExportManifest(const QDir &directory, const QString &manifestPath)
+{
+    QHash<int, ExportManifestEntry> manifest;
+    QFile file(manifestPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return manifest;
+    }
+    const auto root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != EXPORT_MANIFEST_VERSION) {
+        return manifest;
+    }
+    const auto notes = root.value("notes").toArray();
+    manifest.reserve(notes.size());
+    for (const auto &value : notes) {
+        auto note = value.toObject();
+        if (!isExportManifestPathValid(directory, note.value("path").toString())) {
+            qDebug() << __FUNCTION__ << __LINE__ << "Ignoring manifest path" << note.value("path").toString();
+            continue;
+        }
+        manifest.insert(note.value("id").toInt(),
+                        { note.value("modificationDate").toVariant().toLongLong(), QByteArray::fromHex(note.value("hash").toString().toLatin1()),
+                          note.value("path").toString() });
+    }
+    return manifest;
+}
+
+void reserveUnmanagedFiles(const QDir &directory, const QHash<int, ExportManifestEntry> &manifest, ExportNames &names)
+{
+    QSet<QString> managedFilePaths;
+    for (const auto &entry : manifest) {
+        managedFilePaths.insert(entry.filePath.toCaseFolded());
+    }
+    QDirIterator it(directory.path(), QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString filePath = directory.relativeFilePath(it.next());
+        if (!managedFilePaths.contains(filePath.toCaseFolded())) {
+            names.reserve(filePath.section(u'/', 0, -2), filePath.section(u'/', -1));
+        }
+    }
+}
+
+bool writeExportManifest(const QString &manifestPath, const QHash<int, ExportManifestEntry> &manifest)
+{
+    QJsonArray notes;
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        notes.append(QJsonObject{ { "id", it.key() },
+                                  { "modificationDate", it->modificationDate },
+                                  { "hash", QString::fromLatin1(it->contentHash.toHex()) },
+                                  { "path", it->filePath } });
+    }
+    QSaveFile file(manifestPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{ { "version", EXPORT_MANIFEST_VERSION }, { "notes", notes } }).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
@@ -0,0 +1,98 @@
+#ifndef NOTEEXPORT_H
+#define NOTEEXPORT_H
+
+#include "nodedata.h"
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+class QDir;
+
+// Kept in the directory of an incremental export, with what was written
+// there for each note
+auto constexpr EXPORT_MANIFEST_FILE_NAME = ".notes-export.json";
+auto constexpr EXPORT_MANIFEST_VERSION = 1;
+
+struct ExportManifestEntry
+{
+    qint64 modificationDate;
+    QByteArray contentHash;
+    // Relative to the export directory, with '/' separators
+    QString filePath;
+};
+
+/*!
+ * \brief The ExportNames class
+ * Names given out so far in each exported directory. Names are compared
+ * case-insensitively, for case-insensitive file systems, and a taken name
+ * gets the first free " 1", " 2"... suffix without probing the file system.
+ */
+class ExportNames
+{
+public:
+    QString unique(const QString &directory, const QString &name, const QString &extension);
+    void reserve(const QString &directory, const QString &fileName);
+
+private:
+    QSet<QString> m_used;
+    QHash<QString, int> m_nextSuffixes;
+};
+
+/*!
+ * \brief exportFileName
+ * File name for a note or folder title: its first line as plain text, with
+ * the characters file systems don't allow replaced by '_'
+ * \param title
+ */
+QString exportFileName(const QString &title);
+
+/*!
+ * \brief folderExportPaths
+ * Path of every folder relative to the export directory, built from the
+ * titles of its ancestors in one pass over the folders, parents first
+ * \param folders
+ * \param names
+ */
+QHash<int, QString> folderExportPaths(QVector<NodeData> folders, ExportNames &names);
+
+/*!
+ * \brief isExportManifestPathValid
+ * Whether a path read from a manifest names a file inside the export
+ * directory. The manifest is only a file in that directory, a hand-edited
+ * or foreign one mustn't make the export delete files anywhere else.
+ * \param directory
+ * \param filePath
+ */
+bool isExportManifestPathValid(const QDir &directory, const QString &filePath);
+
+/*!
+ * \brief readExportManifest
+ * Entries of the manifest by note id, without those whose path isn't valid.
+ * A missing manifest, or one of another version, has no entries.
+ * \param directory
+ * \param manifestPath
+ */
+QHash<int, ExportManifestEntry> readExportManifest(const QDir &directory, const QString &manifestPath);
+
+/*!
+ * \brief reserveUnmanagedFiles
+ * Reserve the name of every file already in the export directory that the
+ * manifest doesn't account for, so that notes are never written over files
+ * the export didn't create, as on the first export to a directory
+ * \param directory
+ * \param manifest
+ * \param names
+ */
+void reserveUnmanagedFiles(const QDir &directory, const QHash<int, ExportManifestEntry> &manifest, ExportNames &names);
+
+/*!
+ * \brief writeExportManifest
+ * \param manifestPath
+ * \param manifest
+ * \return false if the manifest couldn't be saved, the previous one is kept then
+ */
+bool writeExportManifest(const QString &manifestPath, const QHash<int, ExportManifestEntry> &manifest);
+
+#endif // NOTEEXPORT_H
@@ -14,7 +14,7 @@ Item {
     property int textAndTodosSpacing: 20
     property int todoColumnWidth: 250
     property int marginsSize: 10
-    property var titlesAndTasksData
+    property var columnModel: kanbanColumnModel
     property var themeData: {"theme": "Light", "backgroundColor": "#f7f7f7"}
     property bool areTasksReversed: false
     property bool showSettingsPopup: false
@@ -31,8 +31,6 @@ Item {
     property string bodyFontFamily: "Avenir Next"
     property string displayFontFamily: "Roboto"
     property bool showColumnsBorders: false
-    property int newTaskInColumnID: -1
-    property var taskModelByColumnIDDict: ({})
     property string platform: ""
     property bool showEditorSettings: false
     property int pointSizeOffset: -4
@@ -49,136 +47,21 @@ Item {
     Material.theme: themeData.theme === "Dark" ? Material.Dark : Material.Light
     Material.accent: "#2383e2";
 
-    function reverseTasksData () {
-        for (let i = 0; i < titlesAndTasksData.length; i++) {
-            titlesAndTasksData[i].tasks.reverse();
-        }
-    }
-
     function toggleReverseTasks () {
-        root.reverseTasksData();
         root.areTasksReversed = !root.areTasksReversed;
-        columnModel.clear();
-        root.updateColumnModel();
-    }
-
-    function updateColumnModel() {
-        // Add columns and tasks
-        if (columnModel.count === 0) {
-            root.totalTasks = 0;
-            root.totalCompletedTasks = 0;
-
-            for (let i = 0; i < root.titlesAndTasksData.length; i++) {
-                root.totalTasks += root.titlesAndTasksData[i].tasks.length;
-                columnModel.append({"title": root.titlesAndTasksData[i].title, "columnID": i,
-                                       "columnStartLine": root.titlesAndTasksData[i].columnStartLine,
-                                       "columnEndLine": root.titlesAndTasksData[i].columnEndLine});
-            }
-
-            for (var n = 0; n < taskModelsRepeater.count; n++) {
-                root.titlesAndTasksData[n].tasks.forEach(taskData => {
-
-                                                             if (taskData.checked) {
-                                                                 root.totalCompletedTasks++;
-                                                             }
-
-                                                             taskModelsRepeater.itemAt(n).taskModel.append({"taskText": taskData.text, "taskChecked": taskData.checked,
-                                                                                                               "taskStartLine": taskData.taskStartLine,
-                                                                                                               "taskEndLine": taskData.taskEndLine,
-                                                                                                               "doNeedAnimateTaskCreation": false});
-                                                         });
-            }
-        } else {
-            // Update colums and tasks
-            for (let k = 0; k < root.titlesAndTasksData.length; k++) {
-                if (root.titlesAndTasksData[k]) {
-                    columnModel.set(k, {"columnStartLine": root.titlesAndTasksData[k].columnStartLine,
-                                        "columnEndLine": root.titlesAndTasksData[k].columnEndLine});
-
-                    var taskIndex = 0;
-                    var colID = columnModel.get(k).columnID;
-                    var tasksLength = root.titlesAndTasksData[k].tasks.length;
-
-                    root.titlesAndTasksData[k].tasks.forEach(taskData => {
-
-                                                                 var animateNoteCreation = false;
-                                                                 if (root.newTaskInColumnID === colID && taskIndex === tasksLength-1) {
-                                                                     root.newTaskInColumnID = -1;
-                                                                     animateNoteCreation = true;
-                                                                 }
-
-
-                                                                 root.taskModelByColumnIDDict[colID].set(taskIndex, {  "taskText": taskData.text, "doNeedAnimateTaskCreation": animateNoteCreation ? true : false,
-                                                                                                             "taskChecked": taskData.checked,
-                                                                                                             "taskStartLine": taskData.taskStartLine,
-                                                                                                             "taskEndLine": taskData.taskEndLine});
-
-                                                                 taskIndex++;
-
-                                                             });
-                }
-            }
-        }
+        columnModel.setTasksReversed(root.areTasksReversed);
     }
 
     FontIconLoader {
         id: fontIconLoader
     }
 
-    ListModel {
-        id: columnModel
-
-        function getNewColumnID() {
-            var previousLargest = -1;
-            for (let i = 0; i < columnModel.count; i++) {
-                if (columnModel.get(i).columnID > previousLargest) {
-                    previousLargest = columnModel.get(i).columnID;
-                }
-            }
-
-            return previousLargest + 1;
-        }
-    }
-
-    Repeater {
-        id: taskModelsRepeater
-        model: columnModel
-
-        // We replaced this with root.taskModelByColumnIDDict
-        function getTaskModelByColumnID (columnID: int) {
-            for (let i = 0; i < taskModelsRepeater.count; i++) {
-                if (taskModelsRepeater.itemAt(i).columnID === columnID) {
-                    return taskModelsRepeater.itemAt(i).taskModel;
-                }
-            }
-        }
-
-        delegate: Item {
-            property alias taskModel: taskModelChild
-            required property int columnID
-            ListModel {
-                id: taskModelChild
-            }
-        }
-
-        onItemAdded: (index, item) => {
-                         root.taskModelByColumnIDDict[item.columnID] = item.taskModel;
-                     }
-
-        onItemRemoved: (index, item) => {
-                           delete root.taskModelByColumnIDDict[item.columID];
-                       }
-    }
-
     Connections {
         target: noteEditorLogic
 
-        function onTasksFoundInEditor (data) {
-            root.titlesAndTasksData = data;
-            if (root.areTasksReversed) {
-                root.reverseTasksData();
-            }
-            root.updateColumnModel();
+        function onTasksFoundInEditor () {
+            root.totalTasks = columnModel.taskCount();
+            root.totalCompletedTasks = columnModel.completedTaskCount();
             root.showSettingsPopup = false;
 
             if (root.isMultipleNotesSelected && root.isForcedReadOnly) {
@@ -194,6 +77,7 @@ Item {
 
         function onResetKanbanSettings () {
             root.areTasksReversed = false;
+            columnModel.setTasksReversed(false);
         }
 
         function onCheckMultipleNotesSelected (isMultipleNotesSelected) {
@@ -260,15 +144,15 @@ Item {
     }
 
     function rearrangeTasks (startLinePosition: int, endLinePosition: int, newLinePosition: int, columnInsertingIntoID, taskIndexToInsert, columnRemovingFromID, taskIndexToRemove, objectToInsert) {
-        root.taskModelByColumnIDDict[columnInsertingIntoID].insert(taskIndexToInsert, objectToInsert);
+        columnModel.taskModel(columnInsertingIntoID).insert(taskIndexToInsert, objectToInsert);
 
         if (columnInsertingIntoID === columnRemovingFromID && taskIndexToRemove > taskIndexToInsert) {
-            root.taskModelByColumnIDDict[columnRemovingFromID].remove(taskIndexToRemove + 1);
+            columnModel.taskModel(columnRemovingFromID).remove(taskIndexToRemove + 1);
         } else {
-            root.taskModelByColumnIDDict[columnRemovingFromID].remove(taskIndexToRemove);
+            columnModel.taskModel(columnRemovingFromID).remove(taskIndexToRemove);
         }
 
-        if (root.taskModelByColumnIDDict[columnRemovingFromID].count === 0) {
+        if (columnModel.taskModel(columnRemovingFromID).count === 0) {
             for (let i = 0; i < columnModel.count; i++) {
                 if (columnModel.get(i).columnID === columnRemovingFromID) {
                     columnModel.remove(i);
@@ -298,15 +182,15 @@ Item {
 
     function addNewTask (endLinePosition: int, columnID: int, newTaskText: string) {
         root.totalTasks++;
-        root.newTaskInColumnID = columnID;
-        root.taskModelByColumnIDDict[columnID].insert(root.taskModelByColumnIDDict[columnID].count, {"taskText": newTaskText, "taskStartLine:": endLinePosition, "taskEndLine": endLinePosition, "taskChecked": false, "doNeedAnimateTaskCreation": true})
+        let taskModel = columnModel.taskModel(columnID);
+        taskModel.insert(taskModel.count, {"taskText": newTaskText, "taskStartLine": endLinePosition, "taskEndLine": endLinePosition, "taskChecked": false, "doNeedAnimateTaskCreation": true})
         noteEditorLogic.addNewTask(endLinePosition, newTaskText);
     }
 
     function removeTask (startLinePosition: int, endLinePosition: int, columnRemovingFromID, taskIndex) {
-        root.taskModelByColumnIDDict[columnRemovingFromID].remove(taskIndex);
+        columnModel.taskModel(columnRemovingFromID).remove(taskIndex);
 
-        if (root.taskModelByColumnIDDict[columnRemovingFromID].count === 0) {
+        if (columnModel.taskModel(columnRemovingFromID).count === 0) {
             for (let i = 0; i < columnModel.count; i++) {
                 if (columnModel.get(i).columnID === columnRemovingFromID) {
                     columnModel.remove(i);
@@ -349,7 +233,7 @@ Item {
     }
 
     function removeColumn (startLinePosition: int, endLinePosition: int, columnRemovingID: int) {
-        var taskModelOfColumn = root.taskModelByColumnIDDict[columnRemovingID];
+        var taskModelOfColumn = columnModel.taskModel(columnRemovingID);
 
         root.totalTasks -= taskModelOfColumn.count;
 
@@ -373,8 +257,8 @@ Item {
     }
 
     function reRenderTask(columnID, taskIndex, taskObject) {
-        root.taskModelByColumnIDDict[columnID].remove(taskIndex);
-        root.taskModelByColumnIDDict[columnID].insert(taskIndex, taskObject);
+        columnModel.taskModel(columnID).remove(taskIndex);
+        columnModel.taskModel(columnID).insert(taskIndex, taskObject);
     }
 
     SubscriptionWindow {
@@ -463,11 +347,10 @@ Item {
                     rootContainer: root
                     rootTodoContainer: todosContainer
                     todosColumnsViewPointerFromColumn: todosColumnsView
-                    titlesAndTasksData: root.titlesAndTasksData
                     themeData: root.themeData
                     areTasksReversed: root.areTasksReversed
                     columnModelPointer: columnModel
-                    taskModel: root.taskModelByColumnIDDict[columnID]
+                    taskModel: columnModel.taskModel(columnID)
                 }
             }
 
@@ -7,6 +7,7 @@
 #include <QMetaObject>
 #include <QMessageBox>
 #include <QColorDialog>
+#include <QItemSelectionModel>
 #include <random>
 #include <QApplication>
 #include "customapplicationstyle.h"
@@ -54,6 +55,14 @@ TreeViewLogic::TreeViewLogic(NodeTreeView *treeView, NodeTreeModel *treeModel, D
     connect(m_treeModel, &NodeTreeModel::requestMoveFolderToTrash, this, &TreeViewLogic::onDeleteFolderRequested);
     connect(m_dbManager, &DBManager::childNotesCountUpdatedFolder, this, &TreeViewLogic::onChildNoteCountChangedFolder);
     connect(m_dbManager, &DBManager::childNotesCountUpdatedTag, this, &TreeViewLogic::onChildNotesCountChangedTag);
+    connect(m_dbManager, &DBManager::folderAdded, this, &TreeViewLogic::onFolderAdded, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::folderRemoved, this, &TreeViewLogic::onFolderRemoved, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::folderMoved, this, &TreeViewLogic::onFolderMoved, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::folderRenamed, this, &TreeViewLogic::onFolderRenamed, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagAdded, this, &TreeViewLogic::onTagAdded, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagRemoved, this, &TreeViewLogic::onTagRemoved, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagRenamed, this, &TreeViewLogic::onTagRenamed, Qt::QueuedConnection);
+    connect(m_dbManager, &DBManager::tagColorChanged, this, &TreeViewLogic::onTagColorChanged, Qt::QueuedConnection);
     m_style = new CustomApplicationStyle();
     qApp->setStyle(m_style);
 }
@@ -304,19 +313,96 @@ void TreeViewLogic::onChildNotesCountChangedTag(int tagId, int notesCount)
 
 void TreeViewLogic::onChildNoteCountChangedFolder(int folderId, const QString &absPath, int notesCount)
 {
+    Q_UNUSED(absPath);
     QModelIndex index;
     if (folderId == ROOT_FOLDER_ID) {
         index = m_treeModel->getAllNotesButtonIndex();
     } else if (folderId == TRASH_FOLDER_ID) {
         index = m_treeModel->getTrashButtonIndex();
     } else {
-        index = m_treeModel->folderIndexFromIdPath(absPath);
+        // folders that haven't been expanded yet only keep the count
+        m_treeModel->setFolderChildNotesCount(folderId, notesCount);
+        return;
     }
     if (index.isValid()) {
         m_treeModel->setData(index, notesCount, NodeItem::Roles::ChildCount);
     }
 }
 
+// The handlers below apply changes made directly in the database (imports,
+// restores) to the tree in place. Changes started from the tree itself are
+// already in the model when they arrive, so every handler has to be a no-op
+// in that case.
+void TreeViewLogic::onFolderAdded(const NodeData &folder)
+{
+    m_treeModel->addFolderNode(folder);
+}
+
+void TreeViewLogic::onFolderRemoved(int folderId)
+{
+    auto index = m_treeModel->folderIndexFromId(folderId);
+    if (!index.isValid()) {
+        return;
+    }
+    auto absPath = index.data(NodeItem::Roles::AbsPath).toString();
+    auto currentIndex = m_treeView->currentIndex();
+    auto currentType = static_cast<NodeItem::Type>(currentIndex.data(NodeItem::Roles::ItemType).toInt());
+    auto currentAbsPath = currentIndex.data(NodeItem::Roles::AbsPath).toString();
+    bool isCurrentRemoved = currentType == NodeItem::Type::FolderItem
+            && (currentAbsPath == absPath || currentAbsPath.startsWith(absPath + PATH_SEPARATOR));
+    m_treeModel->removeFolderNode(folderId);
+    if (isCurrentRemoved) {
+        m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+    }
+}
+
+void TreeViewLogic::onFolderMoved(int folderId, int parentId)
+{
+    m_treeModel->moveFolderNode(folderId, parentId);
+}
+
+void TreeViewLogic::onFolderRenamed(int folderId, const QString &newName)
+{
+    auto index = m_treeModel->folderIndexFromId(folderId);
+    if (index.isValid() && index.data(NodeItem::Roles::DisplayText).toString() != newName) {
+        m_treeModel->setData(index, newName, NodeItem::Roles::DisplayText);
+    }
+}
+
+void TreeViewLogic::onTagAdded(const TagData &tag)
+{
+    m_treeModel->addTagNode(tag);
+}
+
+void TreeViewLogic::onTagRemoved(int tagId)
+{
+    auto index = m_treeModel->tagIndexFromId(tagId);
+    if (!index.isValid()) {
+        return;
+    }
+    bool isSelected = m_treeView->selectionModel()->isSelected(index);
+    m_treeModel->removeTagNode(tagId);
+    if (isSelected) {
+        m_treeView->setCurrentIndexC(m_treeModel->getAllNotesButtonIndex());
+    }
+}
+
+void TreeViewLogic::onTagRenamed(int tagId, const QString &newName)
+{
+    auto index = m_treeModel->tagIndexFromId(tagId);
+    if (index.isValid() && index.data(NodeItem::Roles::DisplayText).toString() != newName) {
+        m_treeModel->setData(index, newName, NodeItem::Roles::DisplayText);
+    }
+}
+
+void TreeViewLogic::onTagColorChanged(int tagId, const QString &newColor)
+{
+    auto index = m_treeModel->tagIndexFromId(tagId);
+    if (index.isValid() && index.data(NodeItem::Roles::TagColor).toString() != newColor) {
+        m_treeModel->setData(index, newColor, NodeItem::Roles::TagColor);
+    }
+}
+
 void TreeViewLogic::openFolder(int id)
 {
     NodeData target;
@@ -32,6 +32,14 @@ private slots:
     void onDeleteTagRequested(const QModelIndex &index);
     void onChildNotesCountChangedTag(int tagId, int notesCount);
     void onChildNoteCountChangedFolder(int folderId, const QString &absPath, int notesCount);
+    void onFolderAdded(const NodeData &folder);
+    void onFolderRemoved(int folderId);
+    void onFolderMoved(int folderId, int parentId);
+    void onFolderRenamed(int folderId, const QString &newName);
+    void onTagAdded(const TagData &tag);
+    void onTagRemoved(int tagId);
+    void onTagRenamed(int tagId, const QString &newName);
+    void onTagColorChanged(int tagId, const QString &newColor);
 
 signals:
     void requestRenameNodeInDB(int id, const QString &newName);
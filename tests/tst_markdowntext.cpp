@@ -0,0 +1,99 @@
+#include "tst_markdowntext.h"
+#include "markdowntext.h"
+#include <QTextDocument>
+
+namespace {
+/*!
+ * What QTextDocument makes of a line of Markdown. Images become an object
+ * replacement character there, where inlineToPlainText() keeps their alt
+ * text, given as imageText.
+ */
+QString documentPlainText(const QString &markdown, const QString &imageText = QString())
+{
+    QTextDocument document;
+    document.setMarkdown(markdown);
+    QString text = document.toPlainText();
+    text.replace(QChar::ObjectReplacementCharacter, imageText);
+    return text.trimmed();
+}
+} // namespace
+
+tst_MarkdownText::tst_MarkdownText() { }
+
+void tst_MarkdownText::inlineToPlainText_data()
+{
+    QTest::addColumn<QString>("markdown");
+    QTest::addColumn<QString>("imageText");
+
+    QTest::newRow("plain") << QStringLiteral("Just a title") << QString();
+    QTest::newRow("heading") << QStringLiteral("## Heading ##") << QString();
+    QTest::newRow("list item") << QStringLiteral("- item") << QString();
+    QTest::newRow("ordered list item") << QStringLiteral("1. first") << QString();
+    QTest::newRow("task") << QStringLiteral("- [x] done task") << QString();
+    QTest::newRow("block quote") << QStringLiteral("> quoted") << QString();
+
+    QTest::newRow("strong") << QStringLiteral("some **bold** text") << QString();
+    QTest::newRow("emphasis") << QStringLiteral("some *italic* and _italic_ text") << QString();
+    QTest::newRow("nested emphasis") << QStringLiteral("***both*** and **bold *italic***") << QString();
+    QTest::newRow("intraword underscore") << QStringLiteral("snake_case_name") << QString();
+    QTest::newRow("unmatched delimiter") << QStringLiteral("2 * 3 = 6") << QString();
+    QTest::newRow("strikethrough") << QStringLiteral("~~gone~~ here") << QString();
+
+    QTest::newRow("code span") << QStringLiteral("call `foo()` now") << QString();
+    QTest::newRow("code span with backtick") << QStringLiteral("`` a ` b ``") << QString();
+    QTest::newRow("emphasis in code span") << QStringLiteral("`**not bold**`") << QString();
+    QTest::newRow("unclosed code span") << QStringLiteral("``open `code") << QString();
+
+    QTest::newRow("link") << QStringLiteral("see [the docs](https://example.com \"Docs\")") << QString();
+    QTest::newRow("emphasis in link") << QStringLiteral("[**bold** link](url)") << QString();
+    QTest::newRow("autolink") << QStringLiteral("<https://example.com>") << QString();
+    QTest::newRow("email autolink") << QStringLiteral("mail <me@example.com>") << QString();
+    QTest::newRow("brackets") << QStringLiteral("[not a link] (here)") << QString();
+
+    QTest::newRow("image") << QStringLiteral("![alt text](image.png)") << QStringLiteral("alt text");
+    QTest::newRow("image in text") << QStringLiteral("before ![icon](icon.svg) after") << QStringLiteral("icon");
+
+    QTest::newRow("escapes") << QStringLiteral("\\*not emphasis\\* \\[no link\\]") << QString();
+    QTest::newRow("entities") << QStringLiteral("a &amp; b &lt;c&gt; &#35; &#x41;") << QString();
+    QTest::newRow("not an entity") << QStringLiteral("AT&T") << QString();
+
+    QTest::newRow("html tag") << QStringLiteral("a <b>bold</b> word") << QString();
+    QTest::newRow("html with attributes") << QStringLiteral("<span style=\"color:red\">red</span> text") << QString();
+    QTest::newRow("less than") << QStringLiteral("1 < 2") << QString();
+}
+
+void tst_MarkdownText::inlineToPlainText()
+{
+    QFETCH(QString, markdown);
+    QFETCH(QString, imageText);
+
+    QCOMPARE(MarkdownText::inlineToPlainText(markdown), documentPlainText(markdown, imageText));
+}
+
+void tst_MarkdownText::benchmarkInlineToPlainText_data()
+{
+    QTest::addColumn<bool>("isUsingDocument");
+
+    QTest::newRow("inlineToPlainText") << false;
+    QTest::newRow("QTextDocument") << true;
+}
+
+void tst_MarkdownText::benchmarkInlineToPlainText()
+{
+    QFETCH(bool, isUsingDocument);
+
+    const QStringList lines = { QStringLiteral("# Meeting notes for **Monday**"),
+                                QStringLiteral("- [ ] send the [agenda](https://example.com/agenda) to _everyone_"),
+                                QStringLiteral("Use `inlineToPlainText()` for titles &amp; previews"),
+                                QStringLiteral("> A quote with ![a picture](picture.png) and <em>html</em>"),
+                                QStringLiteral("Just a plain line of text without any markup in it at all") };
+    QString text;
+    QBENCHMARK {
+        for (const auto &line : lines) {
+            text = isUsingDocument ? documentPlainText(line) : MarkdownText::inlineToPlainText(line);
+        }
+    }
+    QVERIFY(!text.isEmpty());
+}
+
+QTEST_MAIN(tst_MarkdownText)
@@ -0,0 +1,20 @@
+#ifndef TST_MARKDOWNTEXT_H
+#define TST_MARKDOWNTEXT_H
+
+#include <QObject>
+#include <QtTest>
+
+class tst_MarkdownText : public QObject
+{
+    Q_OBJECT
+public:
+    tst_MarkdownText();
+
+private Q_SLOTS:
+    void inlineToPlainText_data();
+    void inlineToPlainText();
+    void benchmarkInlineToPlainText_data();
+    void benchmarkInlineToPlainText();
+};
+
+#endif // TST_MARKDOWNTEXT_H
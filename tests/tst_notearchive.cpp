@@ -0,0 +1,303 @@
+#include "tst_notearchive.h"
+#include "notearchive.h"
+#include <QBuffer>
+#include <QtEndian>
+
+namespace {
+auto constexpr CENTRAL_DIRECTORY_HEADER_SIGNATURE = 0x02014b50u;
+auto constexpr END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50u;
+auto constexpr ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50u;
+auto constexpr ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE = 0x07064b50u;
+auto constexpr LOCAL_FILE_HEADER_SIZE = 30;
+auto constexpr CENTRAL_DIRECTORY_HEADER_SIZE = 46;
+auto constexpr END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+auto constexpr ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE = 20;
+
+QDateTime modificationDate()
+{
+    return QDateTime(QDate(2024, 5, 17), QTime(13, 45, 30));
+}
+
+// Bytes deflate can't make smaller, so they are stored
+QByteArray incompressibleData(int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    quint32 state = 12345;
+    for (auto &byte : data) {
+        state = state * 1103515245u + 12345u;
+        byte = static_cast<char>(state >> 24);
+    }
+    return data;
+}
+
+QByteArray compressibleData()
+{
+    return QByteArray("# A note\n\n- [ ] a task\n").repeated(500);
+}
+
+template<typename T>
+T valueAt(const QByteArray &archive, qint64 offset)
+{
+    return qFromLittleEndian<T>(archive.constData() + offset);
+}
+
+/*!
+ * Write an archive of the given entries, along with the offset of each
+ * local header and of the central directory
+ */
+QByteArray writeArchive(const QStringList &names, const QByteArrayList &data, QVector<qint64> *entryOffsets = nullptr,
+                        qint64 *centralDirectoryOffset = nullptr)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    NoteArchiveWriter writer(&buffer);
+    for (int i = 0; i < names.size(); ++i) {
+        if (entryOffsets != nullptr) {
+            entryOffsets->append(buffer.pos());
+        }
+        if (!writer.writeEntry(NoteArchiveWriter::compressEntry(names.at(i), data.at(i), modificationDate()))) {
+            return QByteArray();
+        }
+    }
+    if (centralDirectoryOffset != nullptr) {
+        *centralDirectoryOffset = buffer.pos();
+    }
+    if (!writer.close()) {
+        return QByteArray();
+    }
+    return buffer.data();
+}
+
+/*!
+ * Read all the entries of an archive, stopping at the first error
+ */
+bool readArchive(QByteArray archive, QStringList *names, QByteArrayList *data)
+{
+    QBuffer buffer(&archive);
+    buffer.open(QIODevice::ReadOnly);
+    NoteArchiveReader reader(&buffer);
+    QString name;
+    QByteArray entryData;
+    while (reader.readEntry(name, entryData)) {
+        names->append(name);
+        data->append(entryData);
+    }
+    return !reader.hasError();
+}
+} // namespace
+
+tst_NoteArchive::tst_NoteArchive() { }
+
+void tst_NoteArchive::compressEntry_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<bool>("isCompressed");
+
+    QTest::newRow("empty") << QByteArray() << false;
+    QTest::newRow("short") << QByteArray("short") << false;
+    QTest::newRow("incompressible") << incompressibleData(4096) << false;
+    QTest::newRow("compressible") << compressibleData() << true;
+}
+
+void tst_NoteArchive::compressEntry()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(bool, isCompressed);
+
+    auto entry = NoteArchiveWriter::compressEntry(QStringLiteral("note.md"), data, modificationDate());
+    QCOMPARE(entry.isCompressed, isCompressed);
+    QCOMPARE(entry.size, static_cast<quint32>(data.size()));
+    if (isCompressed) {
+        QVERIFY(entry.data.size() < data.size());
+    } else {
+        QCOMPARE(entry.data, data);
+    }
+    // The check value of the CRC-32 used by zip
+    QCOMPARE(NoteArchiveWriter::compressEntry(QStringLiteral("check"), QByteArray("123456789"), modificationDate()).crc32, 0xcbf43926u);
+}
+
+void tst_NoteArchive::roundTrip_data()
+{
+    QTest::addColumn<QStringList>("names");
+    QTest::addColumn<QByteArrayList>("data");
+
+    QTest::newRow("no entries") << QStringList() << QByteArrayList();
+    QTest::newRow("stored") << QStringList{ QStringLiteral("note.md") } << QByteArrayList{ incompressibleData(1024) };
+    QTest::newRow("deflated") << QStringList{ QStringLiteral("note.md") } << QByteArrayList{ compressibleData() };
+    QTest::newRow("empty entry") << QStringList{ QStringLiteral("empty.md") } << QByteArrayList{ QByteArray() };
+    QTest::newRow("mixed") << QStringList{ QStringLiteral("index.json"), QStringLiteral("Notes/Work/plan.md"), QStringLiteral("Notes/Ünïcødé ✓.md"),
+                                           QStringLiteral("Notes/random.bin") }
+                           << QByteArrayList{ QByteArray("{\"version\":1}"), compressibleData(), QStringLiteral("Ünïcødé ✓").toUtf8(),
+                                              incompressibleData(70000) };
+}
+
+void tst_NoteArchive::roundTrip()
+{
+    QFETCH(QStringList, names);
+    QFETCH(QByteArrayList, data);
+
+    QByteArray archive = writeArchive(names, data);
+    QVERIFY(!archive.isEmpty());
+    QStringList readNames;
+    QByteArrayList readData;
+    QVERIFY(readArchive(archive, &readNames, &readData));
+    QCOMPARE(readNames, names);
+    QCOMPARE(readData, data);
+}
+
+void tst_NoteArchive::endOfCentralDirectory()
+{
+    const QStringList names = { QStringLiteral("a.md"), QStringLiteral("b.md"), QStringLiteral("c.md") };
+    const QByteArrayList data = { QByteArray("a"), compressibleData(), incompressibleData(100) };
+    QVector<qint64> entryOffsets;
+    qint64 centralDirectoryOffset = 0;
+    QByteArray archive = writeArchive(names, data, &entryOffsets, &centralDirectoryOffset);
+    QVERIFY(archive.size() > END_OF_CENTRAL_DIRECTORY_SIZE + ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE);
+
+    qint64 endOffset = archive.size() - END_OF_CENTRAL_DIRECTORY_SIZE;
+    QCOMPARE(valueAt<quint32>(archive, endOffset), END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+    QCOMPARE(valueAt<quint16>(archive, endOffset + 8), quint16(names.size()));
+    QCOMPARE(valueAt<quint16>(archive, endOffset + 10), quint16(names.size()));
+    QCOMPARE(valueAt<quint32>(archive, endOffset + 12), quint32(endOffset - centralDirectoryOffset));
+    QCOMPARE(valueAt<quint32>(archive, endOffset + 16), quint32(centralDirectoryOffset));
+    // Small archives have no ZIP64 records
+    QVERIFY(valueAt<quint32>(archive, endOffset - ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE) != ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE);
+
+    // Each central directory header points to the local header of its entry
+    qint64 offset = centralDirectoryOffset;
+    for (int i = 0; i < names.size(); ++i) {
+        QCOMPARE(valueAt<quint32>(archive, offset), CENTRAL_DIRECTORY_HEADER_SIGNATURE);
+        QCOMPARE(valueAt<quint32>(archive, offset + 42), quint32(entryOffsets.at(i)));
+        auto nameSize = valueAt<quint16>(archive, offset + 28);
+        QCOMPARE(QString::fromUtf8(archive.mid(offset + CENTRAL_DIRECTORY_HEADER_SIZE, nameSize)), names.at(i));
+        offset += CENTRAL_DIRECTORY_HEADER_SIZE + nameSize + valueAt<quint16>(archive, offset + 30) + valueAt<quint16>(archive, offset + 32);
+    }
+    QCOMPARE(offset, endOffset);
+}
+
+void tst_NoteArchive::truncatedArchive_data()
+{
+    QTest::addColumn<QString>("cut");
+    QTest::addColumn<int>("readCount");
+
+    QTest::newRow("first local header") << QStringLiteral("first local header") << 0;
+    QTest::newRow("second local header") << QStringLiteral("second local header") << 1;
+    QTest::newRow("second entry data") << QStringLiteral("second entry data") << 1;
+    QTest::newRow("central directory") << QStringLiteral("central directory") << 2;
+}
+
+void tst_NoteArchive::truncatedArchive()
+{
+    QFETCH(QString, cut);
+    QFETCH(int, readCount);
+
+    const QStringList names = { QStringLiteral("first.md"), QStringLiteral("second.md") };
+    const QByteArrayList data = { incompressibleData(500), compressibleData() };
+    QVector<qint64> entryOffsets;
+    qint64 centralDirectoryOffset = 0;
+    QByteArray archive = writeArchive(names, data, &entryOffsets, &centralDirectoryOffset);
+    QVERIFY(!archive.isEmpty());
+    if (cut == QStringLiteral("first local header")) {
+        archive.truncate(LOCAL_FILE_HEADER_SIZE / 2);
+    } else if (cut == QStringLiteral("second local header")) {
+        archive.truncate(entryOffsets.at(1) + LOCAL_FILE_HEADER_SIZE / 2);
+    } else if (cut == QStringLiteral("second entry data")) {
+        archive.truncate(centralDirectoryOffset - 10);
+    } else {
+        // Without its central directory, the end of the archive can't be told apart from a truncated one
+        archive.truncate(centralDirectoryOffset);
+    }
+
+    QStringList readNames;
+    QByteArrayList readData;
+    QVERIFY(!readArchive(archive, &readNames, &readData));
+    QCOMPARE(readNames, names.mid(0, readCount));
+    QCOMPARE(readData, data.mid(0, readCount));
+}
+
+void tst_NoteArchive::corruptedEntry_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QString>("field");
+
+    QTest::newRow("stored crc") << incompressibleData(500) << QStringLiteral("crc");
+    QTest::newRow("stored size") << incompressibleData(500) << QStringLiteral("size");
+    QTest::newRow("stored data") << incompressibleData(500) << QStringLiteral("data");
+    QTest::newRow("deflated crc") << compressibleData() << QStringLiteral("crc");
+    QTest::newRow("deflated size") << compressibleData() << QStringLiteral("size");
+    QTest::newRow("deflated data") << compressibleData() << QStringLiteral("data");
+    QTest::newRow("deflated adler32") << compressibleData() << QStringLiteral("adler32");
+}
+
+void tst_NoteArchive::corruptedEntry()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, field);
+
+    QByteArray archive = writeArchive({ QStringLiteral("note.md") }, { data });
+    QVERIFY(!archive.isEmpty());
+    auto nameSize = valueAt<quint16>(archive, 26);
+    auto extraSize = valueAt<quint16>(archive, 28);
+    auto compressedSize = valueAt<quint32>(archive, 18);
+    qint64 offset = 0;
+    if (field == QStringLiteral("crc")) {
+        offset = 14;
+    } else if (field == QStringLiteral("size")) {
+        offset = 22;
+    } else if (field == QStringLiteral("adler32")) {
+        QCOMPARE(extraSize, quint16(8));
+        offset = LOCAL_FILE_HEADER_SIZE + nameSize + 4;
+    } else {
+        offset = LOCAL_FILE_HEADER_SIZE + nameSize + extraSize + compressedSize / 2;
+    }
+    archive[offset] = static_cast<char>(archive.at(offset) ^ 0x01);
+
+    QStringList readNames;
+    QByteArrayList readData;
+    QVERIFY(!readArchive(archive, &readNames, &readData));
+    QVERIFY(readNames.isEmpty());
+}
+
+void tst_NoteArchive::zip64EndOfCentralDirectory()
+{
+    // The classic end record counts entries on 16 bits, 0xffff already means
+    // the count is in the ZIP64 record
+    const int entryCount = 0xffff;
+    QStringList names;
+    QByteArrayList data;
+    names.reserve(entryCount);
+    data.reserve(entryCount);
+    for (int i = 0; i < entryCount; ++i) {
+        names.append(QStringLiteral("Notes/%1.md").arg(i));
+        data.append(QByteArray::number(i));
+    }
+    qint64 centralDirectoryOffset = 0;
+    QByteArray archive = writeArchive(names, data, nullptr, &centralDirectoryOffset);
+    QVERIFY(!archive.isEmpty());
+
+    qint64 endOffset = archive.size() - END_OF_CENTRAL_DIRECTORY_SIZE;
+    QCOMPARE(valueAt<quint32>(archive, endOffset), END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+    QCOMPARE(valueAt<quint16>(archive, endOffset + 8), quint16(0xffff));
+    QCOMPARE(valueAt<quint16>(archive, endOffset + 10), quint16(0xffff));
+
+    qint64 locatorOffset = endOffset - ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIZE;
+    QCOMPARE(valueAt<quint32>(archive, locatorOffset), ZIP64_END_OF_CENTRAL_DIRECTORY_LOCATOR_SIGNATURE);
+    QCOMPARE(valueAt<quint32>(archive, locatorOffset + 16), quint32(1));
+    auto zip64EndOffset = static_cast<qint64>(valueAt<quint64>(archive, locatorOffset + 8));
+    QCOMPARE(valueAt<quint32>(archive, zip64EndOffset), ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE);
+    // The size of the record after its signature and size fields
+    QCOMPARE(valueAt<quint64>(archive, zip64EndOffset + 4), quint64(locatorOffset - zip64EndOffset - 12));
+    QCOMPARE(valueAt<quint64>(archive, zip64EndOffset + 24), quint64(entryCount));
+    QCOMPARE(valueAt<quint64>(archive, zip64EndOffset + 32), quint64(entryCount));
+    QCOMPARE(valueAt<quint64>(archive, zip64EndOffset + 40), quint64(zip64EndOffset - centralDirectoryOffset));
+    QCOMPARE(valueAt<quint64>(archive, zip64EndOffset + 48), quint64(centralDirectoryOffset));
+    QCOMPARE(valueAt<quint32>(archive, centralDirectoryOffset), CENTRAL_DIRECTORY_HEADER_SIGNATURE);
+
+    QStringList readNames;
+    QByteArrayList readData;
+    QVERIFY(readArchive(archive, &readNames, &readData));
+    QCOMPARE(readNames, names);
+    QCOMPARE(readData, data);
+}
+
+QTEST_GUILESS_MAIN(tst_NoteArchive)
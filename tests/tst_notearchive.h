@@ -0,0 +1,26 @@
+#ifndef TST_NOTEARCHIVE_H
+#define TST_NOTEARCHIVE_H
+
+#include <QObject>
+#include <QtTest>
+
+class tst_NoteArchive : public QObject
+{
+    Q_OBJECT
+public:
+    tst_NoteArchive();
+
+private Q_SLOTS:
+    void compressEntry_data();
+    void compressEntry();
+    void roundTrip_data();
+    void roundTrip();
+    void endOfCentralDirectory();
+    void truncatedArchive_data();
+    void truncatedArchive();
+    void corruptedEntry_data();
+    void corruptedEntry();
+    void zip64EndOfCentralDirectory();
+};
+
+#endif // TST_NOTEARCHIVE_H
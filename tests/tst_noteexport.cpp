@@ -0,0 +1,191 @@
+#include "tst_noteexport.h"
+#include "noteexport.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+namespace {
+NodeData folder(int id, int parentId, const QString &title, const QString &absolutePath)
+{
+    NodeData node;
+    node.setId(id);
+    node.setParentId(parentId);
+    node.setFullTitle(title);
+    node.setAbsolutePath(absolutePath);
+    node.setNodeType(NodeData::Type::Folder);
+    return node;
+}
+
+bool writeFile(const QString &filePath, const QByteArray &data)
+{
+    QFileInfo(filePath).dir().mkpath(QStringLiteral("."));
+    QFile file(filePath);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+} // namespace
+
+tst_NoteExport::tst_NoteExport() { }
+
+void tst_NoteExport::exportFileName_data()
+{
+    QTest::addColumn<QString>("title");
+    QTest::addColumn<QString>("fileName");
+
+    QTest::newRow("plain") << QStringLiteral("Shopping list") << QStringLiteral("Shopping list");
+    QTest::newRow("markdown") << QStringLiteral("# **Bold** title") << QStringLiteral("Bold title");
+    QTest::newRow("forbidden characters") << QStringLiteral("a/b\\c:d*e?f\"g<h>i|j") << QStringLiteral("a_b_c_d_e_f_g_h_i_j");
+    QTest::newRow("first line") << QStringLiteral("First<br />Second") << QStringLiteral("First");
+    QTest::newRow("empty") << QString() << QStringLiteral("Untitled Note");
+    QTest::newRow("long") << QString(300, u'x') << QString(200, u'x');
+}
+
+void tst_NoteExport::exportFileName()
+{
+    QFETCH(QString, title);
+    QFETCH(QString, fileName);
+
+    QCOMPARE(::exportFileName(title), fileName);
+}
+
+void tst_NoteExport::uniqueNames()
+{
+    ExportNames names;
+    QCOMPARE(names.unique(QString(), QStringLiteral("Note"), QStringLiteral(".md")), QStringLiteral("Note.md"));
+    QCOMPARE(names.unique(QString(), QStringLiteral("note"), QStringLiteral(".md")), QStringLiteral("note 1.md"));
+    QCOMPARE(names.unique(QString(), QStringLiteral("NOTE"), QStringLiteral(".md")), QStringLiteral("NOTE 2.md"));
+    // Names only clash within the same directory, and with the same extension
+    QCOMPARE(names.unique(QStringLiteral("Work"), QStringLiteral("Note"), QStringLiteral(".md")), QStringLiteral("Note.md"));
+    QCOMPARE(names.unique(QString(), QStringLiteral("Note"), QStringLiteral(".txt")), QStringLiteral("Note.txt"));
+    // Reserved names are skipped like given out ones
+    names.reserve(QString(), QStringLiteral("note 3.MD"));
+    QCOMPARE(names.unique(QString(), QStringLiteral("Note"), QStringLiteral(".md")), QStringLiteral("Note 4.md"));
+    names.reserve(QStringLiteral("Work"), QStringLiteral("Other.md"));
+    QCOMPARE(names.unique(QStringLiteral("work"), QStringLiteral("other"), QStringLiteral(".md")), QStringLiteral("other 1.md"));
+}
+
+void tst_NoteExport::folderExportPaths()
+{
+    const QString rootPath = QStringLiteral("/0");
+    // Children are listed before their parents, the paths don't depend on it
+    QVector<NodeData> folders = { folder(12, 10, QStringLiteral("Sub"), rootPath + QStringLiteral("/10/12")),
+                                  folder(13, 12, QStringLiteral("a/b"), rootPath + QStringLiteral("/10/12/13")),
+                                  folder(10, ROOT_FOLDER_ID, QStringLiteral("Work"), rootPath + QStringLiteral("/10")),
+                                  folder(11, ROOT_FOLDER_ID, QStringLiteral("work"), rootPath + QStringLiteral("/11")),
+                                  folder(ROOT_FOLDER_ID, INVALID_NODE_ID, QStringLiteral("/"), rootPath),
+                                  folder(20, 99, QStringLiteral("Orphan"), rootPath + QStringLiteral("/99/20")) };
+    ExportNames names;
+    const auto paths = ::folderExportPaths(folders, names);
+
+    QCOMPARE(paths.value(ROOT_FOLDER_ID), QString());
+    QVERIFY(!paths.contains(20));
+    // Sibling folders whose titles only differ by case get distinct names
+    QVERIFY(paths.value(10).toCaseFolded() != paths.value(11).toCaseFolded());
+    QVERIFY(paths.value(10).startsWith(QStringLiteral("Work")));
+    QVERIFY(paths.value(11).startsWith(QStringLiteral("work")));
+    QCOMPARE(paths.value(12), paths.value(10) + QStringLiteral("/Sub"));
+    QCOMPARE(paths.value(13), paths.value(12) + QStringLiteral("/a_b"));
+    // The folder names are taken for the notes of their parent directory
+    QCOMPARE(names.unique(QString(), QStringLiteral("WORK"), QString()), QStringLiteral("WORK 2"));
+}
+
+void tst_NoteExport::isExportManifestPathValid_data()
+{
+    QTest::addColumn<QString>("filePath");
+    QTest::addColumn<bool>("isValid");
+
+    QTest::newRow("file") << QStringLiteral("note.md") << true;
+    QTest::newRow("file in folder") << QStringLiteral("Work/Sub/note.md") << true;
+    QTest::newRow("empty") << QString() << false;
+    QTest::newRow("manifest") << QString::fromLatin1(EXPORT_MANIFEST_FILE_NAME) << false;
+    QTest::newRow("directory itself") << QStringLiteral(".") << false;
+    QTest::newRow("parent") << QStringLiteral("../note.md") << false;
+    QTest::newRow("parent through folder") << QStringLiteral("Work/../../note.md") << false;
+    QTest::newRow("not clean") << QStringLiteral("Work/../note.md") << false;
+    QTest::newRow("current directory prefix") << QStringLiteral("./note.md") << false;
+    QTest::newRow("absolute") << QDir::rootPath() + QStringLiteral("note.md") << false;
+}
+
+void tst_NoteExport::isExportManifestPathValid()
+{
+    QFETCH(QString, filePath);
+    QFETCH(bool, isValid);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QCOMPARE(::isExportManifestPathValid(QDir(directory.path()), filePath), isValid);
+}
+
+void tst_NoteExport::manifestRoundTrip()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QString manifestPath = QDir(directory.path()).filePath(QString::fromLatin1(EXPORT_MANIFEST_FILE_NAME));
+    QHash<int, ExportManifestEntry> manifest;
+    manifest.insert(3, { 1700000000000, QByteArray::fromHex("00112233445566778899aabbccddeeff00112233"), QStringLiteral("note.md") });
+    manifest.insert(7, { 42, QByteArray(), QStringLiteral("Work/Sub/other note.md") });
+    QVERIFY(::writeExportManifest(manifestPath, manifest));
+
+    const auto readManifest = ::readExportManifest(QDir(directory.path()), manifestPath);
+    QCOMPARE(readManifest.size(), manifest.size());
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        QVERIFY(readManifest.contains(it.key()));
+        const auto &entry = readManifest[it.key()];
+        QCOMPARE(entry.modificationDate, it->modificationDate);
+        QCOMPARE(entry.contentHash, it->contentHash);
+        QCOMPARE(entry.filePath, it->filePath);
+    }
+}
+
+void tst_NoteExport::readExportManifestSkipsInvalidPaths()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QString manifestPath = QDir(directory.path()).filePath(QString::fromLatin1(EXPORT_MANIFEST_FILE_NAME));
+    QJsonArray notes;
+    notes.append(QJsonObject{ { "id", 1 }, { "modificationDate", 1 }, { "hash", "00" }, { "path", "note.md" } });
+    notes.append(QJsonObject{ { "id", 2 }, { "modificationDate", 1 }, { "hash", "00" }, { "path", "../outside.md" } });
+    notes.append(QJsonObject{ { "id", 3 }, { "modificationDate", 1 }, { "hash", "00" }, { "path", QDir::rootPath() + QStringLiteral("etc/passwd") } });
+    notes.append(QJsonObject{ { "id", 4 }, { "modificationDate", 1 }, { "hash", "00" }, { "path", EXPORT_MANIFEST_FILE_NAME } });
+    QVERIFY(writeFile(manifestPath, QJsonDocument(QJsonObject{ { "version", EXPORT_MANIFEST_VERSION }, { "notes", notes } }).toJson()));
+
+    const auto manifest = ::readExportManifest(QDir(directory.path()), manifestPath);
+    QCOMPARE(manifest.size(), 1);
+    QCOMPARE(manifest.value(1).filePath, QStringLiteral("note.md"));
+}
+
+void tst_NoteExport::readExportManifestOtherVersion()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QString manifestPath = QDir(directory.path()).filePath(QString::fromLatin1(EXPORT_MANIFEST_FILE_NAME));
+    QVERIFY(::readExportManifest(QDir(directory.path()), manifestPath).isEmpty());
+
+    QJsonArray notes;
+    notes.append(QJsonObject{ { "id", 1 }, { "modificationDate", 1 }, { "hash", "00" }, { "path", "note.md" } });
+    QVERIFY(writeFile(manifestPath, QJsonDocument(QJsonObject{ { "version", EXPORT_MANIFEST_VERSION + 1 }, { "notes", notes } }).toJson()));
+    QVERIFY(::readExportManifest(QDir(directory.path()), manifestPath).isEmpty());
+}
+
+void tst_NoteExport::reserveUnmanagedFiles()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    QDir exportDirectory(directory.path());
+    QVERIFY(writeFile(exportDirectory.filePath(QStringLiteral("Note.md")), "not from the export"));
+    QVERIFY(writeFile(exportDirectory.filePath(QStringLiteral("managed.md")), "from the export"));
+    QVERIFY(writeFile(exportDirectory.filePath(QStringLiteral("Work/Other.md")), "not from the export"));
+    QHash<int, ExportManifestEntry> manifest;
+    manifest.insert(1, { 1, QByteArray(), QStringLiteral("managed.md") });
+
+    ExportNames names;
+    ::reserveUnmanagedFiles(exportDirectory, manifest, names);
+    QCOMPARE(names.unique(QString(), QStringLiteral("note"), QStringLiteral(".md")), QStringLiteral("note 1.md"));
+    QCOMPARE(names.unique(QString(), QStringLiteral("managed"), QStringLiteral(".md")), QStringLiteral("managed.md"));
+    QCOMPARE(names.unique(QStringLiteral("Work"), QStringLiteral("other"), QStringLiteral(".md")), QStringLiteral("other 1.md"));
+}
+
+QTEST_GUILESS_MAIN(tst_NoteExport)
@@ -0,0 +1,26 @@
+#ifndef TST_NOTEEXPORT_H
+#define TST_NOTEEXPORT_H
+
+#include <QObject>
+#include <QtTest>
+
+class tst_NoteExport : public QObject
+{
+    Q_OBJECT
+public:
+    tst_NoteExport();
+
+private Q_SLOTS:
+    void exportFileName_data();
+    void exportFileName();
+    void uniqueNames();
+    void folderExportPaths();
+    void isExportManifestPathValid_data();
+    void isExportManifestPathValid();
+    void manifestRoundTrip();
+    void readExportManifestSkipsInvalidPaths();
+    void readExportManifestOtherVersion();
+    void reserveUnmanagedFiles();
+};
+
+#endif // TST_NOTEEXPORT_H